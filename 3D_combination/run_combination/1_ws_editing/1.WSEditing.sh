@@ -1,27 +1,77 @@
-cd /project/atlas/users/mfernand/software/workspaceCombiner
-source setup_lxplus.sh
-
-# linear order
+#!/usr/bin/env bash
+# =============================================================================
+# 1.WSEditing.sh - Step 1: split the channel workspaces
+# =============================================================================
+# Runs the channel splits of splitWorkspaces.C (the job table of HWW, HTauTau
+# and Hbb, linear and quad) with the in-project splitter, see ../README.md.
+#
+# Usage:
+#   ./1.WSEditing.sh [--order linear|quad|all] [--channels HWW,Hbb]
+#                    [--threads N] [--low-memory|--no-low-memory] [--binned]
+#                    [--edit-rfv N] [--output-dir dir]
+# =============================================================================
 
-# HWW
-manager -w split -f /project/atlas/users/mfernand/HVV_CP_comb/3D_combination/original_ws/hWW/workspace-preFit-param-hvv-linear.root --wsName HWW_ggFVBF_DPhijj_comb --dataName obsData -i 0-71 -p /project/atlas/users/mfernand/Hcomb/HVV_CP_comb/3D_combination/modified_ws/HWW_Data.root --editRFV 2
+set -euo pipefail
 
-# HTau
-manager -w split -f /project/atlas/users/mfernand/HVV_CP_comb/3D_combination/original_ws/hTau/chw_chb_chwb_1NF_data_FullSyst_LinearOnly.root --wsName combined --dataName obsData -i 0-12 -p /project/atlas/users/mfernand/Hcomb/HVV_CP_comb/3D_combination/modified_ws/HTauTau_Data.root --editRFV 2
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+WSC_DIR="${WSC_DIR:-/project/atlas/users/mfernand/software/workspaceCombiner}"
+WSC_INC="${WSC_INC:-${WSC_DIR}/inc}"
+WSC_LIB="${WSC_LIB:-${WSC_DIR}/lib/libworkspaceCombiner}"
 
-# Hbb
-manager -w split -f /project/atlas/users/mfernand/HVV_CP_comb/3D_combination/original_ws/hbb/ws_cosDelta_ptw_chwtil_linear_with_pTW_NFs_v23_unblinded_with_postfitAsimov.root --wsName combined --dataName combData -i 0-32 -p /project/atlas/users/mfernand/Hcomb/HVV_CP_comb/3D_combination/modified_ws/hbb_Data.root --editRFV 2
+ORDER="all"
+CHANNELS=""
+THREADS=4
+LOW_MEMORY=-1
+BINNED="false"
+EDIT_RFV=-1
+OUTPUT_DIR=""
 
+usage() {
+    cat << USAGE
+Usage: $(basename "$0") [OPTIONS]
 
-#lin + quad
+Options:
+  --order <order>      linear|quad|all (default: all)
+  --channels <list>    Comma separated channels of the job table (default: all)
+  --threads <n>        Threads for the per-category build (default: ${THREADS})
+  --low-memory         Split every channel one category at a time
+  --no-low-memory      Split every channel from the full dataset
+                       (default: from the full dataset for all channels)
+  --binned             Store the split datasets binned
+  --edit-rfv <n>       Override the editRFV mode of the job table (2)
+  --output-dir <dir>   Write into dir instead of modified_ws
+  -h, --help           Show this help message
 
-# HWW
-manager -w split -f /project/atlas/users/mfernand/HVV_CP_comb/3D_combination/original_ws/hWW/workspace-preFit-param-hvv-quad.root --wsName HWW_ggFVBF_DPhijj_comb --dataName obsData -i 0-71 -p /project/atlas/users/mfernand/Hcomb/HVV_CP_comb/3D_combination/modified_ws/HWW_Data_quad.root --editRFV 2
+Environment: WSC_DIR, WSC_INC, WSC_LIB locate the workspaceCombiner build.
+USAGE
+}
 
-# HTau 
-manager -w split -f /project/atlas/users/mfernand/HVV_CP_comb/3D_combination/original_ws/hTau/htt_ws_DATA_crossterm_FullSyst_reparam_NEWER_VERSION.root --wsName combined --dataName obsData -i 0-12 -p /project/atlas/users/mfernand/Hcomb/HVV_CP_comb/3D_combination/modified_ws/HTauTau_Data_quad.root --editRFV 2
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        --order) ORDER="$2"; shift 2 ;;
+        --channels) CHANNELS="$2"; shift 2 ;;
+        --threads) THREADS="$2"; shift 2 ;;
+        --low-memory) LOW_MEMORY=1; shift ;;
+        --no-low-memory) LOW_MEMORY=0; shift ;;
+        --binned) BINNED="true"; shift ;;
+        --edit-rfv) EDIT_RFV="$2"; shift 2 ;;
+        --output-dir) OUTPUT_DIR="$2"; shift 2 ;;
+        -h|--help) usage; exit 0 ;;
+        *) echo "Unknown option: $1"; usage; exit 1 ;;
+    esac
+done
 
-# Hbb
-manager -w split -f /project/atlas/users/mfernand/HVV_CP_comb/3D_combination/original_ws/hbb/ws_cosDelta_ptw_chwtil_linearquadratic_with_pTW_NFs_v23_unblinded_with_postfitAsimov.root --wsName combined --dataName combData -i 0-32 -p /project/atlas/users/mfernand/Hcomb/HVV_CP_comb/3D_combination/modified_ws/hbb_Data_quad.root --editRFV 2
+# setup_lxplus.sh expects to be sourced from the workspaceCombiner directory
+pushd "${WSC_DIR}" > /dev/null
+set +u
+source setup_lxplus.sh
+set -u
+popd > /dev/null
 
+if [[ -n "${OUTPUT_DIR}" ]]; then
+    mkdir -p "${OUTPUT_DIR}"
+fi
 
+root -l -b -q \
+    -e "gSystem->AddIncludePath(\"-I${WSC_INC}\"); gSystem->Load(\"${WSC_LIB}\");" \
+    "${SCRIPT_DIR}/splitWorkspaces.C+(\"${ORDER}\", \"${CHANNELS}\", ${THREADS}, ${LOW_MEMORY}, ${BINNED}, ${EDIT_RFV}, \"${OUTPUT_DIR}\")"
@@ -0,0 +1,539 @@
+// Compiled polynomial node for the EFT yield parametrizations. The channel workspaces
+// write the signal yields as RooFormulaVar expressions that are linear or quadratic in
+// the Wilson coefficients (and normalization factors), each evaluated through the
+// interpreted TFormula. EFTPolynomial<Order, N> is the same polynomial of degree Order
+// in N inputs with the coefficients stored as numbers: the terms are unrolled at compile
+// time, and the inputs are plain proxies (so the RooProduct POIs of step 2 drop in as for
+// any other function). It has a batch evaluation for the cpu backend and code generation
+// for codegen, where Clad differentiates the closed form. Those overrides follow the
+// RooFit interfaces of the ROOT version: batch evaluation for 6.30 (computeBatch) and
+// 6.32 on (doEval), code generation for 6.30 and 6.32 (translate).
+// The node has no analytic gradient of its own: legacy and cpu give MINUIT only NLL
+// values, which it differentiates numerically, and codegen has Clad. Where only the scalar
+// evaluate() applies it is no faster than the formula, so eftPolynomial::speedsUp tells
+// for which backend of this ROOT version a replacement is worth it: cpu from 6.30,
+// codegen for 6.30 and 6.32, never legacy or below 6.30.
+// eftPolynomial::fromFormula converts a RooFormulaVar whose expression is such a
+// polynomial (numbers, inputs, + - *, / by numbers, ^ and pow with exponents 0-2):
+// splitter::editRFV does it under --editRFV 3 and fitServer.C with polyFormulas on the
+// loaded workspace, both only where speedsUp. Files written with the node need the class
+// to be read back (this header with its dictionary, as in the ACLiC macros that include
+// it); quickFit and the workspaceCombiner build cannot read them.
+#ifndef EFT_POLYNOMIAL_HEADER
+#define EFT_POLYNOMIAL_HEADER
+
+#include <RooAbsReal.h>
+#include <RooArgList.h>
+#include <RooArgSet.h>
+#include <RooFormulaVar.h>
+#include <RooListProxy.h>
+#include <RooRealVar.h>
+#include <RooWorkspace.h>
+#include <RooGlobalFunc.h>
+#include <RVersion.h>
+#include <TString.h>
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 32, 0)
+#include <RooFit/EvalContext.h>
+#define EFT_POLYNOMIAL_BATCH
+#elif ROOT_VERSION_CODE >= ROOT_VERSION(6, 30, 0)
+#include <RooFit/Detail/DataMap.h>
+#define EFT_POLYNOMIAL_BATCH
+#endif
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 30, 0) && ROOT_VERSION_CODE < ROOT_VERSION(6, 34, 0)
+#include <RooFit/Detail/CodeSquashContext.h>
+#define EFT_POLYNOMIAL_CODEGEN
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+// Inputs of the largest instantiated node
+const int EFT_POLYNOMIAL_MAX_VARS = 6;
+
+// c0 + sum_i c_i x_i (+ sum_{i<=j} c_ij x_i x_j for Order 2); the coefficients are
+// stored in that order, the quadratic ones row by row
+template <int Order, int N>
+class EFTPolynomial : public RooAbsReal {
+    static_assert(Order == 1 || Order == 2, "EFTPolynomial is linear or quadratic");
+    static_assert(N >= 1, "EFTPolynomial needs an input");
+
+public:
+    static constexpr int NTERMS = 1 + N + (Order == 2 ? N * (N + 1) / 2 : 0);
+
+    EFTPolynomial() = default;
+    EFTPolynomial(const char* name, const char* title, const RooArgList& vars, const std::vector<double>& coefs)
+        : RooAbsReal(name, title), _vars("vars", "vars", this) {
+        if ((int)vars.size() != N || (int)coefs.size() != NTERMS) {
+            std::cerr << "ERROR: EFTPolynomial<" << Order << ", " << N << "> " << name << " needs " << N << " inputs and "
+                      << NTERMS << " coefficients, got " << vars.size() << " and " << coefs.size() << std::endl;
+            std::abort();
+        }
+        _vars.add(vars);
+        std::copy(coefs.begin(), coefs.end(), _coefs.begin());
+    }
+    EFTPolynomial(const EFTPolynomial& other, const char* name = nullptr)
+        : RooAbsReal(other, name), _vars("vars", this, other._vars), _coefs(other._coefs) {}
+    TObject* clone(const char* newname) const override { return new EFTPolynomial(*this, newname); }
+
+    const RooArgList& variables() const { return _vars; }
+    const std::array<double, NTERMS>& coefficients() const { return _coefs; }
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 32, 0)
+    void doEval(RooFit::EvalContext& ctx) const override {
+        auto output = ctx.output();
+        const double* values[N];
+        bool scalar[N];
+        for (int i = 0; i < N; i++) {
+            auto span = ctx.at(&_vars[i]);
+            values[i] = span.data();
+            scalar[i] = span.size() == 1;
+        }
+        batch(output.data(), output.size(), values, scalar);
+    }
+#elif ROOT_VERSION_CODE >= ROOT_VERSION(6, 30, 0)
+    void computeBatch(double* output, size_t size, RooFit::Detail::DataMap const& dataMap) const override {
+        const double* values[N];
+        bool scalar[N];
+        for (int i = 0; i < N; i++) {
+            auto span = dataMap.at(&_vars[i]);
+            values[i] = span.data();
+            scalar[i] = span.size() == 1;
+        }
+        batch(output, size, values, scalar);
+    }
+#endif
+
+#ifdef EFT_POLYNOMIAL_CODEGEN
+    void translate(RooFit::Detail::CodeSquashContext& ctx) const override {
+        std::string x[N];
+        for (int i = 0; i < N; i++)
+            x[i] = ctx.getResult(_vars[i]);
+        const double* c = _coefs.data();
+        std::string code = "(" + number(c[0]);
+        for (int i = 0; i < N; i++)
+            code += " + " + number(c[1 + i]) + " * " + x[i];
+        if constexpr (Order == 2) {
+            int k = 1 + N;
+            for (int a = 0; a < N; a++) {
+                for (int b = a; b < N; b++, k++)
+                    code += " + " + number(c[k]) + " * " + x[a] + " * " + x[b];
+            }
+        }
+        ctx.addResult(this, code + ")");
+    }
+#endif
+
+protected:
+    double evaluate() const override {
+        double x[N];
+        inputs(x);
+        return value(x);
+    }
+
+private:
+    void inputs(double* x) const {
+        for (int i = 0; i < N; i++)
+            x[i] = static_cast<const RooAbsReal&>(_vars[i]).getVal();
+    }
+    // The inputs are usually the same for all entries (size 1), e.g. the Wilson
+    // coefficients; entry-dependent ones are used per entry
+    void batch(double* output, size_t size, const double* const* values, const bool* scalar) const {
+        double x[N];
+        for (size_t k = 0; k < size; k++) {
+            for (int i = 0; i < N; i++)
+                x[i] = scalar[i] ? values[i][0] : values[i][k];
+            output[k] = value(x);
+        }
+    }
+    double value(const double* x) const {
+        const double* c = _coefs.data();
+        double v = c[0];
+        for (int i = 0; i < N; i++)
+            v += c[1 + i] * x[i];
+        if constexpr (Order == 2) {
+            int k = 1 + N;
+            for (int a = 0; a < N; a++) {
+                double row = 0;
+                for (int b = a; b < N; b++, k++)
+                    row += c[k] * x[b];
+                v += row * x[a];
+            }
+        }
+        return v;
+    }
+    static std::string number(double v) { return TString::Format("(%.17g)", v).Data(); }
+
+    RooListProxy _vars;
+    std::array<double, NTERMS> _coefs{};
+
+    ClassDefOverride(EFTPolynomial, 2)
+};
+
+#ifdef __ROOTCLING__
+#pragma link C++ class EFTPolynomial<1,1>+;
+#pragma link C++ class EFTPolynomial<1,2>+;
+#pragma link C++ class EFTPolynomial<1,3>+;
+#pragma link C++ class EFTPolynomial<1,4>+;
+#pragma link C++ class EFTPolynomial<1,5>+;
+#pragma link C++ class EFTPolynomial<1,6>+;
+#pragma link C++ class EFTPolynomial<2,1>+;
+#pragma link C++ class EFTPolynomial<2,2>+;
+#pragma link C++ class EFTPolynomial<2,3>+;
+#pragma link C++ class EFTPolynomial<2,4>+;
+#pragma link C++ class EFTPolynomial<2,5>+;
+#pragma link C++ class EFTPolynomial<2,6>+;
+#endif
+
+namespace eftPolynomial {
+
+// Polynomial of degree <= 2 in n inputs: constant, linear and (upper triangle of the)
+// quadratic coefficients
+struct Poly {
+    double c = 0;
+    std::vector<double> lin;
+    std::vector<double> quad;  // n x n, i <= j
+
+    explicit Poly(int n = 0, double constant = 0) : c(constant), lin(n, 0.), quad(n * n, 0.) {}
+    int size() const { return lin.size(); }
+    int degree() const {
+        for (double q : quad)
+            if (q != 0)
+                return 2;
+        for (double l : lin)
+            if (l != 0)
+                return 1;
+        return 0;
+    }
+    void scale(double f) {
+        c *= f;
+        for (double& l : lin)
+            l *= f;
+        for (double& q : quad)
+            q *= f;
+    }
+    void add(const Poly& o, double f = 1) {
+        c += f * o.c;
+        for (int i = 0; i < size(); i++)
+            lin[i] += f * o.lin[i];
+        for (size_t i = 0; i < quad.size(); i++)
+            quad[i] += f * o.quad[i];
+    }
+    double eval(const std::vector<double>& x) const {
+        int n = size();
+        double v = c;
+        for (int i = 0; i < n; i++) {
+            v += lin[i] * x[i];
+            for (int j = i; j < n; j++)
+                v += quad[i * n + j] * x[i] * x[j];
+        }
+        return v;
+    }
+    // false if the product is above degree 2
+    bool multiply(const Poly& o) {
+        int d = degree(), od = o.degree();
+        if (d + od > 2)
+            return false;
+        if (d == 0 || od == 0) {
+            const Poly& p = d == 0 ? o : *this;
+            double f = d == 0 ? c : o.c;
+            Poly r = p;
+            r.scale(f);
+            *this = r;
+            return true;
+        }
+        int n = size();
+        Poly r(n, c * o.c);
+        for (int i = 0; i < n; i++) {
+            r.lin[i] = c * o.lin[i] + o.c * lin[i];
+            for (int j = 0; j < n; j++)
+                r.quad[std::min(i, j) * n + std::max(i, j)] += lin[i] * o.lin[j];
+        }
+        *this = r;
+        return true;
+    }
+};
+
+// Recursive descent over the TFormula subset of the yield formulas; @i, x[i] and the
+// names of the inputs address input i
+class Parser {
+public:
+    Parser(const std::string& expr, const RooArgList& vars) : m_expr(expr), m_vars(vars) {}
+
+    bool parse(Poly& result) {
+        m_pos = 0;
+        m_ok = true;
+        result = expression();
+        skip();
+        return m_ok && m_pos == m_expr.size();
+    }
+
+private:
+    void skip() {
+        while (m_pos < m_expr.size() && isspace(m_expr[m_pos]))
+            m_pos++;
+    }
+    bool accept(char c) {
+        skip();
+        if (m_pos < m_expr.size() && m_expr[m_pos] == c) {
+            m_pos++;
+            return true;
+        }
+        return false;
+    }
+    Poly fail() {
+        m_ok = false;
+        m_pos = m_expr.size();
+        return Poly(m_vars.size());
+    }
+    Poly input(int i) {
+        if (i < 0 || i >= (int)m_vars.size())
+            return fail();
+        Poly p(m_vars.size());
+        p.lin[i] = 1;
+        return p;
+    }
+    long index() {
+        skip();
+        size_t start = m_pos;
+        while (m_pos < m_expr.size() && isdigit(m_expr[m_pos]))
+            m_pos++;
+        return m_pos > start ? std::atol(m_expr.c_str() + start) : -1;
+    }
+    // exponent of ^ or pow: a constant 0, 1 or 2
+    Poly power(Poly base, const Poly& exponent) {
+        if (exponent.degree() != 0 || exponent.c != std::floor(exponent.c) || exponent.c < 0 || exponent.c > 2)
+            return fail();
+        Poly r(m_vars.size(), 1);
+        for (int k = 0; k < exponent.c; k++) {
+            if (!r.multiply(base))
+                return fail();
+        }
+        return r;
+    }
+
+    Poly expression() {
+        Poly p = term();
+        while (m_ok) {
+            if (accept('+'))
+                p.add(term());
+            else if (accept('-'))
+                p.add(term(), -1);
+            else
+                break;
+        }
+        return p;
+    }
+    Poly term() {
+        Poly p = unary();
+        while (m_ok) {
+            if (accept('*')) {
+                if (!p.multiply(unary()))
+                    return fail();
+            } else if (accept('/')) {
+                Poly d = unary();
+                if (d.degree() != 0 || d.c == 0)
+                    return fail();
+                p.scale(1 / d.c);
+            } else
+                break;
+        }
+        return p;
+    }
+    Poly unary() {
+        if (accept('-')) {
+            Poly p = unary();
+            p.scale(-1);
+            return p;
+        }
+        if (accept('+'))
+            return unary();
+        Poly base = primary();
+        if (m_ok && accept('^'))
+            return power(base, unary());
+        return base;
+    }
+    Poly primary() {
+        skip();
+        if (m_pos >= m_expr.size())
+            return fail();
+        char c = m_expr[m_pos];
+        if (accept('(')) {
+            Poly p = expression();
+            return accept(')') ? p : fail();
+        }
+        if (accept('@'))
+            return input(index());
+        if (isdigit(c) || c == '.') {
+            char* end = nullptr;
+            double v = std::strtod(m_expr.c_str() + m_pos, &end);
+            m_pos = end - m_expr.c_str();
+            return Poly(m_vars.size(), v);
+        }
+        if (isalpha(c) || c == '_') {
+            size_t start = m_pos;
+            while (m_pos < m_expr.size() && (isalnum(m_expr[m_pos]) || m_expr[m_pos] == '_'))
+                m_pos++;
+            std::string name = m_expr.substr(start, m_pos - start);
+            if (name == "x" && accept('[')) {
+                Poly p = input(index());
+                return accept(']') ? p : fail();
+            }
+            if (name == "pow" && accept('(')) {
+                Poly base = expression();
+                if (!m_ok || !accept(','))
+                    return fail();
+                Poly exponent = expression();
+                return accept(')') ? power(base, exponent) : fail();
+            }
+            int i = m_vars.index(name.c_str());
+            return i >= 0 ? input(i) : fail();
+        }
+        return fail();
+    }
+
+    std::string m_expr;
+    const RooArgList& m_vars;
+    size_t m_pos = 0;
+    bool m_ok = true;
+};
+
+// The node of the given order for n inputs, nullptr above EFT_POLYNOMIAL_MAX_VARS
+template <int Order, int N = 1>
+RooAbsReal* make(int n, const char* name, const char* title, const RooArgList& vars, const std::vector<double>& coefs) {
+    if (n == N)
+        return new EFTPolynomial<Order, N>(name, title, vars, coefs);
+    if constexpr (N < EFT_POLYNOMIAL_MAX_VARS)
+        return make<Order, N + 1>(n, name, title, vars, coefs);
+    return nullptr;
+}
+
+// Compares the parsed polynomial to the formula expr itself on free copies of its inputs,
+// at a few points away from the current values (the Wilson coefficients are usually 0
+// there, where only the constant term would be tested)
+inline bool matches(const Poly& p, const TString& expr, const RooArgList& vars) {
+    int n = vars.size();
+    RooArgList copies;
+    std::vector<std::unique_ptr<RooRealVar>> owned;
+    for (int i = 0; i < n; i++) {
+        owned.emplace_back(new RooRealVar(vars[i].GetName(), vars[i].GetName(), 0));
+        copies.add(*owned.back());
+    }
+    RooFormulaVar test("eftPolynomialTest", expr, copies);
+    std::vector<double> x(n);
+    for (int point = 0; point < 3; point++) {
+        for (int i = 0; i < n; i++) {
+            x[i] = std::sin(1.3 * point + 0.7 * i + 0.4);
+            owned[i]->setVal(x[i]);
+        }
+        double expected = test.getVal(), value = p.eval(x);
+        if (std::abs(value - expected) > 1e-9 * std::max(1., std::abs(expected)))
+            return false;
+    }
+    return true;
+}
+
+// EFTPolynomial (owned by the caller) with the name and value of formula, for its
+// expression expr in the inputs vars (by default its own), or nullptr if expr is not a
+// polynomial of degree 1 or 2 or the node does not reproduce the formula
+inline RooAbsReal* fromFormula(const RooFormulaVar& formula, const TString& expr, const RooArgList& vars) {
+    Poly p;
+    if (!Parser(expr.Data(), vars).parse(p))
+        return nullptr;
+    int order = p.degree();
+    if (order == 0 || !matches(p, expr, vars))
+        return nullptr;
+
+    // inputs the polynomial depends on, in their original order
+    int n = vars.size();
+    std::vector<int> used;
+    for (int i = 0; i < n; i++) {
+        bool any = p.lin[i] != 0;
+        for (int j = 0; j < n && !any; j++)
+            any = p.quad[std::min(i, j) * n + std::max(i, j)] != 0;
+        if (any)
+            used.push_back(i);
+    }
+    RooArgList inputs;
+    std::vector<double> coefs{p.c};
+    for (int i : used) {
+        inputs.add(vars[i]);
+        coefs.push_back(p.lin[i]);
+    }
+    if (order == 2) {
+        for (size_t a = 0; a < used.size(); a++) {
+            for (size_t b = a; b < used.size(); b++)
+                coefs.push_back(p.quad[used[a] * n + used[b]]);
+        }
+    }
+
+    std::unique_ptr<RooAbsReal> node(order == 1 ? make<1>(used.size(), formula.GetName(), formula.GetTitle(), inputs, coefs)
+                                                : make<2>(used.size(), formula.GetName(), formula.GetTitle(), inputs, coefs));
+    if (!node)
+        return nullptr;
+    double expected = formula.getVal(), value = node->getVal();
+    if (std::abs(value - expected) > 1e-9 * std::max(1., std::abs(expected)))
+        return nullptr;
+    return node.release();
+}
+
+inline RooAbsReal* fromFormula(const RooFormulaVar& formula) {
+    return fromFormula(formula, formula.expression(), RooArgList(formula.dependents()));
+}
+
+// Whether the node evaluates faster than the RooFormulaVar with the given evaluation
+// backend ("legacy", "cpu" or "codegen") of this ROOT version
+inline bool speedsUp(const std::string& backend) {
+#ifdef EFT_POLYNOMIAL_CODEGEN
+    if (backend == "codegen")
+        return true;
+#endif
+#ifdef EFT_POLYNOMIAL_BATCH
+    if (backend == "cpu")
+        return true;
+#endif
+    return false;
+}
+
+// Replaces the polynomial RooFormulaVars in the graph of top by EFTPolynomial nodes of
+// the same name imported into ws, as replace_POI_with_product.C does for the POIs: the
+// formula is renamed to <name>_formula and stays unused in the workspace. Returns the
+// number of replaced formulas.
+inline int replaceFormulas(RooWorkspace& ws, const RooAbsArg& top) {
+    RooArgSet components;
+    top.treeNodeServerList(&components);
+    int replaced = 0;
+    for (RooAbsArg* arg : components) {
+        if (typeid(*arg) != typeid(RooFormulaVar))
+            continue;
+        RooFormulaVar* formula = static_cast<RooFormulaVar*>(arg);
+        std::unique_ptr<RooAbsReal> node(fromFormula(*formula));
+        if (!node)
+            continue;
+        TString name = formula->GetName(), origName = name + "_formula";
+        formula->SetName(origName);
+        ws.import(*node, RooFit::RecycleConflictNodes(), RooFit::Silence());
+        RooAbsArg* imported = ws.function(name);
+        TString origAttr = "ORIGNAME:" + origName;
+        imported->setAttribute(origAttr);
+        std::vector<RooAbsArg*> clients(formula->clients().begin(), formula->clients().end());
+        for (RooAbsArg* client : clients) {
+            if (client != imported)
+                client->redirectServers(RooArgSet(*imported), false, true);
+        }
+        imported->setAttribute(origAttr, false);
+        replaced++;
+    }
+    return replaced;
+}
+
+}  // namespace eftPolynomial
+
+#endif
@@ -0,0 +1,452 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  nativeCombiner.cxx
+ *
+ *    Description:  Workspace combiner reading the workspaceCombiner XML format
+ *
+ *        Version:  1.0
+ *        Created:  10/14/2026
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#include "nativeCombiner.h"
+
+using namespace std;
+using namespace RooFit;
+using namespace RooStats;
+
+namespace hvvcp
+{
+
+TString nativeCombiner::GLOBPREFIX = "RNDM__";
+TString nativeCombiner::CONSTRPOSTFIX = "_Pdf";
+TString nativeCombiner::CATNAME = "combCat";
+
+namespace
+{
+  TString xmlAttr(TXMLNode *node, TString attrName, TString defaultValue = "", bool required = false)
+  {
+    TList *attrs = node->GetAttributes();
+    TXMLAttr *attr = attrs ? dynamic_cast<TXMLAttr *>(attrs->FindObject(attrName)) : nullptr;
+    if (!attr)
+    {
+      if (required)
+        auxUtil::alertAndAbort(Form("Attribute %s is missing in node %s", attrName.Data(), node->GetNodeName()));
+      return defaultValue;
+    }
+    return attr->GetValue();
+  }
+
+  TXMLNode *parseXML(TDOMParser &parser, TString fileName)
+  {
+    /* the DOCTYPE lines point to absolute DTD paths, which are not needed here */
+    parser.SetValidate(false);
+    if (parser.ParseFile(fileName) != 0 || !parser.GetXMLDocument())
+      auxUtil::alertAndAbort(Form("Cannot parse XML file %s", fileName.Data()));
+    return parser.GetXMLDocument()->GetRootNode();
+  }
+}
+
+nativeCombiner::nativeCombiner(TString configFileName)
+{
+  readConfig(configFileName);
+  m_comb.reset(new RooWorkspace(m_wsName, m_wsName));
+}
+
+void nativeCombiner::readConfig(TString configFileName)
+{
+  TDOMParser parser;
+  TXMLNode *rootNode = parseXML(parser, configFileName);
+
+  m_wsName = xmlAttr(rootNode, "WorkspaceName", "combWS");
+  m_mcName = xmlAttr(rootNode, "ModelConfigName", "ModelConfig");
+  m_dataName = xmlAttr(rootNode, "DataName", "combData");
+  m_outputFileName = xmlAttr(rootNode, "OutputFile", "combined.root");
+
+  for (TXMLNode *node = rootNode->GetChildren(); node; node = node->GetNextNode())
+  {
+    if (node->GetNodeType() != TXMLNode::kXMLElementNode)
+      continue;
+    TString nodeName = node->GetNodeName();
+    if (nodeName == "POIList")
+    {
+      for (const TString &spec : parseList(xmlAttr(node, "Combined")))
+        m_pois.push_back(parsePOI(spec));
+    }
+    else if (nodeName == "Channel")
+    {
+      channelSpec ch;
+      ch.name = xmlAttr(node, "Name", "", true);
+      ch.inputFile = xmlAttr(node, "InputFile", "", true);
+      ch.wsName = xmlAttr(node, "WorkspaceName", "", true);
+      ch.mcName = xmlAttr(node, "ModelConfigName", "", true);
+      ch.dataName = xmlAttr(node, "DataName", "", true);
+      for (TXMLNode *child = node->GetChildren(); child; child = child->GetNextNode())
+      {
+        if (child->GetNodeType() != TXMLNode::kXMLElementNode)
+          continue;
+        TString childName = child->GetNodeName();
+        if (childName == "POIList")
+          ch.inputPOIs = parseList(xmlAttr(child, "Input"));
+        else if (childName == "RenameMap")
+        {
+          TString renameFile = xmlAttr(child, "InputFile");
+          if (renameFile != "")
+            readRenameMap(renameFile, ch.renames);
+          readRenameNode(child, ch.renames);
+        }
+      }
+      if (ch.inputPOIs.size() > m_pois.size())
+        auxUtil::alertAndAbort(Form("Channel %s lists %d input POIs but there are only %d combined POIs", ch.name.Data(), (int)ch.inputPOIs.size(), (int)m_pois.size()));
+      /* the input POIs map to the combined POIs by position, "dummy" skips one */
+      for (size_t i = 0; i < ch.inputPOIs.size(); i++)
+      {
+        if (ch.inputPOIs[i] != "dummy")
+          ch.renames[ch.inputPOIs[i].Data()] = m_pois[i].name.Data();
+      }
+      spdlog::info("Channel {}: {} renaming rules", ch.name.Data(), ch.renames.size());
+      m_channels.push_back(std::move(ch));
+    }
+    else if (nodeName == "Asimov")
+      spdlog::warn("Asimov blocks are ignored, the Asimov datasets are generated in step 4");
+  }
+  if (m_channels.empty())
+    auxUtil::alertAndAbort(Form("No channel defined in %s", configFileName.Data()));
+}
+
+void nativeCombiner::readRenameMap(TString fileName, renameMap &renames)
+{
+  TDOMParser parser;
+  readRenameNode(parseXML(parser, fileName), renames);
+}
+
+void nativeCombiner::readRenameNode(TXMLNode *mapNode, renameMap &renames)
+{
+  for (TXMLNode *node = mapNode->GetChildren(); node; node = node->GetNextNode())
+  {
+    if (node->GetNodeType() == TXMLNode::kXMLElementNode && TString(node->GetNodeName()) == "Syst")
+      addRename(xmlAttr(node, "OldName", "", true), xmlAttr(node, "NewName", "", true), renames);
+  }
+}
+
+/* OldName is either a plain parameter name or "constraintPdf(nuisance, globalObservable)".
+   In the second form all three objects are renamed after NewName, so that correlated
+   nuisance parameters of different channels end up sharing one constraint term */
+void nativeCombiner::addRename(TString oldName, TString newName, renameMap &renames)
+{
+  auxUtil::removeWhiteSpace(oldName);
+  auxUtil::removeWhiteSpace(newName);
+  int open = oldName.First('(');
+  int close = oldName.Last(')');
+  if (open < 0 || close < open)
+  {
+    renames[oldName.Data()] = newName.Data();
+    return;
+  }
+  std::vector<TString> args = parseList(oldName(open + 1, close - open - 1));
+  if (args.size() != 2)
+    auxUtil::alertAndAbort(Form("Cannot interpret renaming rule %s", oldName.Data()));
+  renames[TString(oldName(0, open)).Data()] = (newName + CONSTRPOSTFIX).Data();
+  renames[args[0].Data()] = newName.Data();
+  renames[args[1].Data()] = (GLOBPREFIX + newName).Data();
+}
+
+nativeCombiner::poiSpec nativeCombiner::parsePOI(TString spec)
+{
+  poiSpec poi;
+  poi.hasValue = poi.hasRange = false;
+  poi.value = poi.min = poi.max = 0;
+  int open = spec.First('[');
+  if (open < 0)
+  {
+    poi.name = spec;
+    return poi;
+  }
+  poi.name = spec(0, open);
+  TString range = spec(open + 1, spec.Last(']') - open - 1);
+  /* both name[1~0~10] and name[1_0_10] are used in our configurations */
+  const char *sep = range.Contains('~') ? "~" : "_";
+  unique_ptr<TObjArray> tokens(range.Tokenize(sep));
+  int n = tokens->GetEntries();
+  std::vector<double> values;
+  for (int i = 0; i < n; i++)
+    values.push_back(atof(((TObjString *)tokens->At(i))->GetString()));
+  if (n == 1 || n == 3)
+  {
+    poi.hasValue = true;
+    poi.value = values[0];
+  }
+  if (n == 2 || n == 3)
+  {
+    poi.hasRange = true;
+    poi.min = values[n - 2];
+    poi.max = values[n - 1];
+  }
+  if (n < 1 || n > 3)
+    auxUtil::alertAndAbort(Form("Cannot interpret POI %s", spec.Data()));
+  return poi;
+}
+
+std::vector<TString> nativeCombiner::parseList(TString list)
+{
+  std::vector<TString> items;
+  unique_ptr<TObjArray> tokens(list.Tokenize(","));
+  for (int i = 0; i < tokens->GetEntries(); i++)
+  {
+    TString item = ((TObjString *)tokens->At(i))->GetString();
+    auxUtil::removeWhiteSpace(item);
+    if (item != "")
+      items.push_back(item);
+  }
+  return items;
+}
+
+void nativeCombiner::addNames(const RooArgSet &params, parameterIndex::Role role)
+{
+  for (RooAbsArg *arg : params)
+  {
+    if (m_seen[role].insert(arg->GetName()).second)
+      m_names[role].push_back(arg->GetName());
+  }
+}
+
+void nativeCombiner::importChannel(const channelSpec &ch)
+{
+  auxUtil::printTitle(ch.name, '-');
+  RooWorkspace *w = m_provider ? m_provider(ch.inputFile) : nullptr;
+  if (w)
+  {
+    spdlog::info("Channel {} taken from memory instead of {}", ch.name.Data(), ch.inputFile.Data());
+    importChannel(ch, w);
+    if (m_release)
+      m_release(w);
+    return;
+  }
+
+  unique_ptr<TFile> inputFile(TFile::Open(ch.inputFile));
+  if (!inputFile.get())
+    auxUtil::alertAndAbort(Form("Input file %s does not exist", ch.inputFile.Data()));
+  w = dynamic_cast<RooWorkspace *>(inputFile->Get(ch.wsName));
+  if (!w)
+    auxUtil::alertAndAbort(Form("Workspace %s does not exist in file %s", ch.wsName.Data(), ch.inputFile.Data()));
+  importChannel(ch, w);
+}
+
+void nativeCombiner::importChannel(const channelSpec &ch, RooWorkspace *w)
+{
+  ModelConfig *mc = dynamic_cast<ModelConfig *>(w->obj(ch.mcName));
+  if (!mc)
+    auxUtil::alertAndAbort(Form("ModelConfig %s does not exist in file %s", ch.mcName.Data(), ch.inputFile.Data()));
+  RooAbsPdf *pdf = mc->GetPdf();
+  if (!pdf)
+    auxUtil::alertAndAbort(Form("ModelConfig %s does not point to a valid PDF", ch.mcName.Data()));
+  RooAbsData *data = w->data(ch.dataName);
+  if (!data)
+    auxUtil::alertAndAbort(Form("Dataset %s does not exist in file %s", ch.dataName.Data(), ch.inputFile.Data()));
+
+  /* ModelConfig looks its content up by name, so everything is resolved before renaming */
+  parameterIndex parIndex(mc, mc->GetConditionalObservables() != nullptr);
+  unique_ptr<RooArgSet> obs(pdf->getObservables(*data));
+  unique_ptr<RooArgSet> params(pdf->getParameters(*obs));
+  unique_ptr<RooArgSet> nodes(pdf->getComponents());
+  parIndex.collect(*params);
+  RooArgSet poi, gobs, cobs, nuis;
+  parIndex.fill(poi, gobs, cobs, nuis);
+
+  /* split the data into categories */
+  const size_t firstCat = m_catData.size();
+  std::vector<std::pair<std::string, RooAbsPdf *>> catPdfs;
+  RooSimultaneous *sim = dynamic_cast<RooSimultaneous *>(pdf);
+  if (sim)
+  {
+    const RooAbsCategoryLValue &cat = sim->indexCat();
+    unique_ptr<TList> dataList(data->split(cat, true));
+    for (const auto &type : cat)
+    {
+      RooAbsPdf *pdfi = sim->getPdf(type.first.c_str());
+      RooAbsData *datai = dynamic_cast<RooAbsData *>(dataList->FindObject(type.first.c_str()));
+      if (!pdfi || !datai)
+        continue;
+      dataList->Remove(datai);
+      catPdfs.push_back(std::make_pair(type.first, pdfi));
+      m_catData.push_back(catData{type.first, unique_ptr<RooAbsData>(datai)});
+    }
+    dataList->Delete();
+  }
+  else
+  {
+    catPdfs.push_back(std::make_pair(std::string(ch.name.Data()), pdf));
+    m_catData.push_back(catData{ch.name.Data(), unique_ptr<RooAbsData>(dynamic_cast<RooAbsData *>(data->Clone()))});
+  }
+  for (const auto &catPdf : catPdfs)
+  {
+    if (m_pdfMap.count(catPdf.first))
+      auxUtil::alertAndAbort(Form("Category %s of channel %s is already defined by another channel", catPdf.first.c_str(), ch.name.Data()));
+  }
+
+  /* Rename in place with one hash look-up per node: parameters follow the renaming map,
+     every other node gets the channel name appended so that it cannot clash with another
+     channel when imported */
+  int nRenamed = 0;
+  for (RooAbsArg *arg : *params)
+  {
+    auto found = ch.renames.find(arg->GetName());
+    if (found != ch.renames.end())
+    {
+      arg->SetName(found->second.c_str());
+      nRenamed++;
+    }
+  }
+  const TString postfix = "_" + ch.name;
+  for (RooAbsArg *arg : *nodes)
+  {
+    auto found = ch.renames.find(arg->GetName());
+    if (found != ch.renames.end())
+    {
+      arg->SetName(found->second.c_str());
+      nRenamed++;
+    }
+    else
+      arg->SetName(TString(arg->GetName()) + postfix);
+  }
+  spdlog::info("{} objects renamed following the renaming map", nRenamed);
+
+  /* observables are never shared between channels */
+  for (RooAbsArg *arg : *obs)
+  {
+    std::string obsName = arg->GetName();
+    if (m_seenObs.count(obsName))
+    {
+      std::string newName = obsName + postfix.Data();
+      spdlog::warn("Observable {} is already used by another channel, renamed to {}", obsName, newName);
+      arg->SetName(newName.c_str());
+      for (size_t i = firstCat; i < m_catData.size(); i++)
+        m_catData[i].data->changeObservableName(obsName.c_str(), newName.c_str());
+      obsName = newName;
+    }
+    m_seenObs.insert(obsName);
+    m_obsNames.push_back(obsName);
+  }
+
+  for (const auto &catPdf : catPdfs)
+  {
+    m_comb->import(*catPdf.second, RooFit::RecycleConflictNodes(), RooFit::Silence());
+    m_pdfMap[catPdf.first] = m_comb->pdf(catPdf.second->GetName());
+  }
+
+  addNames(poi, parameterIndex::POI);
+  addNames(gobs, parameterIndex::GLOB);
+  addNames(cobs, parameterIndex::COBS);
+  addNames(nuis, parameterIndex::NUIS);
+  spdlog::info("Channel {}: {} categories, {} nuisance parameters, {} global observables", ch.name.Data(), catPdfs.size(), nuis.getSize(), gobs.getSize());
+}
+
+RooDataSet *nativeCombiner::mergeData(const RooArgSet &obsAndCat)
+{
+  RooRealVar weightVar(splitter::WGTNAME, "", 1);
+  RooArgSet obsCatAndWgt(obsAndCat, weightVar);
+  RooDataSet *combData = new RooDataSet(m_dataName, m_dataName, obsCatAndWgt, RooFit::WeightVar(splitter::WGTNAME));
+
+  RooArgSet row(*combData->get());
+  row.useHashMapForFind(true);
+  RooCategory *cat = dynamic_cast<RooCategory *>(row.find(CATNAME));
+  for (catData &piece : m_catData)
+  {
+    const int catIndex = cat->lookupIndex(piece.label);
+    for (int j = 0, nEntries = piece.data->numEntries(); j < nEntries; ++j)
+    {
+      /* the source rows may carry the channel category, set ours afterwards */
+      row.assign(*piece.data->get(j));
+      cat->setIndex(catIndex);
+      combData->add(row, piece.data->weight());
+    }
+    piece.data.reset();
+  }
+  return combData;
+}
+
+void nativeCombiner::makeWorkspace()
+{
+  for (const channelSpec &ch : m_channels)
+    importChannel(ch);
+
+  auxUtil::printTitle("Combined model", '-');
+  RooCategory combCat(CATNAME, CATNAME);
+  for (const catData &piece : m_catData)
+    combCat.defineType(piece.label);
+  RooSimultaneous combPdf("combPdf", "combPdf", m_pdfMap, combCat);
+  m_comb->import(combPdf, RooFit::RecycleConflictNodes(), RooFit::Silence());
+
+  RooArgSet poiSet, nuisSet, globSet, cobsSet, obsSet;
+  std::unordered_set<std::string> poiNames;
+  for (const poiSpec &spec : m_pois)
+  {
+    RooRealVar *var = m_comb->var(spec.name);
+    if (!var)
+    {
+      spdlog::warn("POI {} is not used by any channel, adding it as a free parameter", spec.name.Data());
+      m_comb->import(RooRealVar(spec.name, spec.name, spec.value), RooFit::Silence());
+      var = m_comb->var(spec.name);
+    }
+    if (spec.hasRange)
+      var->setRange(spec.min, spec.max);
+    if (spec.hasValue)
+      var->setVal(spec.value);
+    if (spec.hasRange || spec.hasValue)
+      var->setConstant(!spec.hasRange);
+    poiSet.add(*var);
+    poiNames.insert(spec.name.Data());
+  }
+
+  auto addToSet = [this](RooArgSet &set, const std::string &name) {
+    RooAbsArg *arg = m_comb->arg(name.c_str());
+    if (arg)
+      set.add(*arg, true);
+  };
+  /* channel POIs that are not combined POIs float as nuisance parameters */
+  for (int role : {parameterIndex::POI, parameterIndex::NUIS})
+  {
+    for (const std::string &name : m_names[role])
+    {
+      if (!poiNames.count(name) && !m_seen[parameterIndex::GLOB].count(name))
+        addToSet(nuisSet, name);
+    }
+  }
+  for (const std::string &name : m_names[parameterIndex::GLOB])
+    addToSet(globSet, name);
+  for (const std::string &name : m_names[parameterIndex::COBS])
+    addToSet(cobsSet, name);
+  for (const std::string &name : m_obsNames)
+    addToSet(obsSet, name);
+  obsSet.add(*m_comb->cat(CATNAME));
+
+  unique_ptr<RooDataSet> combData(mergeData(obsSet));
+  spdlog::info("Combined dataset {}: {} entries, sum of weights {}", m_dataName.Data(), combData->numEntries(), combData->sumEntries());
+  m_comb->import(*combData);
+  m_comb->importClassCode();
+
+  ModelConfig mc(m_mcName, m_comb.get());
+  mc.SetWorkspace(*m_comb);
+  mc.SetPdf(*m_comb->pdf("combPdf"));
+  mc.SetProtoData(*m_comb->data(m_dataName));
+  mc.SetParametersOfInterest(poiSet);
+  mc.SetNuisanceParameters(nuisSet);
+  mc.SetGlobalObservables(globSet);
+  if (cobsSet.getSize() > 0)
+    mc.SetConditionalObservables(cobsSet);
+  mc.SetObservables(obsSet);
+  m_comb->import(mc);
+
+  spdlog::info("{} categories, {} POIs, {} nuisance parameters, {} global observables", m_pdfMap.size(), poiSet.getSize(), nuisSet.getSize(), globSet.getSize());
+
+  unique_ptr<TFile> outputFile(TFile::Open(m_outputFileName, "recreate"));
+  m_comb->Write();
+  outputFile->Close();
+
+  spdlog::info("Output file {} saved", m_outputFileName.Data());
+}
+
+} // namespace hvvcp
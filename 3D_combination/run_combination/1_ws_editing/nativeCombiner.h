@@ -0,0 +1,110 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  nativeCombiner.h
+ *
+ *    Description:  Workspace combiner reading the workspaceCombiner XML format
+ *
+ *        Version:  1.0
+ *        Created:  10/14/2026
+ *       Compiler:  gcc
+ *
+ * =====================================================================================
+ */
+
+#ifndef NATIVECOMBINER_HEADER
+#define NATIVECOMBINER_HEADER
+
+#include "splitter.h"
+
+#include <TDOMParser.h>
+#include <TXMLAttr.h>
+#include <TXMLDocument.h>
+#include <TXMLNode.h>
+
+#include <functional>
+
+namespace hvvcp
+{
+
+class nativeCombiner
+{
+public:
+  nativeCombiner(TString configFileName);
+  ~nativeCombiner() {}
+
+  /* In-memory channel workspaces, keyed by the InputFile of the configuration. A provider
+     returning nullptr lets the channel be read from InputFile as usual; otherwise the
+     workspace is renamed in place while it is imported and handed to release afterwards */
+  typedef std::function<RooWorkspace *(const TString &inputFile)> inputProvider;
+  typedef std::function<void(RooWorkspace *w)> inputRelease;
+
+  void setOutputFile(TString outputFileName) { m_outputFileName = outputFileName; }
+  void setInputProvider(inputProvider provider, inputRelease release)
+  {
+    m_provider = provider;
+    m_release = release;
+  }
+  void makeWorkspace();
+
+  /* names given to the renamed global observables and constraint PDFs */
+  static TString GLOBPREFIX;
+  static TString CONSTRPOSTFIX;
+  static TString CATNAME;
+
+private:
+  /* Combined POI, e.g. cHWtil_combine[0~-5~5], CSM_HZZ[1] */
+  struct poiSpec
+  {
+    TString name;
+    double value, min, max;
+    bool hasValue, hasRange;
+  };
+
+  typedef std::unordered_map<std::string, std::string> renameMap;
+
+  struct channelSpec
+  {
+    TString name, inputFile, wsName, mcName, dataName;
+    std::vector<TString> inputPOIs;
+    /* old name -> new name of every parameter and constraint renamed in this channel */
+    renameMap renames;
+  };
+
+  /* per-category data of a channel, merged into the combined dataset at the end */
+  struct catData
+  {
+    std::string label;
+    std::unique_ptr<RooAbsData> data;
+  };
+
+  void readConfig(TString configFileName);
+  void readRenameMap(TString fileName, renameMap &renames);
+  void readRenameNode(TXMLNode *mapNode, renameMap &renames);
+  static void addRename(TString oldName, TString newName, renameMap &renames);
+  static poiSpec parsePOI(TString spec);
+  static std::vector<TString> parseList(TString list);
+  void importChannel(const channelSpec &ch);
+  void importChannel(const channelSpec &ch, RooWorkspace *w);
+  void addNames(const RooArgSet &params, parameterIndex::Role role);
+  RooDataSet *mergeData(const RooArgSet &obsAndCat);
+
+  TString m_wsName, m_mcName, m_dataName, m_outputFileName;
+  std::vector<poiSpec> m_pois;
+  std::vector<channelSpec> m_channels;
+  inputProvider m_provider;
+  inputRelease m_release;
+
+  std::unique_ptr<RooWorkspace> m_comb;
+  std::map<std::string, RooAbsPdf *> m_pdfMap;
+  std::vector<catData> m_catData;
+  /* observables and parameters of the combined model by name, in first-seen order */
+  std::vector<std::string> m_obsNames;
+  std::unordered_set<std::string> m_seenObs;
+  std::vector<std::string> m_names[parameterIndex::NROLES];
+  std::unordered_set<std::string> m_seen[parameterIndex::NROLES];
+};
+
+} // namespace hvvcp
+
+#endif
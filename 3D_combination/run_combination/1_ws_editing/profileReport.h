@@ -0,0 +1,188 @@
+// Wall-clock phase timers and a minimal streaming JSON writer for the profiling reports
+// of the splitter and the fit server, written as <output>.profile.json next to each
+// output file. scripts/utils/profile_report.py sums the reports of a job or scan.
+#ifndef PROFILE_REPORT_HEADER
+#define PROFILE_REPORT_HEADER
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace profiling {
+
+using Clock = std::chrono::steady_clock;
+
+inline double seconds_since(Clock::time_point start) {
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Accumulated wall time per named phase, in the order the phases were first used
+class PhaseTimer {
+public:
+    // adds the lifetime of the scope to its phase
+    class Scope {
+    public:
+        Scope(PhaseTimer& timer, std::string phase) : m_timer(timer), m_phase(std::move(phase)), m_start(Clock::now()) {}
+        ~Scope() { m_timer.add(m_phase, seconds_since(m_start)); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        PhaseTimer& m_timer;
+        std::string m_phase;
+        Clock::time_point m_start;
+    };
+
+    void add(const std::string& phase, double seconds) {
+        for (auto& p : m_phases) {
+            if (p.first == phase) {
+                p.second += seconds;
+                return;
+            }
+        }
+        m_phases.emplace_back(phase, seconds);
+    }
+    double get(const std::string& phase) const {
+        for (auto& p : m_phases) {
+            if (p.first == phase)
+                return p.second;
+        }
+        return 0;
+    }
+    const std::vector<std::pair<std::string, double>>& phases() const { return m_phases; }
+    void clear() { m_phases.clear(); }
+
+private:
+    std::vector<std::pair<std::string, double>> m_phases;
+};
+
+// Objects and arrays are opened and closed explicitly; keys are given inside objects and
+// omitted inside arrays. Non-finite numbers are written as null.
+class JsonWriter {
+public:
+    explicit JsonWriter(std::ostream& out) : m_out(out) { m_out << std::setprecision(10); }
+
+    JsonWriter& begin_object(const char* key = nullptr) { return open(key, '{'); }
+    JsonWriter& end_object() { return close('}'); }
+    JsonWriter& begin_array(const char* key = nullptr) { return open(key, '['); }
+    JsonWriter& end_array() { return close(']'); }
+
+    JsonWriter& value(const char* key, double v) {
+        separator(key);
+        if (std::isfinite(v))
+            m_out << v;
+        else
+            m_out << "null";
+        return *this;
+    }
+    JsonWriter& value(const char* key, long v) {
+        separator(key);
+        m_out << v;
+        return *this;
+    }
+    JsonWriter& value(const char* key, int v) { return value(key, static_cast<long>(v)); }
+    JsonWriter& value(const char* key, bool v) {
+        separator(key);
+        m_out << (v ? "true" : "false");
+        return *this;
+    }
+    JsonWriter& value(const char* key, const std::string& v) {
+        separator(key);
+        quote(v);
+        return *this;
+    }
+    JsonWriter& value(const char* key, const char* v) { return value(key, std::string(v)); }
+    JsonWriter& null(const char* key) {
+        separator(key);
+        m_out << "null";
+        return *this;
+    }
+    // {"<phase>": seconds, ...}
+    JsonWriter& phases(const char* key, const PhaseTimer& timer) {
+        begin_object(key);
+        for (auto& p : timer.phases())
+            value(p.first.c_str(), p.second);
+        return end_object();
+    }
+
+private:
+    void separator(const char* key) {
+        if (!m_first.empty()) {
+            if (!m_first.back())
+                m_out << ",";
+            m_first.back() = false;
+            m_out << "\n" << std::string(2 * m_first.size(), ' ');
+        }
+        if (key) {
+            quote(key);
+            m_out << ": ";
+        }
+    }
+    JsonWriter& open(const char* key, char bracket) {
+        separator(key);
+        m_out << bracket;
+        m_first.push_back(true);
+        return *this;
+    }
+    JsonWriter& close(char bracket) {
+        bool empty = m_first.back();
+        m_first.pop_back();
+        if (!empty)
+            m_out << "\n" << std::string(2 * m_first.size(), ' ');
+        m_out << bracket;
+        if (m_first.empty())
+            m_out << "\n";
+        return *this;
+    }
+    void quote(const std::string& text) {
+        m_out << '"';
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                m_out << '\\' << c;
+            else if (c == '\n')
+                m_out << "\\n";
+            else if (static_cast<unsigned char>(c) >= 0x20)
+                m_out << c;
+        }
+        m_out << '"';
+    }
+
+    std::ostream& m_out;
+    std::vector<bool> m_first;  // per open object/array: nothing written into it yet
+};
+
+// fit.root -> fit.profile.json
+inline std::string report_path(std::string outputFile) {
+    const std::string ext = ".root";
+    if (outputFile.size() > ext.size() && outputFile.compare(outputFile.size() - ext.size(), ext.size(), ext) == 0)
+        outputFile.erase(outputFile.size() - ext.size());
+    return outputFile + ".profile.json";
+}
+
+// written aside and renamed, so that a reader never sees a partial report
+inline bool write_report(const std::string& path, const std::string& content) {
+    std::string tmp = path + "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream out(tmp);
+        if (!(out << content))
+            return false;
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0) {
+        std::remove(tmp.c_str());
+        return false;
+    }
+    return true;
+}
+
+}  // namespace profiling
+
+#endif
@@ -19,11 +19,15 @@
  */
 
 #include "splitter.h"
+#include "eftPolynomial.h"
 
 using namespace std;
 using namespace RooFit;
 using namespace RooStats;
 
+namespace hvvcp
+{
+
 TString splitter::WGTNAME = "_weight_";
 TString splitter::PDFPOSTFIX = "_deComposed";
 
@@ -34,6 +38,7 @@ splitter::splitter(
     TString mcName,
     TString dataName)
 {
+  auto start = profiling::Clock::now();
   m_outputFileName = outputFileName;
   m_inputFile.reset(TFile::Open(inputFileName));
   if (!m_inputFile.get())
@@ -77,11 +82,74 @@ splitter::splitter(
     spdlog::warn("Dataset {} in workspace {} of file {} is RooDataHist. Convert it to RooDataSet...", dataName.Data(), wsName.Data(), inputFileName.Data());
     histToDataset(dynamic_cast<RooDataHist *>(m_comb->data(dataName)));
   }
-  m_dataList = m_data->split(*m_cat, true);
+  /* split on first use, the low-memory mode never splits the full dataset */
+  m_dataList = nullptr;
 
   m_reBin = -1;
   m_rebuildPdf = false;
   m_editRFV = -1;
+  m_nThreads = 1;
+  m_lowMemory = false;
+  m_binned = false;
+  m_fastFill = true;
+  m_timer.add("load", profiling::seconds_since(start));
+}
+
+parameterIndex::parameterIndex(RooStats::ModelConfig *mc, bool hasCondObs)
+{
+  /* emplace does not overwrite, so the insertion order sets the precedence */
+  const RooArgSet *sets[] = {mc->GetParametersOfInterest(), mc->GetGlobalObservables(), hasCondObs ? mc->GetConditionalObservables() : nullptr};
+  const Role roles[] = {POI, GLOB, COBS};
+  for (int i = 0; i < 3; i++)
+  {
+    if (!sets[i])
+      continue;
+    for (RooAbsArg *arg : *sets[i])
+    {
+      RooRealVar *var = dynamic_cast<RooRealVar *>(arg);
+      if (var)
+        m_index.emplace(var->GetName(), std::make_pair(roles[i], var));
+    }
+  }
+}
+
+parameterIndex::Role parameterIndex::classify(RooRealVar *v, RooRealVar *&var) const
+{
+  auto found = m_index.find(v->GetName());
+  if (found != m_index.end())
+  {
+    var = found->second.second;
+    return found->second.first;
+  }
+  /* Any other free parameters should be counted as nuisance parameters */
+  var = v;
+  return v->isConstant() ? NROLES : NUIS;
+}
+
+void parameterIndex::collect(const RooArgSet &params)
+{
+  for (RooAbsArg *arg : params)
+  {
+    RooRealVar *v = dynamic_cast<RooRealVar *>(arg);
+    if (!v)
+      continue;
+    RooRealVar *var = nullptr;
+    Role role = classify(v, var);
+    if (role != NROLES && m_seen[role].insert(var).second)
+      m_selected[role].push_back(var);
+  }
+}
+
+void parameterIndex::fill(RooArgSet &poi, RooArgSet &gobs, RooArgSet &cobs, RooArgSet &nuis) const
+{
+  /* entries are unique already, the hash map only keeps the duplicate check of add() cheap */
+  RooArgSet *targets[] = {&poi, &gobs, &cobs, &nuis};
+  for (int role = 0; role < NROLES; role++)
+  {
+    targets[role]->useHashMapForFind(true);
+    for (RooRealVar *var : m_selected[role])
+      targets[role]->add(*var, true);
+  }
 }
 
 void splitter::printSummary()
@@ -93,7 +161,8 @@ void splitter::printSummary()
     m_cat->setBin(i);
     TString channelName = m_cat->getLabel();
     RooAbsPdf *pdfi = m_pdf->getPdf(channelName);
-    RooDataSet *datai = (RooDataSet *)(m_dataList->FindObject(channelName));
+    std::unique_ptr<RooDataSet> ownedData;
+    RooDataSet *datai = getCatData(channelName, ownedData);
     spdlog::info("\tIndex: {}, Pdf: {}, Data: {}, SumEntries: {}", i, pdfi->GetName(), datai->GetName(), datai->sumEntries());
   }
 
@@ -160,12 +229,60 @@ void splitter::fillIndices(TString indices)
 }
 
 void splitter::makeWorkspace()
+{
+  unique_ptr<RooWorkspace> subComb(buildWorkspace());
+  if (!subComb)
+    return;
+
+  {
+    profiling::PhaseTimer::Scope timer(m_timer, "write");
+    unique_ptr<TFile> outputFile(TFile::Open(m_outputFileName, "recreate"));
+    subComb->Write();
+    outputFile->Close();
+  }
+
+  spdlog::info("Output file {} saved", m_outputFileName.Data());
+  writeProfile(profiling::report_path(m_outputFileName.Data()).c_str());
+}
+
+void splitter::writeProfile(TString fileName) const
+{
+  std::ostringstream out;
+  profiling::JsonWriter json(out);
+  json.begin_object();
+  json.value("tool", "splitter");
+  json.value("output", m_outputFileName.Data());
+  json.value("threads", m_nThreads);
+  json.value("lowMemory", m_lowMemory);
+  json.value("binned", m_binned);
+  json.value("fastFill", m_fastFill);
+  json.phases("phases", m_timer);
+  json.begin_array("categories");
+  for (const catProfile &prof : m_catProfiles)
+  {
+    json.begin_object();
+    json.value("name", prof.name);
+    json.value("mode", prof.mode);
+    json.value("numEntries", prof.numEntries);
+    json.value("sumEntries", prof.sumEntries);
+    json.phases("phases", prof.timer);
+    json.end_object();
+  }
+  json.end_array();
+  json.end_object();
+  if (profiling::write_report(fileName.Data(), out.str()))
+    spdlog::info("Profile {} saved", fileName.Data());
+  else
+    spdlog::warn("Cannot write profile {}", fileName.Data());
+}
+
+RooWorkspace *splitter::buildWorkspace()
 {
   const int subNumChannels = m_useIndices.size();
   if (subNumChannels == 0)
   {
     spdlog::warn("No sub-channel selected, Exit... ");
-    return;
+    return nullptr;
   }
   unique_ptr<RooWorkspace> subComb(new RooWorkspace(m_comb->GetName(), m_comb->GetTitle()));
   unique_ptr<RooCategory> subCat(new RooCategory(m_cat->GetName(), m_cat->GetTitle()));
@@ -173,6 +290,35 @@ void splitter::makeWorkspace()
   RooArgSet subNuis, subGobs, subCobs, subObs, subPoi;
   std::map<std::string, RooAbsPdf *> subPdfMap;
   std::map<std::string, RooDataSet *> subDataMap;
+  /* (source, target) pairs of the per-category datasets, filled after the loop */
+  std::vector<std::pair<RooAbsData *, RooDataSet *>> fillJobs;
+  /* index into m_catProfiles of each fill job */
+  std::vector<std::size_t> fillProfiles;
+  m_catProfiles.clear();
+  parameterIndex parIndex(m_mc, m_hasCondObs);
+  /* per-category intermediates; the datasets are released once merged, the PDFs are
+     only needed until the combined PDF is imported */
+  TList catPdfs, catData;
+  catPdfs.SetOwner(true);
+  catData.SetOwner(true);
+
+  /* Low-memory mode: the categories and observables are known up front, so the combined
+     dataset can be filled directly while the categories are processed one at a time */
+  RooRealVar weightVar(WGTNAME, "", 1);
+  unique_ptr<RooDataSet> streamData;
+  if (m_lowMemory)
+  {
+    for (int index : m_useIndices)
+    {
+      m_cat->setBin(index);
+      TString channelName = m_cat->getLabel();
+      subCat->defineType(channelName);
+      unique_ptr<RooArgSet> indivObs(m_pdf->getPdf(channelName)->getObservables(*m_data));
+      subObs.add(*indivObs);
+    }
+    RooArgSet obsCatAndWgt(subObs, *subCat, weightVar);
+    streamData.reset(new RooDataSet(m_data->GetName(), m_data->GetTitle(), obsCatAndWgt, RooFit::WeightVar(WGTNAME)));
+  }
 
   int index = 0;
   for (int i = 0; i < subNumChannels; i++)
@@ -182,56 +328,58 @@ void splitter::makeWorkspace()
     m_cat->setBin(index);
     TString channelName = m_cat->getLabel();
     RooAbsPdf *pdfi = m_pdf->getPdf(channelName);
-    RooDataSet *datai = dynamic_cast<RooDataSet *>(m_dataList->FindObject(channelName));
+    m_catProfiles.push_back(catProfile{channelName.Data(), "copied", 0, 0., {}});
+    catProfile &prof = m_catProfiles.back();
+    /* the one-off split of the full dataset is a phase of its own */
+    auto stepStart = profiling::Clock::now();
+    const double splitBefore = m_timer.get("split");
+    unique_ptr<RooDataSet> ownedData;
+    RooDataSet *datai = getCatData(channelName, ownedData);
+    prof.timer.add("extract", profiling::seconds_since(stepStart) - (m_timer.get("split") - splitBefore));
+    prof.numEntries = datai->numEntries();
+    prof.sumEntries = datai->sumEntries();
     /* make category */
     spdlog::info("\tChannel name --> {}", channelName.Data());
-    subCat->defineType(channelName);
+    if (!m_lowMemory)
+      subCat->defineType(channelName);
     /* make observables */
     RooArgSet *indivObs = pdfi->getObservables(*datai);
-    subObs.add(*indivObs);
+    if (!m_lowMemory)
+      subObs.add(*indivObs);
     /* make nuisances */
     RooArgSet *indivNuis = pdfi->getParameters(*indivObs);
 
-    for (auto it = indivNuis->begin(); it != indivNuis->end(); ++it)
+    parIndex.collect(*indivNuis);
+
+    if (m_rebuildPdf)
     {
-      RooRealVar *v = dynamic_cast<RooRealVar *>(*it);
-      RooRealVar *var = dynamic_cast<RooRealVar*>(m_mc->GetParametersOfInterest()->find(v->GetName()));
-      if (var)
-      {
-        subPoi.add(*var, true);
-        continue;
-      }
+      profiling::PhaseTimer::Scope timer(prof.timer, "pdf");
+      RooAbsPdf *pdfNew = rebuildCatPdf(pdfi, datai);
+      if (pdfNew != pdfi)
+        catPdfs.Add(pdfNew);
+      pdfi = pdfNew;
+    }
+    subPdfMap[channelName.Data()] = pdfi;
 
-      /* in original global observables */
-      var = dynamic_cast<RooRealVar*>(m_mc->GetGlobalObservables()->find(v->GetName()));
-      if (var)
+    /* Handle dataset */
+    profiling::PhaseTimer::Scope dataTimer(prof.timer, "data");
+    RooDataSet *binnedData = m_binned ? binnedCatData(pdfi, datai, indivObs) : nullptr;
+    if (binnedData)
+    {
+      prof.mode = "binned";
+      subCat->setLabel(channelName, true);
+      if (m_lowMemory)
       {
-        subGobs.add(*var);
-        continue;
-      }
-
-      if(m_hasCondObs){
-        var = dynamic_cast<RooRealVar*>(m_mc->GetConditionalObservables()->find(v->GetName()));
-        if (var)
-        {
-          subCobs.add(*var);
-          continue;
-        }
+        appendCatData(binnedData, streamData.get(), channelName);
+        delete binnedData;
       }
-
-      /* Any other free parameters should be counted as nuisance parameters */
-      if (!(v->isConstant()))
+      else
       {
-        subNuis.add(*v);
+        subDataMap[channelName.Data()] = binnedData;
+        catData.Add(binnedData);
       }
     }
-
-    if (m_rebuildPdf)
-      pdfi = rebuildCatPdf(pdfi, datai);
-    subPdfMap[channelName.Data()] = pdfi;
-
-    /* Handle dataset */
-    if (m_reBin > 0)
+    else if (m_reBin > 0)
     {
       int numEntries = datai->numEntries();
       int sumEntries = datai->sumEntries();
@@ -241,10 +389,23 @@ void splitter::makeWorkspace()
       if (isBinned)
       {
         subCat->setLabel(channelName, true);
-        subDataMap[channelName.Data()] = rebuildCatData(datai, indivObs);
+        if (m_lowMemory)
+        {
+          prof.mode = "streamed";
+          appendCatData(datai, streamData.get(), channelName);
+        }
+        else
+        {
+          RooDataSet *dataNew_i = createCatData(datai, indivObs);
+          catData.Add(dataNew_i);
+          fillJobs.push_back(std::make_pair(datai, dataNew_i));
+          fillProfiles.push_back(m_catProfiles.size() - 1);
+          subDataMap[channelName.Data()] = dataNew_i;
+        }
       }
       else
       {
+        prof.mode = "rebinned";
         TString dataiName = datai->GetName();
         spdlog::info("Rebin {}", dataiName.Data());
         datai->SetName((dataiName + "_old"));
@@ -265,80 +426,132 @@ void splitter::makeWorkspace()
           dataiNew->add(*indivObs, hist->GetBinContent(i));
         }
 
+        delete hist;
+
         subCat->setLabel(channelName, true);
-        subDataMap[channelName.Data()] = dataiNew;
-        m_keep.Add(dataiNew);
+        if (m_lowMemory)
+        {
+          appendCatData(dataiNew, streamData.get(), channelName);
+          delete dataiNew;
+        }
+        else
+        {
+          subDataMap[channelName.Data()] = dataiNew;
+          catData.Add(dataiNew);
+        }
       }
     }
+    else if (m_lowMemory)
+    {
+      prof.mode = "streamed";
+      appendCatData(datai, streamData.get(), channelName);
+    }
+    else
+    {
+      RooDataSet *dataNew_i = createCatData(datai, indivObs);
+      catData.Add(dataNew_i);
+      fillJobs.push_back(std::make_pair(datai, dataNew_i));
+      fillProfiles.push_back(m_catProfiles.size() - 1);
+      subDataMap[channelName.Data()] = dataNew_i;
+    }
+    /* in low-memory mode the reduced copy of this category is released here */
+  }
+
+  parIndex.fill(subPoi, subGobs, subCobs, subNuis);
+
+  /* Copy the category datasets. Every task only touches its own source and target
+     dataset, so the copies can run concurrently; the map above fixes the merge order */
+  auto fillJob = [this, &fillJobs, &fillProfiles](unsigned int i)
+  {
+    /* every job has its own profile entry */
+    profiling::PhaseTimer::Scope timer(m_catProfiles[fillProfiles[i]].timer, "fill");
+    fillCatData(fillJobs[i].first, fillJobs[i].second);
+  };
+  {
+    profiling::PhaseTimer::Scope timer(m_timer, "fill");
+    if (m_nThreads > 1 && fillJobs.size() > 1)
+    {
+      spdlog::info("Rebuilding {} category datasets with {} threads", fillJobs.size(), m_nThreads);
+      ROOT::EnableThreadSafety();
+      ROOT::TThreadExecutor pool(m_nThreads);
+      pool.Foreach(fillJob, ROOT::TSeqU(fillJobs.size()));
+    }
     else
-      subDataMap[channelName.Data()] = rebuildCatData(datai, indivObs);
+    {
+      for (unsigned int i = 0; i < fillJobs.size(); i++)
+        fillJob(i);
+    }
+  }
+  /* the split pieces of the input dataset are no longer needed */
+  if (m_dataList)
+  {
+    m_dataList->Delete();
+    delete m_dataList;
+    m_dataList = nullptr;
   }
+  m_catRows.clear();
 
   subComb->import(*subCat, RooFit::Silence());
 
   unique_ptr<RooSimultaneous> subPdf(new RooSimultaneous(m_pdf->GetName(), m_pdf->GetTitle(), subPdfMap, *subCat));
   if (m_editRFV >= 0)
   {
-    int i =0;
-    auto component_test = subPdf->getComponents();
-    std::size_t componentCount = component_test->size();
-    std::cout << "Size is :  " << componentCount << std::endl;
-    for (auto it = subPdf->getComponents()->begin(); it != subPdf->getComponents()->end(); ++it)
-    { 
-      if( i ==static_cast<int>(componentCount)){
-        break;
-      }
-      RooAbsArg *v = *it;
-      // if (!v){
-      //   std::cerr << "Error: Null pointer encountered!" << std::endl;
-      //   // continue;
-      //   break;
-      // }
-    //   try {
-    //     std::cout << "Processing component: " << v->GetName() << std::endl;
-    // } catch (const std::exception &e) {
-    //     std::cerr << "Error: Failed to get component name! Exception: " << e.what() << std::endl;
-    //     continue;
-    // }
-    if (i%100 ==0){std::cout<< "test a"<< i << std::endl;}
-        
-        const std::type_info &id = typeid(*v);
-     
-      if (id == typeid(RooFormulaVar))
-      {
-        RooFormulaVar *oldVar = dynamic_cast<RooFormulaVar *>(v);
-        std::unique_ptr<RooFormulaVar> newVar(editRFV(oldVar));
-        if (newVar)
-          subComb->import(*newVar, RooFit::RecycleConflictNodes());
-      }
-      // std::cout<< "test c"<< i << std::endl;
-      i++;}
-
+    profiling::PhaseTimer::Scope timer(m_timer, "editRFV");
+    /* One pass over a single snapshot of the components: editRFV rewrites every formula
+       once (dependents first) and the results are imported in that order, so the subPdf
+       import below picks up the edited formulas by name */
+    m_rfvMemo.clear();
+    m_rfvOrder.clear();
+    std::unique_ptr<RooArgSet> components(subPdf->getComponents());
+    spdlog::info("Checking {} components of {} for hard-coded RooFormulaVar", components->size(), subPdf->GetName());
+    for (RooAbsArg *v : *components)
+    {
+      if (typeid(*v) == typeid(RooFormulaVar))
+        editRFV(dynamic_cast<RooFormulaVar *>(v));
+    }
+    for (RooAbsReal *newVar : m_rfvOrder)
+      subComb->import(*newVar, RooFit::RecycleConflictNodes(), RooFit::Silence());
+    spdlog::info("{} RooFormulaVar rewritten", m_rfvOrder.size());
   }
 
-  subComb->import(*subPdf, RooFit::RecycleConflictNodes(), RooFit::Silence());
+  {
+    profiling::PhaseTimer::Scope timer(m_timer, "import");
+    subComb->import(*subPdf, RooFit::RecycleConflictNodes(), RooFit::Silence());
+  }
 
   subObs.add(*subCat);
-  RooRealVar weightVar(WGTNAME, "", 1);
-  RooArgSet obsAndWgt(subObs, weightVar);
-  unique_ptr<RooDataSet> subData(new RooDataSet(m_data->GetName(), m_data->GetTitle(), obsAndWgt, RooFit::Index(*subCat), RooFit::Import(subDataMap), RooFit::WeightVar(WGTNAME)));
+  unique_ptr<RooDataSet> subData;
+  if (m_lowMemory)
+    subData = std::move(streamData);
+  else
+  {
+    profiling::PhaseTimer::Scope timer(m_timer, "merge");
+    RooArgSet obsAndWgt(subObs, weightVar);
+    subData.reset(new RooDataSet(m_data->GetName(), m_data->GetTitle(), obsAndWgt, RooFit::Index(*subCat), RooFit::Import(subDataMap), RooFit::WeightVar(WGTNAME)));
+    /* the merged dataset holds its own copy of the categories */
+    subDataMap.clear();
+    catData.Delete();
+  }
 
   spdlog::debug("numEntries: {}", subData->numEntries());
   spdlog::debug("sumEntries: {}", subData->sumEntries());
 
-  subComb->import(*subData);
-  subComb->importClassCode();
-
-  unique_ptr<ModelConfig> subMc(new ModelConfig(m_mc->GetName(), subComb.get()));
-  subMc->SetWorkspace(*subComb);
-  subMc->SetPdf(*subPdf);
-  subMc->SetProtoData(*subData);
-  subMc->SetNuisanceParameters(subNuis);
-  subMc->SetGlobalObservables(subGobs);
-  subMc->SetConditionalObservables(subCobs);
-  subMc->SetParametersOfInterest(subPoi);
-  subMc->SetObservables(subObs);
-  subComb->import(*subMc);
+  {
+    profiling::PhaseTimer::Scope timer(m_timer, "import");
+    subComb->import(*subData);
+    subComb->importClassCode();
+
+    unique_ptr<ModelConfig> subMc(new ModelConfig(m_mc->GetName(), subComb.get()));
+    subMc->SetWorkspace(*subComb);
+    subMc->SetPdf(*subPdf);
+    subMc->SetProtoData(*subData);
+    subMc->SetNuisanceParameters(subNuis);
+    subMc->SetGlobalObservables(subGobs);
+    subMc->SetConditionalObservables(subCobs);
+    subMc->SetParametersOfInterest(subPoi);
+    subMc->SetObservables(subObs);
+    subComb->import(*subMc);
+  }
 
   /* Copy snapshots */
   for (auto snapshotName : m_snapshots)
@@ -353,11 +566,7 @@ void splitter::makeWorkspace()
   }
   m_inputFile->Close();
 
-  unique_ptr<TFile> outputFile(TFile::Open(m_outputFileName, "recreate"));
-  subComb->Write();
-  outputFile->Close();
-
-  spdlog::info("Output file {} saved", m_outputFileName.Data());
+  return subComb.release();
 }
 
 void splitter::buildSimPdf(RooAbsPdf *pdf, RooAbsData *data)
@@ -402,7 +611,11 @@ void splitter::histToDataset(RooDataHist *data)
 
   RooArgSet Observables;
   RooRealVar weightVar(WGTNAME, "", 1);
-  auto dataList = data->split(*m_cat, true);
+  unique_ptr<TList> dataList(data->split(*m_cat, true));
+  dataList->SetOwner(true);
+  /* the converted categories are copied into the combined dataset below */
+  TList converted;
+  converted.SetOwner(true);
 
   for (int ich = 0; ich < m_numChannels; ich++)
   {
@@ -416,14 +629,9 @@ void splitter::histToDataset(RooDataHist *data)
 
     TString dataName = datai->GetName();
     RooDataSet *data = new RooDataSet(dataName + "_convert", dataName + "_convert", obsAndWgt, WeightVar(weightVar));
-    m_keep.Add(data);
+    converted.Add(data);
 
-    for (int ievt = 0; ievt < datai->numEntries(); ++ievt)
-    {
-      *obsi = *datai->get(ievt);
-      double dataWgt = datai->weight();
-      data->add(obsAndWgt, dataWgt);
-    }
+    fillCatData(datai, data);
     Observables.add(*obsi);
     datasetMap[channelName.Data()] = data;
   }
@@ -436,6 +644,7 @@ void splitter::histToDataset(RooDataHist *data)
   m_data = combData;
 }
 
+/* returns pdfi itself or a new PDF owned by the caller */
 RooAbsPdf *splitter::rebuildCatPdf(RooAbsPdf *pdfi, RooAbsData *datai)
 {
   if (TString(pdfi->ClassName()) == "RooProdPdf")
@@ -447,120 +656,369 @@ RooAbsPdf *splitter::rebuildCatPdf(RooAbsPdf *pdfi, RooAbsData *datai)
     unique_ptr<RooArgSet> disConstraints(pdfi->getAllConstraints(*datai->get(), dPars, false));
     disConstraints->remove(*constraints);
 
-    RooArgSet baseComponents;
-    auxUtil::getBasePdf(dynamic_cast<RooProdPdf *>(pdfi), baseComponents);
     /* remove disconnected pdfs */
-    baseComponents.remove(*disConstraints);
-
-    TString newPdfName = TString(pdfi->GetName()) + "_deComposed";
-    pdfi = new RooProdPdf(newPdfName, newPdfName, baseComponents);
-    m_keep.Add(pdfi);
+    pdfi = prodWithout(dynamic_cast<RooProdPdf *>(pdfi), *disConstraints, TString(pdfi->GetName()) + "_deComposed");
   }
   return pdfi;
 }
 
+RooProdPdf *splitter::prodWithout(RooProdPdf *pdfi, const RooArgSet &dropped, const TString &newName)
+{
+  RooArgSet baseComponents;
+  auxUtil::getBasePdf(pdfi, baseComponents);
+  baseComponents.remove(dropped);
+  return new RooProdPdf(newName, newName, baseComponents);
+}
+
+/* the new dataset is owned by the caller */
 RooDataSet *splitter::rebuildCatData(RooAbsData *datai, RooArgSet *indivObs)
+{
+  RooDataSet *dataNew_i = createCatData(datai, indivObs);
+  fillCatData(datai, dataNew_i);
+  return dataNew_i;
+}
+
+/* Binned fast path. A category with a single observable whose entries all sit on the bin
+   centres of its RooRealSumPdf is the same likelihood binned or unbinned, so its data is
+   summed into a RooDataHist on the PDF binning and written back with exactly one entry
+   per bin, in bin order, which is the layout the binned NLL evaluation expects. The sum
+   PDF is flagged with the BinnedLikelihood attribute. The combined dataset has to stay a
+   RooDataSet indexed by the category, so the RooDataHist itself is not kept. Returns NULL
+   for categories that do not qualify, otherwise a new dataset owned by the caller */
+RooDataSet *splitter::binnedCatData(RooAbsPdf *pdfi, RooAbsData *datai, RooArgSet *indivObs)
+{
+  if (indivObs->getSize() != 1)
+    return nullptr;
+  RooRealVar *obsVar = dynamic_cast<RooRealVar *>(indivObs->first());
+  if (!obsVar)
+    return nullptr;
+
+  /* the binned NLL only applies to a RooRealSumPdf, it must be unique in the category */
+  RooRealSumPdf *sumPdf = nullptr;
+  unique_ptr<RooArgSet> components(pdfi->getComponents());
+  for (RooAbsArg *arg : *components)
+  {
+    RooRealSumPdf *candidate = dynamic_cast<RooRealSumPdf *>(arg);
+    if (!candidate || !candidate->dependsOn(*obsVar))
+      continue;
+    if (sumPdf)
+      return nullptr;
+    sumPdf = candidate;
+  }
+  if (!sumPdf)
+    return nullptr;
+
+  unique_ptr<std::list<double>> bounds(sumPdf->binBoundaries(*obsVar, obsVar->getMin(), obsVar->getMax()));
+  if (!bounds || bounds->size() < 2)
+    return nullptr;
+  std::vector<double> edges(bounds->begin(), bounds->end());
+  RooBinning binning(edges.size() - 1, edges.data());
+
+  /* exact only if every entry is a bin centre; unbinned data fails on the first entries */
+  const RooArgSet *sourceRow = datai->get();
+  RooRealVar *sourceVar = dynamic_cast<RooRealVar *>(sourceRow->find(obsVar->GetName()));
+  if (!sourceVar)
+    return nullptr;
+  for (int j = 0, nEntries = datai->numEntries(); j < nEntries; ++j)
+  {
+    datai->get(j);
+    const double x = sourceVar->getVal();
+    const int bin = binning.binNumber(x);
+    if (std::abs(x - binning.binCenter(bin)) > 1e-6 * binning.binWidth(bin))
+      return nullptr;
+  }
+
+  obsVar->setBinning(binning);
+  RooDataHist hist(TString(datai->GetName()) + "_hist", "", *indivObs, *datai);
+  RooDataSet *dataNew_i = createCatData(datai, indivObs);
+  fillCatData(&hist, dataNew_i);
+  sumPdf->setAttribute("BinnedLikelihood");
+  spdlog::info("\tBinned likelihood for {}: {} entries -> {} bins", sumPdf->GetName(), datai->numEntries(), binning.numBins());
+  return dataNew_i;
+}
+
+RooDataSet *splitter::createCatData(RooAbsData *datai, RooArgSet *indivObs)
 {
   RooRealVar weight(WGTNAME, "", 1.);
   RooArgSet obsAndWgt(*indivObs, weight);
 
-  RooDataSet *dataNew_i = new RooDataSet(TString(datai->GetName()) + PDFPOSTFIX, "", obsAndWgt, WeightVar(WGTNAME));
+  return new RooDataSet(TString(datai->GetName()) + PDFPOSTFIX, "", obsAndWgt, WeightVar(WGTNAME));
+}
+
+RooDataSet *splitter::getCatData(const TString &channelName, std::unique_ptr<RooDataSet> &owned)
+{
+  if (m_lowMemory)
+  {
+    /* one pass over the input sorts its rows by category; only the row numbers are kept,
+       so each category is then copied from its own rows instead of a cut over all entries.
+       The rows are keyed by the index of the dataset's own category, which need not number
+       the states as m_cat does */
+    RooAbsCategory *dataCat = dynamic_cast<RooAbsCategory *>(m_data->get()->find(m_cat->GetName()));
+    if (!dataCat)
+      auxUtil::alertAndAbort(Form("Dataset %s has no category %s", m_data->GetName(), m_cat->GetName()));
+    if (m_catRows.empty())
+    {
+      profiling::PhaseTimer::Scope timer(m_timer, "split");
+      for (int j = 0, nEntries = m_data->numEntries(); j < nEntries; ++j)
+      {
+        m_data->get(j);
+        m_catRows[dataCat->getCurrentIndex()].push_back(j);
+      }
+    }
+    RooRealVar weight(WGTNAME, "", 1.);
+    RooArgSet varsAndWgt(*m_data->get(), weight);
+    owned.reset(new RooDataSet(channelName, m_data->GetTitle(), varsAndWgt, RooFit::WeightVar(WGTNAME)));
+    RooArgSet row(*owned->get());
+    for (int j : m_catRows[dataCat->lookupIndex(channelName.Data())])
+    {
+      row.assign(*m_data->get(j));
+      owned->add(row, m_data->weight());
+    }
+    return owned.get();
+  }
+  if (!m_dataList)
+  {
+    profiling::PhaseTimer::Scope timer(m_timer, "split");
+    m_dataList = m_data->split(*m_cat, true);
+  }
+  return dynamic_cast<RooDataSet *>(m_dataList->FindObject(channelName));
+}
+
+void splitter::appendCatData(RooAbsData *datai, RooDataSet *combData, const TString &channelName)
+{
+  RooArgSet row(*combData->get());
+  RooCategory *cat = dynamic_cast<RooCategory *>(row.find(m_cat->GetName()));
+  const int catIndex = cat->lookupIndex(channelName.Data());
+  for (int j = 0, nEntries = datai->numEntries(); j < nEntries; ++j)
+  {
+    /* the source rows may carry the input category, whose indices can differ */
+    row.assign(*datai->get(j));
+    cat->setIndex(catIndex);
+    combData->add(row, datai->weight());
+  }
+}
 
+void splitter::fillCatData(RooAbsData *datai, RooDataSet *dataNew_i)
+{
+  if (m_fastFill && fillCatDataFast(datai, dataNew_i))
+    return;
+
+  /* Go through the row of the new dataset rather than the pdf observables,
+     which can be shared between categories */
+  RooArgSet row(*dataNew_i->get());
   for (int j = 0, nEntries = datai->numEntries(); j < nEntries; ++j)
   {
-    *indivObs = *datai->get(j);
+    row.assign(*datai->get(j));
     double dataWgt = datai->weight();
-    dataNew_i->add(obsAndWgt, dataWgt);
+    dataNew_i->add(row, dataWgt);
   }
+}
 
-  m_keep.Add(dataNew_i);
-  return dataNew_i;
+bool splitter::fillCatDataFast(RooAbsData *datai, RooDataSet *dataNew_i)
+{
+  /* Path for the common case of real-valued observables plus a weight: the source is read
+     as whole columns instead of one row set per entry, and the target row is filled without
+     name look-ups. The rows are still added one by one, RooDataSet has no bulk append. */
+  const std::size_t nEntries = datai->numEntries();
+  if (nEntries == 0)
+    return true;
+
+  RooArgSet row(*dataNew_i->get());
+  const RooArgSet *sourceRow = datai->get();
+  auto columns = datai->getBatches(0, nEntries);
+
+  std::vector<RooRealVar *> targets;
+  std::vector<decltype(columns.begin()->second)> sources;
+  for (RooAbsArg *arg : row)
+  {
+    RooRealVar *target = dynamic_cast<RooRealVar *>(arg);
+    RooAbsArg *source = sourceRow->find(arg->GetName());
+    if (!target || !source)
+      return false;
+    auto found = columns.find(source);
+    if (found == columns.end() || found->second.size() != nEntries)
+      return false;
+    /* setVal clips to the range of the target, assign copies as is: the dataset goes to the
+       row-wise copy as a whole if the range of the source observable, which bounds its
+       values, is not inside the range of the target; no check per value */
+    RooRealVar *sourceVar = dynamic_cast<RooRealVar *>(source);
+    if (!sourceVar || sourceVar->getMin() < target->getMin() || sourceVar->getMax() > target->getMax())
+      return false;
+    targets.push_back(target);
+    sources.push_back(found->second);
+  }
+
+  auto weights = datai->getWeightBatch(0, nEntries);
+  const bool hasWeights = (weights.size() == nEntries);
+
+  for (std::size_t j = 0; j < nEntries; ++j)
+  {
+    for (std::size_t k = 0; k < targets.size(); ++k)
+      targets[k]->setVal(sources[k][j]);
+    dataNew_i->addFast(row, hasWeights ? weights[j] : 1.);
+  }
+  return true;
+}
+
+/* Replace the dependent names in a hard-coded expression by @i in a single left-to-right
+   scan. Identifiers are matched as whole tokens, so a name that is a prefix of another one
+   can no longer be mis-replaced, and numeric literals such as 1e-3 are skipped as a whole. */
+TString splitter::tokenizeRFV(const TString &formExpr, const std::unordered_map<std::string, int> &indexOf)
+{
+  const std::string in = formExpr.Data();
+  std::string out;
+  out.reserve(in.size());
+  std::size_t i = 0;
+  while (i < in.size())
+  {
+    const char c = in[i];
+    std::size_t j = i + 1;
+    if (isalpha(c) || c == '_')
+    {
+      while (j < in.size() && (isalnum(in[j]) || in[j] == '_'))
+        j++;
+      const std::string token = in.substr(i, j - i);
+      auto found = indexOf.find(token);
+      if (found != indexOf.end())
+        out += "@" + std::to_string(found->second);
+      else
+        out += token;
+    }
+    else if (isdigit(c) || c == '.')
+    {
+      while (j < in.size() && (isalnum(in[j]) || in[j] == '.' || ((in[j] == '+' || in[j] == '-') && (in[j - 1] == 'e' || in[j - 1] == 'E'))))
+        j++;
+      out += in.substr(i, j - i);
+    }
+    else
+      out += c;
+    i = j;
+  }
+  return out.c_str();
 }
 
-RooFormulaVar *splitter::editRFV(RooFormulaVar *oldVar)
+/* Returns the rewritten RooFormulaVar (or its EFTPolynomial under mode 3), or NULL if oldVar
+   can be used as it is. Results are memoized in m_rfvMemo so that a formula shared by several
+   clients is rewritten once, and every new formula is appended to m_rfvOrder after its
+   dependents (import order). */
+RooAbsReal *splitter::editRFV(RooFormulaVar *oldVar)
 {
-  // std::cout << __PRETTY_FUNCTION__ << std::endl;
   assert(oldVar);
+  auto memo = m_rfvMemo.find(oldVar);
+  if (memo != m_rfvMemo.end())
+    return memo->second;
+
   TString varName = oldVar->GetName();
   TString formExpr = oldVar->expression();
   spdlog::info("Edit RooFormulaVar {} with expression {}...", varName.Data(), formExpr.Data());
+
+  TString newFormExpr = formExpr;
   // Not hard-coded
   if (formExpr.Contains('@'))
   {
-    spdlog::info("No change needed");
-    return NULL;
+    if (m_editRFV < 3)
+    {
+      spdlog::info("No change needed");
+      m_rfvMemo[oldVar] = NULL;
+      return NULL;
+    }
   }
-  // Hard-coded
-  else
+  // TFormula format
+  else if (formExpr.Contains("x[") && formExpr.Contains("]"))
   {
-    TString newFormExpr = formExpr;
-    // TFormula format
-    if (formExpr.Contains("x[") && formExpr.Contains("]"))
+    if (m_editRFV < 2)
     {
-      if (m_editRFV < 2)
-      {
-        spdlog::info("No change introduced under mode {}", m_editRFV);
-        return NULL;
-      }
-
-      newFormExpr = newFormExpr.ReplaceAll("x[", "@");
-      newFormExpr = newFormExpr.ReplaceAll("]", "");
+      spdlog::info("No change introduced under mode {}", m_editRFV);
+      m_rfvMemo[oldVar] = NULL;
+      return NULL;
     }
-    // Hard-code format
-    else
-    {
-      if (m_editRFV < 1)
-      {
-        spdlog::info("No change introduced under mode {}", m_editRFV);
-        return NULL;
-      }
 
-      int num = oldVar->dependents().size();
-      std::vector<TString> allOldNames;
-      std::vector<int> indice;
-      std::vector<int> nameLength;
-      std::map<TString, TString> reNameMap;
+    newFormExpr = newFormExpr.ReplaceAll("x[", "@");
+    newFormExpr = newFormExpr.ReplaceAll("]", "");
+  }
+  // Hard-code format
+  else
+  {
+    if (m_editRFV < 1)
+    {
+      spdlog::info("No change introduced under mode {}", m_editRFV);
+      m_rfvMemo[oldVar] = NULL;
+      return NULL;
+    }
 
-      for (int i = 0; i < num; i++)
+    int num = oldVar->dependents().size();
+    std::unordered_map<std::string, int> indexOf;
+    std::vector<int> indice;
+    std::vector<int> nameLength;
+    for (int i = 0; i < num; i++)
+    {
+      TString oldName = oldVar->getParameter(i)->GetName();
+      bool isToken = oldName.Length() > 0 && (isalpha(oldName[0]) || oldName[0] == '_');
+      for (int k = 1; isToken && k < oldName.Length(); k++)
+        isToken = isalnum(oldName[k]) || oldName[k] == '_';
+      if (isToken)
+        indexOf[oldName.Data()] = i;
+      else
       {
-        TString oldName = oldVar->getParameter(i)->GetName();
-        TString newName = TString::Format("@%d", i);
+        // Names that are not plain identifiers cannot be tokenized, fall back to text replacement
         indice.push_back(i);
         nameLength.push_back(oldName.Length());
-        allOldNames.push_back(oldName);
-        reNameMap[oldName] = newName;
-      }
-      // Important: replace the long ones first, so that there is no mis-replacement
-      TMath::Sort(num, &nameLength[0], &indice[0], true);
-      for (int i = 0; i < num; i++)
-      {
-        int index = indice[i];
-        TString oldName = allOldNames[index];
-        TString newName = reNameMap[oldName];
-        newFormExpr = newFormExpr.ReplaceAll(oldName, newName);
       }
     }
-    spdlog::warn("Replace it with new expression {}", newFormExpr.Data());
-    // Create new RooRealVar with the same name but updated expression
-    RooArgSet varList;
+    // Important: replace the long ones first, so that there is no mis-replacement
+    int numIrregular = indice.size();
+    std::vector<int> order(numIrregular);
+    if (numIrregular > 0)
+      TMath::Sort(numIrregular, &nameLength[0], &order[0], true);
+    for (int i = 0; i < numIrregular; i++)
+    {
+      int index = indice[order[i]];
+      newFormExpr = newFormExpr.ReplaceAll(oldVar->getParameter(index)->GetName(), TString::Format("@%d", index));
+    }
+    newFormExpr = tokenizeRFV(newFormExpr, indexOf);
+  }
+  // Create new RooRealVar with the same name but updated expression
+  RooArgSet varList;
 
-    // If a variable is already in the output workspace, it means that it has been edited before
-    // In this case, the updated variable should be used instead
-    for (auto it = oldVar->dependents().begin(); it != oldVar->dependents().end(); ++it)
+  // Dependent formulas are rewritten first (or taken from the memo); those that need no
+  // change are used as they are
+  for (RooAbsArg *parg : oldVar->dependents())
+  {
+    if (typeid(*parg) == typeid(RooFormulaVar))
     {
-      RooAbsArg *parg = *it;
-      const std::type_info &id = typeid(*parg);
-      if (id == typeid(RooFormulaVar))
-      {
-        spdlog::warn("The dependents of {} also contains RooFormulaVar. Updating it as well", varName.Data());
-        RooFormulaVar *newParg = editRFV(dynamic_cast<RooFormulaVar *>(parg));
-        m_keep.Add(newParg);
-        varList.add(*newParg);
-      }
-      else
-        varList.add(*parg);
+      spdlog::warn("The dependents of {} also contains RooFormulaVar. Updating it as well", varName.Data());
+      RooAbsReal *newParg = editRFV(dynamic_cast<RooFormulaVar *>(parg));
+      varList.add(newParg ? *newParg : *parg);
     }
+    else
+      varList.add(*parg);
+  }
 
-    return new RooFormulaVar(varName, newFormExpr, varList);
+  if (m_editRFV >= 3 && eftPolynomial::speedsUp("cpu"))
+  {
+    RooAbsReal *poly = eftPolynomial::fromFormula(*oldVar, newFormExpr, RooArgList(varList));
+    if (poly)
+    {
+      spdlog::warn("Replace it with {}", poly->ClassName());
+      m_keep.Add(poly);
+      m_rfvMemo[oldVar] = poly;
+      m_rfvOrder.push_back(poly);
+      return poly;
+    }
+    // the dependents are picked up by name on import, no new formula needed
+    if (newFormExpr == formExpr)
+    {
+      spdlog::info("Not a linear or quadratic polynomial, no change needed");
+      m_rfvMemo[oldVar] = NULL;
+      return NULL;
+    }
   }
+  spdlog::warn("Replace it with new expression {}", newFormExpr.Data());
+  RooFormulaVar *newVar = new RooFormulaVar(varName, newFormExpr, varList);
+  m_keep.Add(newVar);
+  m_rfvMemo[oldVar] = newVar;
+  m_rfvOrder.push_back(newVar);
+  return newVar;
 }
+
+} // namespace hvvcp
@@ -0,0 +1,176 @@
+/*
+ * =====================================================================================
+ *
+ *       Filename:  splitter.h
+ *
+ *    Description:  Workspace splitter
+ *
+ *        Version:  1.0
+ *        Created:  05/19/2012 10:09:55 PM
+ *       Revision:  12/27/20 during pandemic
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoshuang Ji, haoshuang.ji@cern.ch
+ *                  Hongtao Yang, Hongtao.Yang@cern.ch
+ *   Organization:  University of Wisconsin
+ *                  Lawrence Berkeley National Lab
+ *
+ * =====================================================================================
+ */
+
+#ifndef SPLITTER_HEADER
+#define SPLITTER_HEADER
+
+#include "CommonHead.h"
+#include "RooFitHead.h"
+#include "RooStatsHead.h"
+#include "auxUtil.h"
+#include "profileReport.h"
+
+#include <ROOT/TThreadExecutor.hxx>
+#include "RooRealSumPdf.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+/* Our copy of the splitter lives in its own namespace: the scripts also load
+   libworkspaceCombiner (for auxUtil), which exports the upstream splitter class under
+   the global name, with a different layout */
+namespace hvvcp
+{
+
+/* Name -> role look-up of the ModelConfig parameter sets, built once per input
+   workspace so that classifying the parameters of every category is a hash look-up */
+class parameterIndex
+{
+public:
+  enum Role
+  {
+    POI = 0,
+    GLOB,
+    COBS,
+    NUIS,
+    NROLES
+  };
+
+  parameterIndex(RooStats::ModelConfig *mc, bool hasCondObs = true);
+
+  /* role of v (NROLES for constant parameters); var is set to the ModelConfig instance */
+  Role classify(RooRealVar *v, RooRealVar *&var) const;
+  /* classify the parameters and remember each of them once, in first-seen order */
+  void collect(const RooArgSet &params);
+  /* add everything collected so far to the output sets */
+  void fill(RooArgSet &poi, RooArgSet &gobs, RooArgSet &cobs, RooArgSet &nuis) const;
+
+private:
+  std::unordered_map<std::string, std::pair<Role, RooRealVar *>> m_index;
+  std::unordered_set<const RooAbsArg *> m_seen[NROLES];
+  std::vector<RooRealVar *> m_selected[NROLES];
+};
+
+class splitter
+{
+public:
+  splitter(TString inputFileName,
+           TString outputFileName,
+           TString wsName = "combWS",
+           TString mcName = "ModelConfig",
+           TString dataName = "combData");
+  ~splitter() {}
+
+  void printSummary();
+  void fillIndices(TString indices);
+  void makeWorkspace();
+  /* same as makeWorkspace but returns the workspace (owned by the caller) instead of writing it */
+  RooWorkspace *buildWorkspace();
+
+  void setReBin(int reBin) { m_reBin = reBin; }
+  void setRebuildPdf(bool rebuildPdf) { m_rebuildPdf = rebuildPdf; }
+  /* formula rewriting, see editRFV: 0 none, 1 hard-coded names, 2 also TFormula x[i],
+     3 also polynomial formulas to EFTPolynomial nodes (eftPolynomial.h; from ROOT 6.30,
+     before that 3 acts as 2, the node not being faster than the formula there) */
+  void setEditRFV(int editRFV) { m_editRFV = editRFV; }
+  void setSnapshots(std::vector<TString> snapshots) { m_snapshots = snapshots; }
+  /* number of threads used to rebuild the per-category datasets, 1 = serial */
+  void setNumThreads(int nThreads) { m_nThreads = nThreads; }
+  /* process one category at a time without splitting the full dataset, see makeWorkspace */
+  void setLowMemory(bool lowMemory) { m_lowMemory = lowMemory; }
+  /* keep categories whose entries are bin centres binned and flag them for the binned
+     likelihood, see binnedCatData */
+  void setBinned(bool binned) { m_binned = binned; }
+  /* column-wise copy of the category data (fillCatDataFast); false keeps the row-wise
+     copy of fillCatData, the baseline for benchmarkSplit.C */
+  void setFastFill(bool fastFill) { m_fastFill = fastFill; }
+  /* phase timers and per-category costs of the input load and the last buildWorkspace
+     as JSON; makeWorkspace writes them next to the output file (<output>.profile.json) */
+  void writeProfile(TString fileName) const;
+  /* pdfi rebuilt from its base terms without the dropped ones (owned by the caller), as
+     rebuildCatPdf strips the disconnected constraints; also used by reduceWorkspace.C */
+  static RooProdPdf *prodWithout(RooProdPdf *pdfi, const RooArgSet &dropped, const TString &newName);
+
+  static TString WGTNAME;
+  static TString PDFPOSTFIX;
+
+private:
+  void buildSimPdf(RooAbsPdf *pdf, RooAbsData *data);
+  void histToDataset(RooDataHist *data);
+  RooAbsPdf *rebuildCatPdf(RooAbsPdf *pdfi, RooAbsData *datai);
+  RooDataSet *rebuildCatData(RooAbsData *datai, RooArgSet *indivObs);
+  RooDataSet *binnedCatData(RooAbsPdf *pdfi, RooAbsData *datai, RooArgSet *indivObs);
+  RooDataSet *createCatData(RooAbsData *datai, RooArgSet *indivObs);
+  void fillCatData(RooAbsData *datai, RooDataSet *dataNew_i);
+  bool fillCatDataFast(RooAbsData *datai, RooDataSet *dataNew_i);
+  RooDataSet *getCatData(const TString &channelName, std::unique_ptr<RooDataSet> &owned);
+  void appendCatData(RooAbsData *datai, RooDataSet *combData, const TString &channelName);
+  RooAbsReal *editRFV(RooFormulaVar *oldVar);
+  static TString tokenizeRFV(const TString &formExpr, const std::unordered_map<std::string, int> &indexOf);
+
+  /* wall time of one category in buildWorkspace */
+  struct catProfile
+  {
+    std::string name;
+    std::string mode;
+    int numEntries;
+    double sumEntries;
+    profiling::PhaseTimer timer;
+  };
+
+  TString m_outputFileName;
+  std::unique_ptr<TFile> m_inputFile;
+  RooWorkspace *m_comb;
+  RooStats::ModelConfig *m_mc;
+  RooSimultaneous *m_pdf;
+  RooCategory *m_cat;
+  RooDataSet *m_data;
+  TList *m_dataList;
+  /* low-memory mode: row numbers of m_data per index of its category, filled on first use */
+  std::unordered_map<int, std::vector<int>> m_catRows;
+
+  int m_numChannels;
+  bool m_hasCondObs;
+  std::vector<int> m_useIndices;
+  std::vector<TString> m_snapshots;
+
+  int m_reBin;
+  bool m_rebuildPdf;
+  int m_editRFV;
+  int m_nThreads;
+  bool m_lowMemory;
+  bool m_binned;
+  bool m_fastFill;
+
+  /* editRFV memo: old formula -> rewritten one (NULL if unchanged), and the rewritten
+     formulas in dependency order */
+  std::unordered_map<RooFormulaVar *, RooAbsReal *> m_rfvMemo;
+  std::vector<RooAbsReal *> m_rfvOrder;
+
+  /* objects created on the fly that must live until the output is written */
+  TList m_keep;
+
+  profiling::PhaseTimer m_timer;
+  std::vector<catProfile> m_catProfiles;
+};
+
+} // namespace hvvcp
+
+#endif
@@ -1,3 +1,4 @@
 cd /project/atlas/users/mfernand/software/workspaceCombiner
 source setup_lxplus.sh
-root -l "replace_POI_with_product.C+"
\ No newline at end of file
+# (groupByFile, nWorkers): one worker process per workspace file
+root -l -b -q "replace_POI_with_product.C+(true, 8)"
\ No newline at end of file
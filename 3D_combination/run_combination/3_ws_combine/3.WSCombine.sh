@@ -1,3 +1,9 @@
 #manager -w combine -x combine_CP_linear_obs.xml
 
 manager -w combine -x combine_CP_quad_obs.xml
+
+# in-project combiner, same XML (see ../README.md)
+#bash nativeCombine.sh combine_CP_quad_obs.xml
+
+# one key per category for faster, partial loading by the fit server (see ../README.md)
+#root -l -b -q 'splitCombined.C+("../combined_ws/combined_quad_obs.root")'
@@ -0,0 +1,61 @@
+#!/usr/bin/env bash
+# =============================================================================
+# benchmark_combine.sh - Native combiner vs `manager -w combine`
+# =============================================================================
+# Runs both tools on the same combination XML, reports wall time and peak
+# memory, and checks that the two outputs describe the same likelihood.
+#
+# Usage:
+#   ./benchmark_combine.sh [config.xml ...]
+#   (default: combine_CP_linear_obs.xml combine_CP_quad_obs.xml)
+# =============================================================================
+
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+WORK_DIR="${WORK_DIR:-$(mktemp -d)}"
+
+usage() {
+    cat << USAGE
+Usage: $(basename "$0") [config.xml ...]
+
+Outputs and logs are written to \$WORK_DIR (default: a new temporary directory).
+USAGE
+}
+
+if [[ "${1:-}" == "-h" || "${1:-}" == "--help" ]]; then
+    usage
+    exit 0
+fi
+
+CONFIGS=("$@")
+if [[ ${#CONFIGS[@]} -eq 0 ]]; then
+    CONFIGS=("${SCRIPT_DIR}/combine_CP_linear_obs.xml" "${SCRIPT_DIR}/combine_CP_quad_obs.xml")
+fi
+
+# wall seconds and peak RSS (kB) of a command, written to $1
+timed() {
+    local out="$1"
+    shift
+    /usr/bin/time -f "%e %M" -o "${out}" "$@"
+}
+
+printf "%-28s %12s %12s %14s %14s %8s\n" "config" "manager[s]" "native[s]" "manager[MB]" "native[MB]" "result"
+for config in "${CONFIGS[@]}"; do
+    tag="$(basename "${config}" .xml)"
+    # point the external tool at the work directory without touching the original XML
+    sed -E "s|OutputFile=\"[^\"]*\"|OutputFile=\"${WORK_DIR}/${tag}_manager.root\"|" "${config}" > "${WORK_DIR}/${tag}.xml"
+
+    timed "${WORK_DIR}/${tag}_manager.time" manager -w combine -x "${WORK_DIR}/${tag}.xml" > "${WORK_DIR}/${tag}_manager.log" 2>&1
+    timed "${WORK_DIR}/${tag}_native.time" bash "${SCRIPT_DIR}/nativeCombine.sh" "${config}" "${WORK_DIR}/${tag}_native.root" > "${WORK_DIR}/${tag}_native.log" 2>&1
+
+    result="MATCH"
+    root -l -b -q "${SCRIPT_DIR}/compareCombined.C+(\"${WORK_DIR}/${tag}_manager.root\", \"${WORK_DIR}/${tag}_native.root\")" \
+        > "${WORK_DIR}/${tag}_compare.log" 2>&1 || result="MISMATCH"
+
+    read -r t_manager m_manager < "${WORK_DIR}/${tag}_manager.time"
+    read -r t_native m_native < "${WORK_DIR}/${tag}_native.time"
+    printf "%-28s %12s %12s %14d %14d %8s\n" "${tag}" "${t_manager}" "${t_native}" \
+        "$((m_manager / 1024))" "$((m_native / 1024))" "${result}"
+done
+echo "Logs and outputs in ${WORK_DIR}"
@@ -0,0 +1,41 @@
+#!/usr/bin/env bash
+# =============================================================================
+# nativeCombine.sh - Combine channel workspaces without `manager -w combine`
+# =============================================================================
+# Builds the combined workspace described by a combine_CP_*.xml file with the
+# in-project combiner (1_ws_editing/nativeCombiner.{h,cxx}).
+#
+# Usage:
+#   ./nativeCombine.sh combine_CP_quad_obs.xml [output.root]
+# =============================================================================
+
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+# workspaceCombiner checkout providing CommonHead.h, auxUtil.h and the library
+WSC_DIR="${WSC_DIR:-/project/atlas/users/mfernand/software/workspaceCombiner}"
+WSC_INC="${WSC_INC:-${WSC_DIR}/inc}"
+WSC_LIB="${WSC_LIB:-${WSC_DIR}/lib/libworkspaceCombiner}"
+
+usage() {
+    cat << USAGE
+Usage: $(basename "$0") <config.xml> [output.root]
+
+  config.xml    Combination XML (same format as manager -w combine -x)
+  output.root   Output file (default: OutputFile attribute of the XML)
+
+Environment: WSC_DIR, WSC_INC, WSC_LIB locate the workspaceCombiner build.
+USAGE
+}
+
+if [[ $# -lt 1 || "$1" == "-h" || "$1" == "--help" ]]; then
+    usage
+    exit 1
+fi
+
+CONFIG="$1"
+OUTPUT="${2:-}"
+
+root -l -b -q \
+    -e "gSystem->AddIncludePath(\"-I${WSC_INC}\"); gSystem->Load(\"${WSC_LIB}\");" \
+    "${SCRIPT_DIR}/nativeCombine.C+(\"${CONFIG}\", \"${OUTPUT}\")"
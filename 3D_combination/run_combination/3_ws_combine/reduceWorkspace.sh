@@ -0,0 +1,82 @@
+#!/usr/bin/env bash
+# =============================================================================
+# reduceWorkspace.sh - Reduced combined workspace for stat-only fits
+# =============================================================================
+# Fixes the NPs of a systematics configuration of the scan config and takes
+# them out of the combined workspace (reduceWorkspace.C): functions of the
+# fixed NPs are folded into constants and their constraint terms dropped.
+# The scan scripts use the output for that configuration when it is listed
+# as reduced_paths of the workspace in the scan config.
+#
+# Usage:
+#   ./reduceWorkspace.sh --systematics stat_only combined_linear_obs.root combined_linear_obs_stat_only.root
+#   ./reduceWorkspace.sh --nps "ATLAS_JES*,ATLAS_EG*" combined_linear_obs.root reduced.root
+# =============================================================================
+
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+SCRIPTS_DIR="$(cd "${SCRIPT_DIR}/../../scripts" && pwd)"
+# workspaceCombiner checkout providing CommonHead.h, auxUtil.h and the library
+WSC_DIR="${WSC_DIR:-/project/atlas/users/mfernand/software/workspaceCombiner}"
+WSC_INC="${WSC_INC:-${WSC_DIR}/inc}"
+WSC_LIB="${WSC_LIB:-${WSC_DIR}/lib/libworkspaceCombiner}"
+
+usage() {
+    cat << USAGE
+Usage: $(basename "$0") [options] <input.root> <output.root>
+
+  --systematics <name>  Fix the NPs (fix_nps, fix_nps_file, exclude_nps) of this systematics
+                        configuration of the scan config (default: stat_only)
+  --config <file>       Scan config (default: scripts/configs/hvv_cp_combination.yaml)
+  --nps <patterns>      Comma-separated NP wildcards instead of the config ones
+  --data <names>        Comma-separated datasets copied, the first one is used
+                        by the check (default: combData)
+  --workspace <name>    Workspace name (default: combWS)
+  --no-check            Skip the comparison of the full and reduced NLL
+
+Environment: WSC_DIR, WSC_INC, WSC_LIB locate the workspaceCombiner build.
+USAGE
+}
+
+SYSTEMATICS="stat_only"
+CONFIG="${SCRIPTS_DIR}/configs/hvv_cp_combination.yaml"
+NPS=""
+DATA="combData"
+WORKSPACE="combWS"
+CHECK="true"
+while [[ $# -gt 0 && "$1" == -* ]]; do
+    case "$1" in
+        --systematics) SYSTEMATICS="$2"; shift 2 ;;
+        --config)      CONFIG="$2"; shift 2 ;;
+        --nps)         NPS="$2"; shift 2 ;;
+        --data)        DATA="$2"; shift 2 ;;
+        --workspace)   WORKSPACE="$2"; shift 2 ;;
+        --no-check)    CHECK="false"; shift ;;
+        -h|--help)     usage; exit 0 ;;
+        *)             echo "Unknown option: $1" >&2; usage; exit 1 ;;
+    esac
+done
+
+if [[ $# -ne 2 ]]; then
+    usage
+    exit 1
+fi
+INPUT="$1"
+OUTPUT="$2"
+
+if [[ -z "${NPS}" ]]; then
+    CONFIG="$(cd "$(dirname "${CONFIG}")" && pwd)/$(basename "${CONFIG}")"
+    NPS="$(cd "${SCRIPTS_DIR}" && python3 -c "
+import sys
+from utils.config import AnalysisConfig
+print(AnalysisConfig.from_yaml(sys.argv[1]).get_exclude_nps_pattern(sys.argv[2]))" "${CONFIG}" "${SYSTEMATICS}")"
+fi
+if [[ -z "${NPS}" ]]; then
+    echo "No NPs to fix for ${SYSTEMATICS} in ${CONFIG}" >&2
+    exit 1
+fi
+
+root -l -b -q \
+    -e "gSystem->AddIncludePath(\"-I${WSC_INC}\"); gSystem->Load(\"${WSC_LIB}\");" \
+    "${SCRIPT_DIR}/reduceWorkspace.C+(\"${INPUT}\", \"${OUTPUT}\", \"${NPS}\", \"${DATA}\", \"${WORKSPACE}\", \"ModelConfig\", ${CHECK})"
@@ -0,0 +1,415 @@
+// Split layout of a combined workspace, for jobs that only need part of the model or that
+// are dominated by reading it. splitCombined.C writes it:
+//   splitModel          TNamed, title "<wsName>/<mcName>/<pdfName>"
+//   category            the RooCategory indexing the RooSimultaneous
+//   channels            TTree, one entry per category: label, index, pdf name, observables
+//                       and parameters of its pdf (comma separated)
+//   pois nuis globs cobs parameters
+//                       RooArgSet snapshots of the ModelConfig sets and of all parameters
+//   channel_<label>     RooWorkspace holding only the pdf of that category
+//   <data>_<label>      TTree with the entries of dataset <data> in that category, one
+//                       branch per observable and "weight"
+// so every category can be read on its own. load() puts the requested categories back
+// together into a workspace with the RooSimultaneous, the dataset and the ModelConfig of
+// the original names. A category is loaded if its label or one of its parameters matches
+// the requested patterns, or if it shares a floating parameter with a loaded category:
+// the categories left out are not connected to anything that floats or moves, so at the
+// minimum they only add a constant to the NLL. The caller must therefore name every
+// parameter its fits float or move; with all NPs floating every category is connected
+// and the whole model is loaded. The data trees are read and decompressed in parallel,
+// one task per category on a thread pool that load() creates once and that is gone when
+// it returns (the fit server and nativeAsimov.C fork afterwards); the pdfs are streamed
+// one after the other, since the RooFit streamers share the global name registry. LZ4 (compression 404, the default of splitCombined.C)
+// decompresses several times faster than the ZLIB default of the combined files.
+// Snapshots are not carried over.
+#include <TFile.h>
+#include <TKey.h>
+#include <TNamed.h>
+#include <TTree.h>
+#include <TRegexp.h>
+#include <TString.h>
+#include <TObjArray.h>
+#include <TObjString.h>
+#include <ROOT/TSeq.hxx>
+#include <ROOT/TThreadExecutor.hxx>
+#include <RooWorkspace.h>
+#include <RooRealVar.h>
+#include <RooCategory.h>
+#include <RooSimultaneous.h>
+#include <RooAbsPdf.h>
+#include <RooAbsData.h>
+#include <RooDataSet.h>
+#include <RooArgSet.h>
+#include <RooGlobalFunc.h>
+#include <RooStats/ModelConfig.h>
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace splitws {
+
+const char* const INFO_KEY = "splitModel";
+const char* const WEIGHT = "weight";
+
+struct Channel {
+    std::string label, pdf;
+    int index = 0;
+    std::vector<TString> observables, parameters;
+};
+
+inline std::vector<TString> split_list(const TString& list, const char* sep = ",") {
+    std::vector<TString> items;
+    std::unique_ptr<TObjArray> tokens(list.Tokenize(sep));
+    for (int i = 0; i < tokens->GetEntries(); i++) {
+        TString item = static_cast<TObjString*>(tokens->At(i))->GetString().Strip(TString::kBoth);
+        if (item != "")
+            items.push_back(item);
+    }
+    return items;
+}
+
+inline std::string join_names(const RooArgSet& set) {
+    std::string names;
+    for (auto arg : set)
+        names += (names.empty() ? "" : ",") + std::string(arg->GetName());
+    return names;
+}
+
+// quickFit -n semantics: comma separated list of names with * wildcards
+inline bool matches_any(const TString& name, const std::vector<TString>& patterns) {
+    for (auto& pattern : patterns) {
+        TRegexp re(pattern, kTRUE);
+        Ssiz_t len = 0;
+        if (re.Index(name, &len) == 0 && len == name.Length())
+            return true;
+    }
+    return false;
+}
+
+inline bool is_split(TFile* f) {
+    return f && f->GetKey(INFO_KEY);
+}
+
+inline std::vector<Channel> read_channels(TFile* f) {
+    std::vector<Channel> channels;
+    TTree* tree = f->Get<TTree>("channels");
+    if (!tree)
+        return channels;
+    std::string *label = nullptr, *pdf = nullptr, *observables = nullptr, *parameters = nullptr;
+    int index = 0;
+    tree->SetBranchAddress("label", &label);
+    tree->SetBranchAddress("pdf", &pdf);
+    tree->SetBranchAddress("index", &index);
+    tree->SetBranchAddress("observables", &observables);
+    tree->SetBranchAddress("parameters", &parameters);
+    for (Long64_t i = 0; i < tree->GetEntries(); i++) {
+        tree->GetEntry(i);
+        channels.push_back({*label, *pdf, index, split_list(observables->c_str()), split_list(parameters->c_str())});
+    }
+    delete tree;
+    return channels;
+}
+
+// Write the model of mc (a RooSimultaneous) and the datasets dataNames in the split layout
+bool write(RooWorkspace* ws, RooStats::ModelConfig* mc, const std::vector<TString>& dataNames,
+           const TString& outputFile, int compression = 404) {
+    auto sim = dynamic_cast<RooSimultaneous*>(mc->GetPdf());
+    auto cat = sim ? dynamic_cast<const RooCategory*>(&sim->indexCat()) : nullptr;
+    if (!cat || !mc->GetObservables()) {
+        std::cerr << "ERROR: The pdf of " << mc->GetName() << " is not a RooSimultaneous over a RooCategory" << std::endl;
+        return false;
+    }
+    std::vector<RooAbsData*> datasets;
+    for (auto& name : dataNames) {
+        RooAbsData* data = ws->data(name);
+        if (!data) {
+            std::cerr << "ERROR: Dataset " << name << " not found in " << ws->GetName() << std::endl;
+            return false;
+        }
+        datasets.push_back(data);
+    }
+    std::unique_ptr<TFile> out(TFile::Open(outputFile, "RECREATE", "", compression));
+    if (!out || out->IsZombie()) {
+        std::cerr << "ERROR: Cannot create " << outputFile << std::endl;
+        return false;
+    }
+
+    TNamed info(INFO_KEY, Form("%s/%s/%s", ws->GetName(), mc->GetName(), sim->GetName()));
+    out->WriteTObject(&info);
+    out->WriteTObject(cat, "category");
+    const RooArgSet* sets[] = {mc->GetParametersOfInterest(), mc->GetNuisanceParameters(),
+                               mc->GetGlobalObservables(), mc->GetConditionalObservables()};
+    const char* setKeys[] = {"pois", "nuis", "globs", "cobs"};
+    for (int i = 0; i < 4; i++) {
+        std::unique_ptr<RooArgSet> snap(static_cast<RooArgSet*>((sets[i] ? *sets[i] : RooArgSet()).snapshot()));
+        out->WriteTObject(snap.get(), setKeys[i]);
+    }
+    std::unique_ptr<RooArgSet> allParams(sim->getParameters(*mc->GetObservables()));
+    std::unique_ptr<RooArgSet> allSnap(static_cast<RooArgSet*>(allParams->snapshot()));
+    out->WriteTObject(allSnap.get(), "parameters");
+
+    // category index -> observables of its pdf and the tree of each dataset
+    struct Output {
+        std::vector<std::string> observables;
+        std::vector<double> values;
+        double weight = 1;
+        std::vector<TTree*> trees;
+    };
+    std::map<int, Output> outputs;
+    std::string label, pdfName, observables, parameters;
+    int index = 0;
+    out->cd();
+    // on the heap and deleted before Close, like the data trees: the file owns its trees
+    auto channels = new TTree("channels", "categories of the split model");
+    channels->Branch("label", &label);
+    channels->Branch("index", &index);
+    channels->Branch("pdf", &pdfName);
+    channels->Branch("observables", &observables);
+    channels->Branch("parameters", &parameters);
+    for (const auto& type : *cat) {
+        RooAbsPdf* pdf = sim->getPdf(type.first.c_str());
+        if (!pdf)
+            continue;
+        RooWorkspace channelWs(("channel_" + type.first).c_str());
+        channelWs.import(*pdf, RooFit::Silence());
+        out->WriteTObject(&channelWs);
+
+        std::unique_ptr<RooArgSet> pdfObs(pdf->getObservables(*mc->GetObservables()));
+        pdfObs->remove(*cat, true, true);
+        std::unique_ptr<RooArgSet> pdfParams(pdf->getParameters(*mc->GetObservables()));
+        label = type.first;
+        index = type.second;
+        pdfName = pdf->GetName();
+        observables = join_names(*pdfObs);
+        parameters = join_names(*pdfParams);
+        channels->Fill();
+
+        Output& o = outputs[type.second];
+        for (auto arg : *pdfObs)
+            o.observables.push_back(arg->GetName());
+        o.values.resize(o.observables.size());
+        for (auto data : datasets) {
+            out->cd();
+            auto tree = new TTree(Form("%s_%s", data->GetName(), type.first.c_str()), type.first.c_str());
+            for (size_t k = 0; k < o.observables.size(); k++)
+                tree->Branch(o.observables[k].c_str(), &o.values[k]);
+            tree->Branch(WEIGHT, &o.weight);
+            o.trees.push_back(tree);
+        }
+    }
+
+    // one pass over each dataset, filling the tree of the category of every entry
+    for (size_t d = 0; d < datasets.size(); d++) {
+        const RooArgSet* row = datasets[d]->get();
+        auto rowCat = dynamic_cast<const RooAbsCategory*>(row->find(cat->GetName()));
+        if (!rowCat) {
+            std::cerr << "ERROR: Dataset " << datasets[d]->GetName() << " has no " << cat->GetName() << " column" << std::endl;
+            return false;
+        }
+        std::map<int, std::vector<const RooAbsReal*>> columns;
+        for (auto& o : outputs) {
+            for (auto& name : o.second.observables)
+                columns[o.first].push_back(dynamic_cast<const RooAbsReal*>(row->find(name.c_str())));
+        }
+        for (int j = 0, nEntries = datasets[d]->numEntries(); j < nEntries; j++) {
+            datasets[d]->get(j);
+            auto o = outputs.find(rowCat->getCurrentIndex());
+            if (o == outputs.end())
+                continue;
+            auto& cols = columns[o->first];
+            for (size_t k = 0; k < cols.size(); k++)
+                o->second.values[k] = cols[k] ? cols[k]->getVal() : 0;
+            o->second.weight = datasets[d]->weight();
+            o->second.trees[d]->Fill();
+        }
+    }
+    for (auto& o : outputs) {
+        for (auto tree : o.second.trees) {
+            tree->Write();
+            delete tree;
+        }
+    }
+    channels->Write();
+    delete channels;
+    std::cout << "Wrote " << outputs.size() << " categories and " << datasets.size() << " datasets to " << outputFile
+              << std::endl;
+    out->Close();
+    return true;
+}
+
+// Read the categories needed for fits that float or move the parameters matching channels
+// (all if empty), with the NPs matching fixed held constant; dataName is the dataset to
+// rebuild. nThreads = 0 lets ROOT use the cores available to the process.
+std::unique_ptr<RooWorkspace> load(const TString& fileName, const TString& dataName, const TString& channels = "",
+                                   const TString& fixed = "", int nThreads = 0) {
+    auto start = std::chrono::steady_clock::now();
+    ROOT::TThreadExecutor pool(nThreads);
+    std::unique_ptr<TFile> f(TFile::Open(fileName));
+    std::unique_ptr<TNamed> info(f ? f->Get<TNamed>(INFO_KEY) : nullptr);
+    std::unique_ptr<RooCategory> cat(f ? f->Get<RooCategory>("category") : nullptr);
+    std::unique_ptr<RooArgSet> stored(f ? f->Get<RooArgSet>("parameters") : nullptr);
+    std::vector<Channel> all = f ? read_channels(f.get()) : std::vector<Channel>();
+    std::vector<TString> names = info ? split_list(info->GetTitle(), "/") : std::vector<TString>();
+    if (!cat || !stored || all.empty() || names.size() != 3) {
+        std::cerr << "ERROR: " << fileName << " is not a split workspace file" << std::endl;
+        return nullptr;
+    }
+
+    // requested categories, then everything connected to them through floating parameters
+    std::vector<TString> patterns = split_list(channels), fixedPatterns = split_list(fixed);
+    auto floating = [&](const TString& name) {
+        if (matches_any(name, patterns))
+            return true;
+        auto var = dynamic_cast<RooRealVar*>(stored->find(name));
+        return var && !var->isConstant() && !matches_any(name, fixedPatterns);
+    };
+    std::vector<bool> selected(all.size(), patterns.empty());
+    std::set<TString> linked;
+    for (size_t i = 0; i < all.size(); i++) {
+        if (!selected[i] && matches_any(all[i].label.c_str(), patterns))
+            selected[i] = true;
+        for (auto& p : all[i].parameters)
+            selected[i] = selected[i] || matches_any(p, patterns);
+    }
+    for (bool grown = true; grown;) {
+        grown = false;
+        for (size_t i = 0; i < all.size(); i++) {
+            if (!selected[i]) {
+                for (auto& p : all[i].parameters)
+                    selected[i] = selected[i] || linked.count(p);
+                if (!selected[i])
+                    continue;
+                grown = true;
+            }
+            for (auto& p : all[i].parameters) {
+                if (floating(p) && linked.insert(p).second)
+                    grown = true;
+            }
+        }
+    }
+    std::vector<const Channel*> toLoad;
+    for (size_t i = 0; i < all.size(); i++) {
+        if (selected[i])
+            toLoad.push_back(&all[i]);
+    }
+
+    // data: every task opens the file on its own and returns the rows of one category
+    // (observables then weight)
+    auto rows = pool.Map(
+        [&](ULong64_t k) {
+            std::vector<double> values;
+            std::unique_ptr<TFile> tf(TFile::Open(fileName));
+            TTree* tree = tf ? tf->Get<TTree>(Form("%s_%s", dataName.Data(), toLoad[k]->label.c_str())) : nullptr;
+            if (!tree)
+                return values;
+            const size_t nCols = toLoad[k]->observables.size() + 1;
+            std::vector<double> row(nCols);
+            for (size_t c = 0; c + 1 < nCols; c++)
+                tree->SetBranchAddress(toLoad[k]->observables[c], &row[c]);
+            tree->SetBranchAddress(WEIGHT, &row[nCols - 1]);
+            values.reserve(nCols * tree->GetEntries());
+            for (Long64_t j = 0; j < tree->GetEntries(); j++) {
+                tree->GetEntry(j);
+                values.insert(values.end(), row.begin(), row.end());
+            }
+            return values;
+        },
+        ROOT::TSeqUL(toLoad.size()));
+    double dataSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::unique_ptr<RooWorkspace> ws;
+    for (auto ch : toLoad) {
+        std::unique_ptr<RooWorkspace> channelWs(f->Get<RooWorkspace>(("channel_" + ch->label).c_str()));
+        RooAbsPdf* pdf = channelWs ? channelWs->pdf(ch->pdf.c_str()) : nullptr;
+        if (!pdf) {
+            std::cerr << "ERROR: No pdf " << ch->pdf << " for category " << ch->label << " in " << fileName << std::endl;
+            return nullptr;
+        }
+        if (!ws) {
+            ws = std::move(channelWs);
+            ws->SetName(names[0]);
+        } else {
+            ws->import(*pdf, RooFit::RecycleConflictNodes(), RooFit::Silence());
+        }
+    }
+    RooCategory combCat(cat->GetName(), cat->GetTitle());
+    RooSimultaneous sim(names[2], names[2], combCat);
+    for (auto ch : toLoad) {
+        combCat.defineType(ch->label, ch->index);
+        sim.addPdf(*ws->pdf(ch->pdf.c_str()), ch->label.c_str());
+    }
+    ws->import(sim, RooFit::RecycleConflictNodes(), RooFit::Silence());
+
+    RooArgSet obsSet;
+    for (auto ch : toLoad) {
+        for (auto& name : ch->observables) {
+            if (ws->var(name))
+                obsSet.add(*ws->var(name), true);
+        }
+    }
+    obsSet.add(*ws->cat(cat->GetName()));
+    RooRealVar weightVar(WEIGHT, "", 1);
+    RooArgSet obsCatAndWgt(obsSet, weightVar);
+    RooDataSet data(dataName, dataName, obsCatAndWgt, RooFit::WeightVar(WEIGHT));
+    RooArgSet row(*data.get());
+    auto rowCat = dynamic_cast<RooCategory*>(row.find(cat->GetName()));
+    for (size_t k = 0; k < toLoad.size(); k++) {
+        if (rows[k].empty() && !f->GetKey(Form("%s_%s", dataName.Data(), toLoad[k]->label.c_str()))) {
+            std::cerr << "ERROR: No dataset " << dataName << " for category " << toLoad[k]->label << " in " << fileName
+                      << std::endl;
+            return nullptr;
+        }
+        std::vector<RooRealVar*> cols;
+        for (auto& name : toLoad[k]->observables)
+            cols.push_back(dynamic_cast<RooRealVar*>(row.find(name)));
+        const size_t nCols = cols.size() + 1;
+        for (size_t j = 0; j + nCols <= rows[k].size(); j += nCols) {
+            for (size_t c = 0; c < cols.size(); c++) {
+                if (cols[c])
+                    cols[c]->setVal(rows[k][j + c]);
+            }
+            rowCat->setIndex(toLoad[k]->index);
+            data.add(row, rows[k][j + nCols - 1]);
+        }
+    }
+    ws->import(data);
+
+    // ModelConfig sets: the parameters of the loaded categories, and every POI
+    auto storedSet = [&](const char* key, bool addMissing = false) {
+        RooArgSet set;
+        std::unique_ptr<RooArgSet> snap(f->Get<RooArgSet>(key));
+        if (!snap)
+            return set;
+        for (auto arg : *snap) {
+            if (!ws->arg(arg->GetName()) && addMissing)
+                ws->import(*arg, RooFit::Silence());
+            if (ws->arg(arg->GetName()))
+                set.add(*ws->arg(arg->GetName()));
+        }
+        return set;
+    };
+    RooStats::ModelConfig mc(names[1], ws.get());
+    mc.SetWorkspace(*ws);
+    mc.SetPdf(*ws->pdf(names[2]));
+    mc.SetProtoData(*ws->data(dataName));
+    mc.SetParametersOfInterest(storedSet("pois", true));
+    mc.SetNuisanceParameters(storedSet("nuis"));
+    mc.SetGlobalObservables(storedSet("globs"));
+    RooArgSet cobs = storedSet("cobs");
+    if (cobs.getSize() > 0)
+        mc.SetConditionalObservables(cobs);
+    mc.SetObservables(obsSet);
+    ws->import(mc);
+
+    std::cout << "Loaded " << toLoad.size() << "/" << all.size() << " categories of " << fileName << " in "
+              << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << " s (data "
+              << dataSeconds << " s)" << std::endl;
+    return ws;
+}
+
+}  // namespace splitws
@@ -0,0 +1,62 @@
+#!/usr/bin/env bash
+# =============================================================================
+# nativeAsimov.sh - Asimov datasets without quickAsimov
+# =============================================================================
+# Runs nativeAsimov.C on each Asimov XML, all configurations at the same time
+# (linear and quad by default). Inside a configuration every genasimov action
+# (POI hypothesis) is generated in its own worker off one loaded workspace.
+#
+# Usage:
+#   ./nativeAsimov.sh [-j N] [config.xml ...]
+#   (default: combine_CP_linear_asimov.xml combine_CP_quad_asimov.xml)
+# =============================================================================
+
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+NWORKERS=4
+
+usage() {
+    cat << USAGE
+Usage: $(basename "$0") [-j N] [config.xml ...]
+
+  -j N          Hypotheses generated concurrently per configuration (default: 4)
+  config.xml    Asimov XML (same format as quickAsimov -x)
+
+Each configuration writes its OutputFile and a log <config>.native.log next to the XML.
+USAGE
+}
+
+CONFIGS=()
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        -j) NWORKERS="$2"; shift 2;;
+        -h|--help) usage; exit 0;;
+        *) CONFIGS+=("$1"); shift;;
+    esac
+done
+if [[ ${#CONFIGS[@]} -eq 0 ]]; then
+    CONFIGS=("${SCRIPT_DIR}/combine_CP_linear_asimov.xml" "${SCRIPT_DIR}/combine_CP_quad_asimov.xml")
+fi
+
+# compile once, so that the parallel jobs do not race on the ACLiC library
+root -l -b -q -e ".L ${SCRIPT_DIR}/nativeAsimov.C+" > /dev/null
+
+pids=()
+for config in "${CONFIGS[@]}"; do
+    log="${config%.xml}.native.log"
+    root -l -b -q "${SCRIPT_DIR}/nativeAsimov.C+(\"${config}\", ${NWORKERS})" > "${log}" 2>&1 &
+    pids+=($!)
+    echo "Started $(basename "${config}") (pid $!, log ${log})"
+done
+
+status=0
+for i in "${!pids[@]}"; do
+    if wait "${pids[$i]}"; then
+        echo "[ OK ]  $(basename "${CONFIGS[$i]}")"
+    else
+        echo "[FAIL]  $(basename "${CONFIGS[$i]}")"
+        status=1
+    fi
+done
+exit ${status}
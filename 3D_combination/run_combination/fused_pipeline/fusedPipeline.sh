@@ -0,0 +1,65 @@
+#!/usr/bin/env bash
+# =============================================================================
+# fusedPipeline.sh - Steps 1-3 in one process, without intermediate files
+# =============================================================================
+# Splits, POI-edits and combines the channel workspaces in memory and writes
+# only the combined observed workspace (see ../README.md, "Fused pipeline").
+#
+# Usage:
+#   ./fusedPipeline.sh [--order linear|quad|all] [--output file.root]
+#                      [--keep-intermediates [dir]]
+# =============================================================================
+
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+WSC_DIR="${WSC_DIR:-/project/atlas/users/mfernand/software/workspaceCombiner}"
+WSC_INC="${WSC_INC:-${WSC_DIR}/inc}"
+WSC_LIB="${WSC_LIB:-${WSC_DIR}/lib/libworkspaceCombiner}"
+
+ORDER="all"
+OUTPUT=""
+KEEP="false"
+KEEP_DIR="fused_intermediate"
+
+usage() {
+    cat << USAGE
+Usage: $(basename "$0") [OPTIONS]
+
+Options:
+  --order <order>              linear|quad|all (default: all)
+  --output <file>              Output file (single order only; default: XML OutputFile)
+  --keep-intermediates [dir]   Also write the edited channel workspaces (default dir: fused_intermediate)
+  -h, --help                   Show this help message
+
+Environment: WSC_DIR, WSC_INC, WSC_LIB locate the workspaceCombiner build.
+USAGE
+}
+
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        --order) ORDER="$2"; shift 2 ;;
+        --output) OUTPUT="$2"; shift 2 ;;
+        --keep-intermediates)
+            KEEP="true"
+            if [[ $# -gt 1 && "$2" != --* ]]; then KEEP_DIR="$2"; shift; fi
+            shift ;;
+        -h|--help) usage; exit 0 ;;
+        *) echo "Unknown option: $1"; usage; exit 1 ;;
+    esac
+done
+
+ORDERS=("${ORDER}")
+if [[ "${ORDER}" == "all" ]]; then
+    ORDERS=(linear quad)
+    if [[ -n "${OUTPUT}" ]]; then
+        echo "--output needs a single --order"
+        exit 1
+    fi
+fi
+
+for order in "${ORDERS[@]}"; do
+    root -l -b -q \
+        -e "gSystem->AddIncludePath(\"-I${WSC_INC}\"); gSystem->Load(\"${WSC_LIB}\");" \
+        "${SCRIPT_DIR}/fusedPipeline.C+(\"${order}\", \"${OUTPUT}\", ${KEEP}, \"${KEEP_DIR}\")"
+done
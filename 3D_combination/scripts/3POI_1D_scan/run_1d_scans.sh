@@ -30,6 +30,7 @@ SYSTEMATICS="full_syst"
 OUTPUT_DIR="${SCRIPT_DIR}/../../output/1D_scans"
 TAG=""
 QUEUE="medium"
+POINTS_PER_JOB=1
 
 usage() {
     cat << EOF
@@ -45,12 +46,13 @@ Required:
 
 Optional:
   --n <N>               Number of scan points (default: 31)
-  --mode <mode>         parallel|sequential (default: parallel)
-  --backend <backend>   local|condor (default: local)
+  --mode <mode>         parallel|sequential|warm|adaptive (default: parallel)
+  --backend <backend>   local|server|condor (default: local)
   --systematics <sys>   full_syst|stat_only (default: full_syst)
   --output-dir <dir>    Output directory (default: output/1D_scans)
   --tag <tag>           Tag for output naming
   --queue <queue>       Condor queue (default: medium)
+  --points-per-job <N> Parallel Condor: points per job on one fit server, 0 = auto (default: 1)
   --config <file>       Config file (default: configs/hvv_cp_combination.yaml)
   -h, --help            Show this help message
 
@@ -81,6 +83,7 @@ while [[ $# -gt 0 ]]; do
         --output-dir) OUTPUT_DIR="$2"; shift 2;;
         --tag) TAG="$2"; shift 2;;
         --queue) QUEUE="$2"; shift 2;;
+        --points-per-job) POINTS_PER_JOB="$2"; shift 2;;
         --config) CONFIG="$2"; shift 2;;
         -h|--help) usage;;
         *) echo "Unknown option: $1"; usage;;
@@ -135,7 +138,8 @@ python3 -m quickfit.runner \
     --systematics "$SYSTEMATICS" \
     --output-dir "$OUTPUT_DIR" \
     --tag "$TAG" \
-    --queue "$QUEUE"
+    --queue "$QUEUE" \
+    --points-per-job "$POINTS_PER_JOB"
 
 echo
 echo "Done! Results in: $OUTPUT_DIR/root_${TAG}"
@@ -33,6 +33,7 @@ SYSTEMATICS="full_syst"
 OUTPUT_DIR="${SCRIPT_DIR}/../../output/2D_scans"
 TAG=""
 QUEUE="short"
+POINTS_PER_JOB=1
 FLOATING_RANGE=""
 
 usage() {
@@ -53,13 +54,14 @@ Required:
 Optional:
   --n1 <N>             Points for POI1 (default: 21)
   --n2 <N>             Points for POI2 (default: 21)
-  --mode <mode>        parallel|sequential (default: parallel)
-  --backend <backend>  local|condor (default: local)
+  --mode <mode>        parallel|sequential|warm|adaptive|tiles (default: parallel)
+  --backend <backend>  local|server|condor (default: local)
   --systematics <sys>  full_syst|stat_only (default: full_syst)
   --floating-poi-range <min> <max>  Range for the floating third POI (default: -3 3)
   --output-dir <dir>   Output directory
   --tag <tag>          Tag for output naming
   --queue <queue>      Condor queue (default: short)
+  --points-per-job <N> Parallel Condor: points per job on one fit server, 0 = auto (default: 1)
   --config <file>      Config file
   -h, --help           Show this help message
 
@@ -93,6 +95,7 @@ while [[ $# -gt 0 ]]; do
         --output-dir) OUTPUT_DIR="$2"; shift 2;;
         --tag) TAG="$2"; shift 2;;
         --queue) QUEUE="$2"; shift 2;;
+        --points-per-job) POINTS_PER_JOB="$2"; shift 2;;
         --config) CONFIG="$2"; shift 2;;
         -h|--help) usage;;
         *) echo "Unknown option: $1"; usage;;
@@ -153,6 +156,7 @@ CMD=(python3 -m quickfit.runner
     --output-dir "$OUTPUT_DIR"
     --tag "$TAG"
     --queue "$QUEUE"
+    --points-per-job "$POINTS_PER_JOB"
 )
 
 # Add floating-poi-range if specified
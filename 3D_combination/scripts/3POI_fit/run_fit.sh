@@ -32,7 +32,7 @@ Required:
   --workspace <label>   Workspace label (linear_obs, linear_asimov, quad_obs, quad_asimov)
 
 Optional:
-  --backend <backend>   local|condor (default: local)
+  --backend <backend>   local|server|condor (default: local)
   --systematics <sys>   full_syst|stat_only (default: full_syst)
   --output-dir <dir>    Output directory
   --tag <tag>           Tag for output naming
@@ -51,6 +51,9 @@ Examples:
   # Condor fit with MINOS, no Hesse
   $(basename "$0") --workspace quad_obs --backend condor --no-hesse --minos
 
+  # Fit server with HESSE and MINOS in parallel workers (quickfit_defaults.error_workers)
+  $(basename "$0") --workspace linear_obs --backend server --minos
+
 EOF
     exit 0
 }
@@ -0,0 +1,499 @@
+#!/usr/bin/env python3
+"""
+Benchmark suite of the combination pipeline and the fits.
+
+Runs fixed workloads of every stage, each in its own process, and records the
+wall time and the peak resident memory of that process (with the ROOT
+processes it starts) plus the throughput numbers of the stage:
+
+    split     splitter::makeWorkspace on the HTauTau input of 1.WSEditing.sh
+              (run_combination/1_ws_editing/benchmarkSplit.C), per thread count;
+              the splitter phase timers from <output>.profile.json
+    poi       replace_cHWtil_with_product (2_POI_editing) on that split output
+    combine   nativeCombine.sh on combine_CP_<order>_obs.xml
+    nll       benchmarkNLL.C on <order>_obs: NLL build time, NLL calls per s and
+              one MIGRAD fit, per backend (legacy:N for N threads)
+    scan      a 1D scan of cHWtil_combine (SCAN_POINTS points over its scan
+              range) as one batch on the fit server, without the fit cache:
+              workspace load time, points and NLL calls per s of fitting
+
+with linear and quad workspaces, and full_syst and stat_only (the -n pattern
+of get_exclude_nps_pattern) for nll and scan. The results go to one JSON file
+per run with sorted keys, one record per workload id (e.g.
+"nll/linear_obs/stat_only/legacy:4"), so that runs of two releases can be
+compared with --compare, which exits non-zero on a regression beyond the
+tolerance. The ACLiC libraries are built before the timed runs; with
+--repeat N the median wall time and metrics and the largest peak memory of
+N runs are kept.
+
+Example usage:
+    python3 benchmarks/benchmark_suite.py --threads 1,4,8 --output bench_v3.json
+    python3 benchmarks/benchmark_suite.py --stages nll,scan --orders linear
+    python3 benchmarks/benchmark_suite.py --compare bench_v2.json bench_v3.json
+"""
+
+import argparse
+import json
+import os
+import platform
+import statistics
+import subprocess
+import sys
+import tempfile
+import time
+from dataclasses import dataclass, field
+from typing import Callable, Dict, List, Optional, Tuple
+
+# Add parent directory to path for imports
+SCRIPTS_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+sys.path.insert(0, SCRIPTS_DIR)
+
+from utils.config import AnalysisConfig
+
+# Format version of the result file, increased when a workload or a field changes meaning
+SUITE_VERSION = 1
+
+STAGES = ('split', 'poi', 'combine', 'nll', 'scan')
+
+RUN_COMBINATION = os.path.join(os.path.dirname(SCRIPTS_DIR), 'run_combination')
+DEFAULT_CONFIG = os.path.join(SCRIPTS_DIR, 'configs', 'hvv_cp_combination.yaml')
+ORIGINAL_WS = os.environ.get('ORIGINAL_WS', '/project/atlas/users/mfernand/HVV_CP_comb/3D_combination/original_ws')
+WSC_DIR = os.environ.get('WSC_DIR', '/project/atlas/users/mfernand/software/workspaceCombiner')
+WSC_INC = os.environ.get('WSC_INC', os.path.join(WSC_DIR, 'inc'))
+WSC_LIB = os.environ.get('WSC_LIB', os.path.join(WSC_DIR, 'lib', 'libworkspaceCombiner'))
+
+# Split workload per order: the HTauTau input of 1.WSEditing.sh (13 categories, editRFV)
+SPLIT_WORKLOADS = {
+    'linear': {'input': os.path.join(ORIGINAL_WS, 'hTau', 'chw_chb_chwb_1NF_data_FullSyst_LinearOnly.root'),
+               'ws': 'combined', 'data': 'obsData', 'indices': '0-12', 'edit_rfv': 2},
+    'quad': {'input': os.path.join(ORIGINAL_WS, 'hTau', 'htt_ws_DATA_crossterm_FullSyst_reparam_NEWER_VERSION.root'),
+             'ws': 'combined', 'data': 'obsData', 'indices': '0-12', 'edit_rfv': 2},
+}
+# POI edit of the split output, as the HTauTau entries of replace_POI_with_product.C
+POI_VARIABLE, POI_CHANNEL = 'chwtilde', 'HTauTau'
+# Representative 1D scan
+SCAN_POI = 'cHWtil_combine'
+SCAN_POINTS = 11
+NLL_CALLS = 200
+
+# Metrics compared by --compare: rates are better higher, times, memory and call counts lower
+HIGHER_IS_BETTER = ('_per_s',)
+LOWER_IS_BETTER = ('_s', '_mb', 'calls')
+
+
+@dataclass
+class Workload:
+    """One benchmarked process.
+
+    Attributes:
+        id: Stable name of the workload, the key of its record.
+        cmd: Command line.
+        fields: Descriptive fields of the record (stage, order, threads, ...).
+        requires: Input files that must exist (outputs of earlier workloads).
+        metrics: Reads the stage metrics after a successful run.
+    """
+    id: str
+    cmd: List[str]
+    fields: Dict
+    requires: List[str] = field(default_factory=list)
+    metrics: Callable[[], Dict[str, float]] = lambda: {}
+
+
+def measure(cmd: List[str], log_path: str) -> Tuple[int, float, float]:
+    """Run a command and measure it.
+
+    Returns:
+        (exit code, wall time in s, peak RSS in MB of the process and its
+        waited-for children).
+    """
+    start = time.monotonic()
+    with open(log_path, 'w') as log:
+        proc = subprocess.Popen(cmd, stdout=log, stderr=subprocess.STDOUT)
+        _, status, usage = os.wait4(proc.pid, 0)
+    proc.returncode = os.waitstatus_to_exitcode(status)
+    return proc.returncode, time.monotonic() - start, usage.ru_maxrss / 1024.0
+
+
+def root_command(args: List[str], workspace_combiner: bool = False) -> List[str]:
+    """ROOT batch command, with the workspaceCombiner build loaded first if needed."""
+    cmd = ['root', '-l', '-b', '-q']
+    if workspace_combiner:
+        cmd += ['-e', f'gSystem->AddIncludePath("-I{WSC_INC}"); gSystem->Load("{WSC_LIB}");']
+    return cmd + args
+
+
+def compile_macro(macro: str, log_path: str, workspace_combiner: bool = False) -> bool:
+    """Build the ACLiC library of a macro, so that no timed run includes the compilation."""
+    cmd = root_command(['-e', f'gSystem->CompileMacro("{macro}", "k")'], workspace_combiner)
+    with open(log_path, 'w') as log:
+        return subprocess.run(cmd, stdout=log, stderr=subprocess.STDOUT).returncode == 0
+
+
+def read_json(path: str) -> Optional[Dict]:
+    """Contents of a JSON file, None if it is missing or invalid."""
+    try:
+        with open(path) as f:
+            return json.load(f)
+    except (OSError, ValueError):
+        return None
+
+
+class BenchmarkSuite:
+    """
+    Builds and runs the workloads of one benchmark run.
+
+    Attributes:
+        config: Analysis configuration (workspaces, NP patterns, scan ranges).
+        config_path: Its file, passed to the scan worker.
+        work_dir: Outputs and logs of the workloads.
+        threads: Thread (or process) counts.
+        backends: NLL backends benchmarked with one thread.
+        repeat: Runs per workload.
+    """
+
+    def __init__(self, config_path: str, work_dir: str, threads: List[int], backends: List[str], repeat: int = 1):
+        self.config_path = os.path.abspath(config_path)
+        self.config = AnalysisConfig.from_yaml(config_path)
+        self.work_dir = os.path.abspath(work_dir)
+        self.threads = threads
+        self.backends = backends
+        self.repeat = max(1, repeat)
+        os.makedirs(work_dir, exist_ok=True)
+
+    def _path(self, name: str) -> str:
+        return os.path.join(self.work_dir, name)
+
+    def split_workloads(self, order: str) -> List[Workload]:
+        """Splitter on the fixed input of the order, per thread count."""
+        spec = SPLIT_WORKLOADS[order]
+        macro = os.path.join(RUN_COMBINATION, '1_ws_editing', 'benchmarkSplit.C')
+        workloads = []
+        for n in self.threads:
+            output = self._path(f'split_{order}_t{n}.root')
+            call = (f'{macro}+("{spec["input"]}","{output}","{spec["ws"]}","ModelConfig","{spec["data"]}",'
+                    f'"{spec["indices"]}",{spec["edit_rfv"]},{n})')
+            workloads.append(Workload(
+                id=f'split/{order}/t{n}',
+                cmd=root_command([call], workspace_combiner=True),
+                fields={'stage': 'split', 'order': order, 'threads': n},
+                requires=[spec['input']],
+                metrics=lambda output=output: self._split_metrics(output)
+            ))
+        # the row-wise fill of the category data, baseline of the column-wise one
+        n = self.threads[0]
+        output = self._path(f'split_{order}_t{n}_rowfill.root')
+        call = (f'{macro}+("{spec["input"]}","{output}","{spec["ws"]}","ModelConfig","{spec["data"]}",'
+                f'"{spec["indices"]}",{spec["edit_rfv"]},{n},false,false,false)')
+        workloads.append(Workload(
+            id=f'split/{order}/t{n}/rowfill',
+            cmd=root_command([call], workspace_combiner=True),
+            fields={'stage': 'split', 'order': order, 'threads': n, 'fill': 'row'},
+            requires=[spec['input']],
+            metrics=lambda output=output: self._split_metrics(output)
+        ))
+        return workloads
+
+    @staticmethod
+    def _split_metrics(output: str) -> Dict[str, float]:
+        """Phase times of the splitter report."""
+        report = read_json(os.path.splitext(output)[0] + '.profile.json') or {}
+        metrics = {f'{phase}_s': sec for phase, sec in report.get('phases', {}).items()}
+        metrics['categories'] = len(report.get('categories', []))
+        return metrics
+
+    def poi_workloads(self, order: str) -> List[Workload]:
+        """POI product replacement on the single-thread split output."""
+        macro = os.path.join(RUN_COMBINATION, '2_POI_editing', 'replace_POI_with_product.C')
+        split_output = self._path(f'split_{order}_t{self.threads[0]}.root')
+        output = self._path(f'poi_{order}.root')
+        call = (f'replace_cHWtil_with_product("{split_output}","{output}","{SPLIT_WORKLOADS[order]["ws"]}",'
+                f'"{POI_VARIABLE}","{POI_CHANNEL}")')
+        return [Workload(
+            id=f'poi/{order}',
+            cmd=root_command(['-e', f'.L {macro}+', '-e', call]),
+            fields={'stage': 'poi', 'order': order, 'threads': 1},
+            requires=[split_output]
+        )]
+
+    def combine_workloads(self, order: str) -> List[Workload]:
+        """Native combiner on the observed combination XML of the order."""
+        xml = os.path.join(RUN_COMBINATION, '3_ws_combine', f'combine_CP_{order}_obs.xml')
+        return [Workload(
+            id=f'combine/{order}',
+            cmd=['bash', os.path.join(RUN_COMBINATION, '3_ws_combine', 'nativeCombine.sh'), xml,
+                 self._path(f'combine_{order}.root')],
+            fields={'stage': 'combine', 'order': order, 'threads': 1},
+            requires=[xml]
+        )]
+
+    def nll_workloads(self, order: str, systematics: str) -> List[Workload]:
+        """NLL evaluation and one fit, per backend and per process count of the legacy backend."""
+        label = f'{order}_obs'
+        ws = self.config.workspaces[label]
+        nps = self.config.get_exclude_nps_pattern(systematics=systematics)
+        macro = os.path.join(SCRIPTS_DIR, 'fit_server', 'benchmarkNLL.C')
+        runs = [(b, 1) for b in self.backends] + [(f'legacy:{n}', n) for n in self.threads if n > 1]
+        workloads = []
+        for backend, n in runs:
+            result = self._path(f'nll_{label}_{systematics}_{backend.replace(":", "_")}.json')
+            call = (f'{macro}+("{ws.path}","{ws.workspace_name}","{ws.model_config}","{ws.data_name}","{nps}",'
+                    f'"{backend}",{NLL_CALLS},true,1e-4,1e-4,"{result}")')
+            workloads.append(Workload(
+                id=f'nll/{label}/{systematics}/{backend}',
+                cmd=root_command([call]),
+                fields={'stage': 'nll', 'order': order, 'systematics': systematics, 'backend': backend, 'threads': n},
+                requires=[ws.path],
+                metrics=lambda result=result: self._nll_metrics(result)
+            ))
+        return workloads
+
+    @staticmethod
+    def _nll_metrics(result: str) -> Dict[str, float]:
+        """Numbers of the single backend of a benchmarkNLL.C result."""
+        backends = (read_json(result) or {}).get('backends') or [{}]
+        r = backends[0]
+        names = {'buildSeconds': 'build_s', 'callsPerSecond': 'nll_calls_per_s', 'fitSeconds': 'fit_s',
+                 'fitCalls': 'fit_calls', 'fitCallsPerSecond': 'fit_calls_per_s', 'status': 'fit_status'}
+        return {names[k]: v for k, v in r.items() if k in names and v is not None}
+
+    def scan_workloads(self, order: str, systematics: str) -> List[Workload]:
+        """The representative 1D scan on the fit server, per process count."""
+        label = f'{order}_obs'
+        ws = self.config.workspaces[label]
+        workloads = []
+        for n in self.threads:
+            result = self._path(f'scan_{label}_{systematics}_t{n}.json')
+            workloads.append(Workload(
+                id=f'scan/{label}/{systematics}/t{n}',
+                cmd=[sys.executable, os.path.abspath(__file__), '--scan-worker', '--config', self.config_path,
+                     '--workspace', label, '--systematics', systematics, '--num-cpu', str(n), '--result', result],
+                fields={'stage': 'scan', 'order': order, 'systematics': systematics, 'threads': n},
+                requires=[ws.input_file()],
+                metrics=lambda result=result: read_json(result) or {}
+            ))
+        return workloads
+
+    def workloads(self, stages: List[str], orders: List[str], systematics: List[str]) -> List[Workload]:
+        """All workloads of a run, in stage order."""
+        workloads = []
+        for stage in STAGES:
+            if stage not in stages:
+                continue
+            for order in orders:
+                if stage in ('nll', 'scan'):
+                    for sys_mode in systematics:
+                        workloads += getattr(self, f'{stage}_workloads')(order, sys_mode)
+                else:
+                    workloads += getattr(self, f'{stage}_workloads')(order)
+        return workloads
+
+    def compile(self, stages: List[str]) -> None:
+        """Build the ACLiC libraries of the macros of the stages before timing anything."""
+        macros = {
+            'split': (os.path.join(RUN_COMBINATION, '1_ws_editing', 'benchmarkSplit.C'), True),
+            'poi': (os.path.join(RUN_COMBINATION, '2_POI_editing', 'replace_POI_with_product.C'), False),
+            'combine': (os.path.join(RUN_COMBINATION, '3_ws_combine', 'nativeCombine.C'), True),
+            'nll': (os.path.join(SCRIPTS_DIR, 'fit_server', 'benchmarkNLL.C'), False),
+            'scan': (os.path.join(SCRIPTS_DIR, 'fit_server', 'fitServer.C'), False),
+        }
+        for stage in stages:
+            macro, wsc = macros[stage]
+            if not compile_macro(macro, self._path(f'compile_{stage}.log'), wsc):
+                print(f"  Warning: cannot compile {macro}, see compile_{stage}.log", file=sys.stderr)
+
+    def run(self, workload: Workload) -> Dict:
+        """Run a workload repeat times.
+
+        Returns:
+            Its record: the fields, status (0, the exit code of the first
+            failed run, or "skipped" without its inputs), repeats, wall_s
+            (median), wall_s_min, peak_rss_mb (largest) and metrics (medians).
+        """
+        record = dict(workload.fields, id=workload.id)
+        missing = [p for p in workload.requires if not os.path.exists(p)]
+        if missing:
+            print(f"  {workload.id}: skipped, missing {', '.join(missing)}")
+            return dict(record, status='skipped')
+        walls, rss, metrics = [], [], []
+        for rep in range(self.repeat):
+            log = self._path(f'{workload.id.replace("/", "_").replace(":", "_")}_{rep}.log')
+            status, wall, peak = measure(workload.cmd, log)
+            if status != 0:
+                print(f"  {workload.id}: failed with status {status}, see {log}")
+                return dict(record, status=status, wall_s=wall, peak_rss_mb=peak)
+            walls.append(wall)
+            rss.append(peak)
+            metrics.append(workload.metrics())
+        merged = {}
+        for name in sorted(set().union(*metrics)):
+            values = [m[name] for m in metrics if isinstance(m.get(name), (int, float))]
+            if values:
+                merged[name] = statistics.median(values)
+        record.update(status=0, repeats=self.repeat, wall_s=statistics.median(walls), wall_s_min=min(walls),
+                      peak_rss_mb=max(rss), metrics=merged)
+        print(f"  {workload.id}: {record['wall_s']:.1f} s, {record['peak_rss_mb']:.0f} MB")
+        return record
+
+
+def release_label() -> str:
+    """git describe of the checkout, 'unknown' outside git."""
+    try:
+        out = subprocess.run(['git', 'describe', '--always', '--dirty'], cwd=SCRIPTS_DIR,
+                             capture_output=True, text=True, check=True)
+        return out.stdout.strip()
+    except (OSError, subprocess.CalledProcessError):
+        return 'unknown'
+
+
+def scan_worker(config_path: str, label: str, systematics: str, num_cpu: int, result_path: str) -> int:
+    """Body of a scan workload: the 1D scan as one fit server batch.
+
+    Writes load_s, points, converged, fit_s, nll_calls, points_per_s and
+    nll_calls_per_s (both over the fitting time) to result_path.
+    """
+    from quickfit.fit_server import FitServerClient
+    from quickfit.runner import QuickFitRunner
+
+    config = AnalysisConfig.from_yaml(config_path)
+    runner = QuickFitRunner(config, verbose=False)
+    ws = config.workspaces[label]
+    scan_range = config.scan_ranges.get(SCAN_POI, {'min': -1.0, 'max': 1.0})
+    values = runner._linspace(SCAN_POINTS, scan_range['min'], scan_range['max'])
+    poi_strings = [runner.poi_builder.build_1d_scan(SCAN_POI, val) for val in values]
+    server = FitServerClient(
+        ws,
+        exclude_nps=config.get_exclude_nps_pattern(systematics=systematics),
+        min_tolerance=config.quickfit_defaults.get('min_tolerance', 0.0001),
+        # the NumCPU processes only exist for the legacy backend
+        eval_backend=config.quickfit_defaults.get('eval_backend', 'legacy') if num_cpu == 1 else 'legacy',
+        num_cpu=num_cpu,
+        poly_formulas=bool(config.quickfit_defaults.get('poly_formulas', 0)),
+        channels=runner._fit_channels(ws, [poi_strings[0], poi_strings[-1]]),
+        log_file=os.path.splitext(result_path)[0] + '_fit_server.log'
+    )
+    start = time.monotonic()
+    with server:
+        load = time.monotonic() - start
+        results = server.fit_batch([(p, None, None) for p in poi_strings])
+    fit_time = sum(res.time for res in results)
+    calls = sum(res.calls for res in results)
+    record = {
+        'load_s': load,
+        'points': len(results),
+        'converged': sum(res.success for res in results),
+        'fit_s': fit_time,
+        'nll_calls': calls,
+        'points_per_s': len(results) / fit_time if fit_time > 0 else 0.0,
+        'nll_calls_per_s': calls / fit_time if fit_time > 0 else 0.0,
+    }
+    with open(result_path, 'w') as f:
+        json.dump(record, f, indent=1, sort_keys=True)
+    return 0 if record['converged'] == record['points'] else 1
+
+
+def compare(base_path: str, new_path: str, tolerance: float) -> bool:
+    """Print the changes between two result files.
+
+    Returns:
+        True if no workload got slower, bigger or failed beyond the tolerance.
+    """
+    base, new = read_json(base_path), read_json(new_path)
+    if base is None or new is None:
+        raise ValueError(f"Cannot read {base_path if base is None else new_path}")
+    if base.get('suite') != new.get('suite'):
+        print(f"Warning: suite versions differ ({base.get('suite')} vs {new.get('suite')})")
+    old = {r['id']: r for r in base.get('results', [])}
+    print(f"{base.get('release')} -> {new.get('release')} (tolerance {100 * tolerance:.0f} %)")
+    ok = True
+    for rec in new.get('results', []):
+        ref = old.get(rec['id'])
+        if ref is None:
+            print(f"  {rec['id']}: new")
+            continue
+        if rec.get('status') != 0:
+            if ref.get('status') == 0:
+                print(f"  {rec['id']}: REGRESSION, status {rec.get('status')}")
+                ok = False
+            continue
+        if ref.get('status') != 0:
+            continue
+        values = {'wall_s': rec['wall_s'], 'peak_rss_mb': rec['peak_rss_mb'], **rec.get('metrics', {})}
+        before = {'wall_s': ref['wall_s'], 'peak_rss_mb': ref['peak_rss_mb'], **ref.get('metrics', {})}
+        changes = []
+        for name, value in values.items():
+            prev = before.get(name)
+            if not isinstance(prev, (int, float)) or not prev or name.endswith('status'):
+                continue
+            higher = name.endswith(HIGHER_IS_BETTER)
+            if not higher and not name.endswith(LOWER_IS_BETTER):
+                continue
+            ratio = value / prev
+            worse = ratio < 1 / (1 + tolerance) if higher else ratio > 1 + tolerance
+            if worse or name in ('wall_s', 'peak_rss_mb'):
+                changes.append(f"{name} x{ratio:.2f}{' REGRESSION' if worse else ''}")
+            ok = ok and not worse
+        print(f"  {rec['id']}: " + ", ".join(changes))
+    return ok
+
+
+def main():
+    """CLI interface."""
+    parser = argparse.ArgumentParser(description="Benchmark the combination pipeline and the fits.")
+    parser.add_argument('--config', default=DEFAULT_CONFIG, help='Config file')
+    parser.add_argument('--stages', default=','.join(STAGES), help=f'Comma-separated stages ({",".join(STAGES)})')
+    parser.add_argument('--orders', default='linear,quad', help='Comma-separated orders (linear,quad)')
+    parser.add_argument('--systematics', default='full_syst,stat_only', help='Systematics modes of nll and scan')
+    parser.add_argument('--threads', default='1,4', help='Thread/process counts, the first is the reference')
+    parser.add_argument('--backends', default='legacy,cpu,codegen', help='NLL backends run with one thread')
+    parser.add_argument('--repeat', type=int, default=1, help='Runs per workload')
+    parser.add_argument('--work-dir', default=os.environ.get('WORK_DIR'), help='Outputs and logs (default: temporary)')
+    parser.add_argument('--output', help='Result file (default: benchmark_<release>.json)')
+    parser.add_argument('--compare', nargs=2, metavar=('BASE', 'NEW'), help='Compare two result files')
+    parser.add_argument('--tolerance', type=float, default=0.1, help='Relative change counted as a regression')
+    # internal: body of the scan workloads
+    parser.add_argument('--scan-worker', action='store_true', help=argparse.SUPPRESS)
+    parser.add_argument('--workspace', help=argparse.SUPPRESS)
+    parser.add_argument('--num-cpu', type=int, default=1, help=argparse.SUPPRESS)
+    parser.add_argument('--result', help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.scan_worker:
+        sys.exit(scan_worker(args.config, args.workspace, args.systematics, args.num_cpu, args.result))
+    if args.compare:
+        sys.exit(0 if compare(*args.compare, args.tolerance) else 1)
+
+    stages = [s for s in args.stages.split(',') if s]
+    unknown = [s for s in stages if s not in STAGES]
+    if unknown:
+        parser.error(f"unknown stages: {', '.join(unknown)}")
+    orders = [o for o in args.orders.split(',') if o]
+    systematics = [s for s in args.systematics.split(',') if s]
+    threads = [int(n) for n in args.threads.split(',') if n]
+    release = release_label()
+    work_dir = args.work_dir or tempfile.mkdtemp(prefix='benchmark_')
+
+    suite = BenchmarkSuite(args.config, work_dir, threads, [b for b in args.backends.split(',') if b], args.repeat)
+    print(f"Benchmark {release}: stages {', '.join(stages)}, threads {threads}, work directory {work_dir}")
+    suite.compile(stages)
+    records = [suite.run(w) for w in suite.workloads(stages, orders, systematics)]
+
+    document = {
+        'suite': SUITE_VERSION,
+        'release': release,
+        'date': time.strftime('%Y-%m-%dT%H:%M:%S'),
+        'host': {'name': platform.node(), 'cpus': os.cpu_count(), 'platform': platform.platform()},
+        'options': {'stages': stages, 'orders': orders, 'systematics': systematics, 'threads': threads,
+                    'backends': suite.backends, 'repeat': suite.repeat, 'scan_points': SCAN_POINTS,
+                    'nll_calls': NLL_CALLS},
+        'results': sorted(records, key=lambda r: r['id']),
+    }
+    output = args.output or f"benchmark_{release}.json"
+    with open(output + '.tmp', 'w') as f:
+        json.dump(document, f, indent=1, sort_keys=True)
+    os.replace(output + '.tmp', output)
+    print(f"Results in {output}, logs in {work_dir}")
+    sys.exit(0 if all(r['status'] in (0, 'skipped') for r in records) else 1)
+
+
+if __name__ == '__main__':
+    main()
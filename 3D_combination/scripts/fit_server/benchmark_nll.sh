@@ -0,0 +1,90 @@
+#!/usr/bin/env bash
+# =============================================================================
+# benchmark_nll.sh - RooFit NLL backends on the combined workspaces
+# =============================================================================
+# Runs benchmarkNLL.C on each workspace of the configuration: time per NLL
+# call and per MIGRAD fit for each backend, and a check that all backends
+# give the same NLL at the best fit of the first one.
+#
+# Usage:
+#   ./benchmark_nll.sh [--backends legacy,cpu] [--calls N] [--no-fit]
+#                      [--systematics full_syst|stat_only] [--json] [workspace ...]
+#   (default: all workspaces of configs/hvv_cp_combination.yaml)
+# =============================================================================
+
+set -euo pipefail
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+CONFIG="${SCRIPT_DIR}/../configs/hvv_cp_combination.yaml"
+WORK_DIR="${WORK_DIR:-$(mktemp -d)}"
+BACKENDS="legacy,cpu,codegen"
+NCALLS=200
+FIT="true"
+SYSTEMATICS="full_syst"
+JSON="false"
+
+usage() {
+    cat << USAGE
+Usage: $(basename "$0") [options] [workspace ...]
+
+Options:
+  --backends <list>     Comma-separated backends, the first is the reference (default: legacy,cpu,codegen);
+                        legacy:N splits the categories over N processes
+  --calls <N>           NLL evaluations timed per backend (default: 200)
+  --no-fit              Skip the MIGRAD fits, compare at the stored parameter values
+  --systematics <sys>   full_syst|stat_only (default: full_syst)
+  --config <file>       Config file (default: configs/hvv_cp_combination.yaml)
+  --json                Also write the results as <workspace>_nll.json to \$WORK_DIR
+
+Logs are written to \$WORK_DIR (default: a new temporary directory).
+USAGE
+}
+
+WORKSPACES=()
+while [[ $# -gt 0 ]]; do
+    case "$1" in
+        --backends) BACKENDS="$2"; shift 2;;
+        --calls) NCALLS="$2"; shift 2;;
+        --no-fit) FIT="false"; shift;;
+        --systematics) SYSTEMATICS="$2"; shift 2;;
+        --config) CONFIG="$2"; shift 2;;
+        --json) JSON="true"; shift;;
+        -h|--help) usage; exit 0;;
+        *) WORKSPACES+=("$1"); shift;;
+    esac
+done
+
+# label path workspace model_config data fixed_nps, one line per workspace
+read_config() {
+    local config
+    config="$(realpath "$CONFIG")"
+    (cd "${SCRIPT_DIR}/.." && python3 - "$config" "$SYSTEMATICS" "$@") << 'PY'
+import sys
+from utils.config import AnalysisConfig
+config = AnalysisConfig.from_yaml(sys.argv[1])
+nps = config.get_exclude_nps_pattern(systematics=sys.argv[2])
+for label in sys.argv[3:] or list(config.workspaces):
+    ws = config.workspaces[label]
+    print(label, ws.path, ws.workspace_name, ws.model_config, ws.data_name, nps or '-')
+PY
+}
+
+status=0
+while read -r label path wsname mcname dataname nps; do
+    [[ "${nps}" == "-" ]] && nps=""
+    log="${WORK_DIR}/${label}_nll.log"
+    json=""
+    [[ "${JSON}" == "true" ]] && json="${WORK_DIR}/${label}_nll.json"
+    echo "===== ${label} (${path})"
+    if root -l -b -q "${SCRIPT_DIR}/benchmarkNLL.C+(\"${path}\",\"${wsname}\",\"${mcname}\",\"${dataname}\",\"${nps}\",\"${BACKENDS}\",${NCALLS},${FIT},1e-4,1e-4,\"${json}\")" \
+        > "${log}" 2>&1; then
+        :
+    else
+        status=1
+    fi
+    # the summary table is everything from the header line on
+    sed -n '/^ *backend/,$p' "${log}"
+done < <(read_config "${WORKSPACES[@]+"${WORKSPACES[@]}"}")
+
+echo "Logs in ${WORK_DIR}"
+exit ${status}
@@ -0,0 +1,195 @@
+// HESSE and MINOS of a fitServer.C fit over forked error workers, each on its own copy of
+// the fitted NLL and minimizer.
+#ifndef FIT_SERVER_ERRORS_HEADER
+#define FIT_SERVER_ERRORS_HEADER
+
+#include "fitServerState.h"
+
+#include <TSystem.h>
+#include <TMatrixDSym.h>
+#include <TDecompChol.h>
+#include <RooFitResult.h>
+
+#include <cmath>
+#include <cstdio>
+#include <iostream>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Finite-difference step of the parallel HESSE, in units of the MIGRAD error
+const double HESSE_STEP = 0.1;
+
+// Runs work(k) for k = 0 .. nWorkers - 1 in forked children, each on its own copy of the
+// fitted NLL and minimizer (RooFit evaluation cannot be shared between threads), and
+// returns the numbers each child gives back through a temporary file; empty for a child
+// that failed
+std::vector<std::vector<double>> run_forked(int nWorkers, const std::function<std::vector<double>(int)>& work) {
+    TString dir = Form("%s/fitServer_%d", gSystem->TempDirectory(), gSystem->GetPid());
+    gSystem->mkdir(dir, true);
+    std::cout.flush();
+    fflush(stdout);
+    std::vector<pid_t> pids(nWorkers, -1);
+    for (int k = 0; k < nWorkers; k++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            std::vector<double> values = work(k);
+            FILE* f = fopen(Form("%s/worker_%d.bin", dir.Data(), k), "wb");
+            bool ok = f && fwrite(values.data(), sizeof(double), values.size(), f) == values.size();
+            ok = f && fclose(f) == 0 && ok;
+            std::cout.flush();
+            fflush(stdout);
+            _exit(ok ? 0 : 1);
+        }
+        if (pid < 0)
+            std::cerr << "WARNING: Cannot fork error worker " << k << std::endl;
+        pids[k] = pid;
+    }
+    std::vector<std::vector<double>> results(nWorkers);
+    for (int k = 0; k < nWorkers; k++) {
+        int wstatus = 0;
+        if (pids[k] < 0 || waitpid(pids[k], &wstatus, 0) < 0)
+            continue;
+        TString path = Form("%s/worker_%d.bin", dir.Data(), k);
+        FILE* f = WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0 ? fopen(path, "rb") : nullptr;
+        if (f) {
+            double value;
+            while (fread(&value, sizeof(double), 1, f) == 1)
+                results[k].push_back(value);
+            fclose(f);
+        }
+        gSystem->Unlink(path);
+    }
+    gSystem->Unlink(dir);
+    return results;
+}
+
+// HESSE at the current minimum from finite differences of the NLL over the error workers:
+// the covariance of result and the errors of the parameters are replaced. False if a
+// parameter has an empty range, a worker failed or the Hessian is not positive definite
+bool parallel_hesse(FitServer& s, RooFitResult& result, int& calls) {
+    const RooArgList& floating = result.floatParsFinal();
+    int n = floating.size();
+    if (n == 0)
+        return true;
+    std::vector<RooRealVar*> vars(n);
+    std::vector<double> x0(n), step(n);
+    std::vector<char> central(n);
+    for (int i = 0; i < n; i++) {
+        vars[i] = s.ws->var(floating[i].GetName());
+        if (!vars[i])
+            return false;
+        x0[i] = vars[i]->getVal();
+        double h = HESSE_STEP * vars[i]->getError();
+        if (!(h > 0) || !std::isfinite(h))
+            h = 1e-3 * std::max(1.0, fabs(x0[i]));
+        // central differences if x0 +- h fit in the range, otherwise one-sided ones towards
+        // the farther limit, with h shrunk so that x0 + 2 step stays inside (setVal would clip)
+        double up = vars[i]->getMax() - x0[i], down = x0[i] - vars[i]->getMin();
+        central[i] = h <= up && h <= down;
+        if (!central[i]) {
+            h = std::min(h, 0.5 * std::max(up, down));
+            if (!(h > 0))
+                return false;
+        }
+        step[i] = central[i] || up >= down ? h : -h;
+    }
+    // (i, -1): x + step_i, (i, -2): x - step_i (x + 2 step_i if not central), (i, j): x + step_i + step_j
+    std::vector<std::pair<int, int>> points;
+    for (int i = 0; i < n; i++) {
+        points.emplace_back(i, -1);
+        points.emplace_back(i, -2);
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++)
+            points.emplace_back(i, j);
+    }
+    auto move = [&](const std::pair<int, int>& p, bool back) {
+        int i = p.first, j = p.second;
+        double di = j == -2 ? (central[i] ? -step[i] : 2 * step[i]) : step[i];
+        vars[i]->setVal(back ? x0[i] : x0[i] + di);
+        if (j >= 0)
+            vars[j]->setVal(back ? x0[j] : x0[j] + step[j]);
+    };
+    double f0 = s.nll->getVal();
+    int nWorkers = std::min<int>(s.opt.errorWorkers, points.size());
+    auto values = run_forked(nWorkers, [&](int k) {
+        std::vector<double> out;
+        for (size_t p = k; p < points.size(); p += nWorkers) {
+            move(points[p], false);
+            out.push_back(s.nll->getVal());
+            move(points[p], true);
+        }
+        return out;
+    });
+    std::vector<double> f(points.size());
+    for (int k = 0; k < nWorkers; k++) {
+        size_t expected = (points.size() - k + nWorkers - 1) / nWorkers;
+        if (values[k].size() != expected)
+            return false;
+        for (size_t m = 0; m < expected; m++)
+            f[k + m * nWorkers] = values[k][m];
+    }
+    calls += points.size();
+
+    TMatrixDSym hessian(n);
+    for (int i = 0; i < n; i++) {
+        double f1 = f[2 * i], f2 = f[2 * i + 1];
+        hessian(i, i) = (central[i] ? f1 + f2 - 2 * f0 : f0 - 2 * f1 + f2) / (step[i] * step[i]);
+    }
+    size_t p = 2 * n;
+    for (int i = 0; i < n; i++) {
+        for (int j = i + 1; j < n; j++, p++)
+            hessian(i, j) = hessian(j, i) = (f[p] - f[2 * i] - f[2 * j] + f0) / (step[i] * step[j]);
+    }
+    TDecompChol chol(hessian);
+    TMatrixDSym cov(n);
+    if (!chol.Decompose() || !chol.Invert(cov))
+        return false;
+    cov *= 2 * s.nll->defaultErrorLevel();
+    result.setCovarianceMatrix(cov);
+    for (int i = 0; i < n; i++)
+        vars[i]->setError(sqrt(cov(i, i)));
+    return true;
+}
+
+// MINOS of pois over the error workers, one POI per worker at a time; the asymmetric errors
+// are set on the POIs and in result. The POIs of a failed worker are redone here
+void parallel_minos(FitServer& s, RooFitResult& result, const std::vector<RooRealVar*>& pois, int& calls) {
+    int nWorkers = std::min<int>(s.opt.errorWorkers, pois.size());
+    auto values = run_forked(nWorkers, [&](int k) {
+        std::vector<double> out;
+        for (size_t i = k; i < pois.size(); i += nWorkers) {
+            s.minim->zeroEvalCount();
+            int status = s.minim->minos(RooArgSet(*pois[i]));
+            out.insert(out.end(), {pois[i]->getErrorLo(), pois[i]->getErrorHi(), static_cast<double>(status),
+                                   static_cast<double>(s.minim->evalCounter())});
+        }
+        return out;
+    });
+    for (size_t i = 0; i < pois.size(); i++) {
+        const std::vector<double>& out = values[i % nWorkers];
+        size_t m = 4 * (i / nWorkers);
+        double lo, hi;
+        if (m + 4 <= out.size()) {
+            lo = out[m];
+            hi = out[m + 1];
+            calls += static_cast<int>(out[m + 3]);
+            if (out[m + 2] != 0)
+                std::cout << "MINOS of " << pois[i]->GetName() << " returned status " << out[m + 2] << std::endl;
+            pois[i]->setAsymError(lo, hi);
+        } else {
+            std::cout << "MINOS worker failed for " << pois[i]->GetName() << ", running it here" << std::endl;
+            int before = s.minim->evalCounter();
+            s.minim->minos(RooArgSet(*pois[i]));
+            calls += s.minim->evalCounter() - before;
+            lo = pois[i]->getErrorLo();
+            hi = pois[i]->getErrorHi();
+        }
+        auto final = dynamic_cast<RooRealVar*>(const_cast<RooArgList&>(result.floatParsFinal()).find(*pois[i]));
+        if (final)
+            final->setAsymError(lo, hi);
+    }
+}
+
+#endif
@@ -0,0 +1,156 @@
+// Model and NLL of a fitServer.C session: the workspace (or the categories of a split file),
+// the fixed NPs, the NLL with the backend options, and the minimizer on top of it.
+#ifndef FIT_SERVER_NLL_HEADER
+#define FIT_SERVER_NLL_HEADER
+
+#include "fitServerState.h"
+#include "fitServerProfile.h"
+#include "../../run_combination/3_ws_combine/splitWorkspace.h"
+#include "../../run_combination/1_ws_editing/eftPolynomial.h"
+
+#include <RooAbsPdf.h>
+#include <RooArgSet.h>
+#include <RooLinkedList.h>
+#include <RooCmdArg.h>
+#include <RooGlobalFunc.h>
+#include <RVersion.h>
+
+#include <iostream>
+#include <stdexcept>
+
+bool open_server(FitServer& s, const TString& inputFile) {
+    const TString& wsName = s.opt.wsName;
+    const TString& dataName = s.opt.dataName;
+    const TString& fixNPs = s.opt.fixNPs;
+    const TString& channels = s.opt.channels;
+    auto start = profiling::Clock::now();
+    s.file.reset(TFile::Open(inputFile));
+    if (!s.file || s.file->IsZombie()) {
+        std::cerr << "ERROR: Cannot open " << inputFile << std::endl;
+        return false;
+    }
+    if (splitws::is_split(s.file.get())) {
+        s.splitWs = splitws::load(inputFile, dataName, channels, fixNPs);
+        s.ws = s.splitWs.get();
+    } else {
+        if (channels != "")
+            std::cout << inputFile << " is not a split file, all categories are loaded" << std::endl;
+        s.ws = dynamic_cast<RooWorkspace*>(s.file->Get(wsName));
+    }
+    if (!s.ws) {
+        std::cerr << "ERROR: Workspace " << wsName << " not found in " << inputFile << std::endl;
+        return false;
+    }
+    s.mc = dynamic_cast<RooStats::ModelConfig*>(s.ws->obj(s.opt.mcName));
+    s.data = s.ws->data(dataName);
+    if (!s.mc || !s.mc->GetPdf() || !s.data) {
+        std::cerr << "ERROR: ModelConfig " << s.opt.mcName << " or data " << dataName << " not found" << std::endl;
+        return false;
+    }
+    if (s.opt.polyFormulas && !eftPolynomial::speedsUp(s.opt.evalBackend.Data())) {
+        std::cout << "polyFormulas ignored: EFTPolynomial is not faster than the formulas with the " << s.opt.evalBackend
+                  << " backend of ROOT " << ROOT_RELEASE << std::endl;
+    } else if (s.opt.polyFormulas) {
+        int nReplaced = eftPolynomial::replaceFormulas(*s.ws, *s.mc->GetPdf());
+        std::cout << "Replaced " << nReplaced << " polynomial formulas by EFTPolynomial nodes" << std::endl;
+    }
+    s.sessionTimer.add("load", profiling::seconds_since(start));
+    start = profiling::Clock::now();
+
+    std::vector<TString> patterns = split_list(fixNPs);
+    if (!patterns.empty() && s.mc->GetNuisanceParameters()) {
+        int nFixed = 0;
+        for (auto arg : *s.mc->GetNuisanceParameters()) {
+            auto np = dynamic_cast<RooRealVar*>(arg);
+            if (np && matches_any(np->GetName(), patterns)) {
+                np->setConstant(true);
+                nFixed++;
+            }
+        }
+        std::cout << "Fixed " << nFixed << " nuisance parameters matching " << fixNPs << std::endl;
+    }
+
+    RooLinkedList nllOpts;
+    RooCmdArg offset = RooFit::Offset(true);
+    nllOpts.Add(&offset);
+    RooCmdArg backend, parallel;
+    if (s.opt.numCPU > 1) {
+        // RooFit's own option, forked processes each evaluating a share of the categories;
+        // RooFit only has it for the legacy backend. A per-category evaluator for cpu and
+        // codegen is not implemented, those vectorize within a category instead
+        if (s.opt.evalBackend != "legacy") {
+            std::cerr << "ERROR: numCPU=" << s.opt.numCPU << " needs the legacy backend, not " << s.opt.evalBackend << std::endl;
+            return false;
+        }
+        parallel = RooFit::NumCPU(s.opt.numCPU, RooFit::SimComponents);
+        nllOpts.Add(&parallel);
+    }
+    backend = eval_backend(s.opt.evalBackend);
+    nllOpts.Add(&backend);
+    RooCmdArg constrain, globs, condObs;
+    if (s.mc->GetNuisanceParameters()) {
+        constrain = RooFit::Constrain(*s.mc->GetNuisanceParameters());
+        nllOpts.Add(&constrain);
+    }
+    if (s.mc->GetGlobalObservables()) {
+        globs = RooFit::GlobalObservables(*s.mc->GetGlobalObservables());
+        nllOpts.Add(&globs);
+    }
+    if (s.mc->GetConditionalObservables()) {
+        condObs = RooFit::ConditionalObservables(*s.mc->GetConditionalObservables());
+        nllOpts.Add(&condObs);
+    }
+    try {
+        s.nll.reset(s.mc->GetPdf()->createNLL(*s.data, nllOpts));
+    } catch (const std::exception& e) {
+        if (s.opt.evalBackend != "codegen")
+            throw;
+        std::cout << "Cannot generate code for the NLL (" << e.what() << "), using the cpu backend" << std::endl;
+        s.opt.evalBackend = "cpu";
+        backend = eval_backend("cpu");
+        s.nll.reset(s.mc->GetPdf()->createNLL(*s.data, nllOpts));
+    }
+
+    std::unique_ptr<RooArgSet> params(s.nll->getParameters(*s.data->get()));
+    for (auto arg : *params) {
+        auto var = dynamic_cast<RooRealVar*>(arg);
+        if (var)
+            s.initial.push_back({var, var->getVal(), var->getError(), var->getMin(), var->getMax(), var->isConstant()});
+    }
+    for (auto arg : *s.mc->GetParametersOfInterest()) {
+        auto var = dynamic_cast<RooRealVar*>(arg);
+        if (var)
+            s.pois.push_back(var);
+    }
+    s.sessionTimer.add("nll", profiling::seconds_since(start));
+    if (s.opt.profile)
+        setup_profile(s);
+
+    s.minim.reset(new RooMinimizer(s.profiledNLL ? *s.profiledNLL : *s.nll));
+    s.minim->setEps(s.opt.minTolerance);
+    s.minim->setPrintLevel(-1);
+    s.minim->optimizeConst(2);
+    return true;
+}
+
+void restore_initial(FitServer& s) {
+    for (auto& p : s.initial) {
+        p.var->setRange(p.min, p.max);
+        p.var->setVal(p.value);
+        p.var->setError(p.error);
+        p.var->setConstant(p.constant);
+    }
+}
+
+int minimize(FitServer& s) {
+    s.minim->setStrategy(s.opt.strategy);
+    int status = s.minim->minimize("Minuit2", "Migrad");
+    if (status != 0 && s.opt.strategy < 2) {
+        // same fallback as quickFit: retry once with the more careful strategy
+        s.minim->setStrategy(2);
+        status = s.minim->minimize("Minuit2", "Migrad");
+    }
+    return status;
+}
+
+#endif
@@ -0,0 +1,187 @@
+// Profiling of a fitServer.C session: the category evaluation counts (ProfiledNLL), the
+// time of one evaluation per category, and the <output>.profile.json reports of a request
+// and of the session.
+#ifndef FIT_SERVER_PROFILE_HEADER
+#define FIT_SERVER_PROFILE_HEADER
+
+#include "fitServerState.h"
+
+#include <RooSimultaneous.h>
+#include <RooAbsPdf.h>
+#include <RooCmdArg.h>
+#include <RooGlobalFunc.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <unordered_map>
+
+// Categories of the RooSimultaneous and their parameters; the NLL is wrapped for the counts
+void setup_profile(FitServer& s) {
+    auto sim = dynamic_cast<RooSimultaneous*>(s.mc->GetPdf());
+    auto& prof = *(s.categories = std::make_unique<CategoryProfile>());
+    prof.ofParameter.resize(s.initial.size());
+    prof.last.assign(s.initial.size(), std::numeric_limits<double>::quiet_NaN());
+    if (sim) {
+        std::unordered_map<const RooAbsArg*, size_t> indexOf;
+        for (size_t i = 0; i < s.initial.size(); i++)
+            indexOf[s.initial[i].var] = i;
+        auto& cat = const_cast<RooAbsCategoryLValue&>(sim->indexCat());
+        for (int c = 0; c < cat.numTypes(); c++) {
+            cat.setBin(c);
+            RooAbsPdf* pdf = sim->getPdf(cat.getCurrentLabel());
+            if (!pdf)
+                continue;
+            std::unique_ptr<RooArgSet> params(pdf->getParameters(*s.data->get()));
+            size_t n = prof.names.size();
+            prof.names.push_back(cat.getCurrentLabel());
+            prof.nParameters.push_back(0);
+            for (auto arg : *params) {
+                auto found = indexOf.find(arg);
+                if (found == indexOf.end())
+                    continue;
+                prof.ofParameter[found->second].push_back(n);
+                prof.nParameters[n]++;
+            }
+        }
+    }
+    prof.touched.assign(prof.names.size(), 0);
+    prof.evals.assign(prof.names.size(), 0);
+    prof.sessionEvals.assign(prof.names.size(), 0);
+    prof.secondsPerEval.assign(prof.names.size(), std::numeric_limits<double>::quiet_NaN());
+    prof.counting = s.opt.evalBackend != "codegen";
+    if (prof.counting)
+        s.profiledNLL = std::make_unique<ProfiledNLL>(*s.nll, s.categories.get(), &s.initial);
+    std::cout << "Profiling " << prof.names.size() << " categories"
+         << (prof.counting ? "" : " (no evaluation counts with codegen)") << std::endl;
+}
+
+// Time of one evaluation of each category on its own at the current parameters: all its
+// parameters are moved slightly, so that the whole term is recomputed, best of 3
+void time_categories(FitServer& s) {
+    auto& prof = *s.categories;
+    auto sim = dynamic_cast<RooSimultaneous*>(s.mc->GetPdf());
+    if (!sim || prof.names.empty())
+        return;
+    if (!prof.data) {
+        prof.data.reset(s.data->split(sim->indexCat(), true));
+        // codegen would compile every category, cpu evaluates them the same way
+        RooCmdArg backend = eval_backend(s.opt.evalBackend == "codegen" ? TString("cpu") : s.opt.evalBackend);
+        for (auto& name : prof.names) {
+            auto data = dynamic_cast<RooAbsData*>(prof.data->FindObject(name.c_str()));
+            RooAbsPdf* pdf = sim->getPdf(name.c_str());
+            prof.probes.emplace_back(data && pdf ? pdf->createNLL(*data, backend) : nullptr);
+        }
+    }
+    std::vector<std::vector<RooRealVar*>> params(prof.names.size());
+    for (size_t i = 0; i < s.initial.size(); i++) {
+        for (size_t c : prof.ofParameter[i])
+            params[c].push_back(s.initial[i].var);
+    }
+    for (size_t c = 0; c < prof.names.size(); c++) {
+        if (!prof.probes[c])
+            continue;
+        double best = std::numeric_limits<double>::infinity();
+        for (int rep = 0; rep < 3; rep++) {
+            std::vector<double> values;
+            for (auto var : params[c]) {
+                values.push_back(var->getVal());
+                var->setVal(var->getVal() + 1e-7 * std::max(1.0, fabs(var->getVal())));
+            }
+            auto start = profiling::Clock::now();
+            prof.probes[c]->getVal();
+            best = std::min(best, profiling::seconds_since(start));
+            for (size_t k = 0; k < params[c].size(); k++)
+                params[c][k]->setVal(values[k]);
+        }
+        prof.secondsPerEval[c] = best;
+    }
+}
+
+// [{name, parameters, est_evals, secondsPerEval, est_seconds}, ...], the most expensive
+// first. Both are estimates, not measurements of the fits: est_evals counts the NLL calls
+// in which a parameter of the category moved, est_seconds multiplies that by secondsPerEval,
+// the best of 3 timings of the category's own NLL (time_categories)
+void write_categories(const FitServer& s, profiling::JsonWriter& json, const std::vector<long>& evals) {
+    auto& prof = *s.categories;
+    std::vector<size_t> order(prof.names.size());
+    for (size_t c = 0; c < order.size(); c++)
+        order[c] = c;
+    auto seconds = [&](size_t c) { return prof.secondsPerEval[c] * (prof.counting ? evals[c] : 1); };
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return seconds(a) > seconds(b); });
+    const char* probe = "secondsPerEval: best of 3 timings of the category NLL on its own";
+    json.value("categoriesMethod", std::string(probe) + (prof.counting
+        ? "; est_evals: NLL calls in which a parameter of the category moved; est_seconds: est_evals * secondsPerEval"
+        : "; no evaluation counts with codegen"));
+    json.begin_array("categories");
+    for (size_t c : order) {
+        json.begin_object();
+        json.value("name", prof.names[c]);
+        json.value("parameters", static_cast<long>(prof.nParameters[c]));
+        if (prof.counting) {
+            json.value("est_evals", evals[c]);
+            json.value("est_seconds", seconds(c));
+        } else {
+            json.null("est_evals");
+            json.null("est_seconds");
+        }
+        json.value("secondsPerEval", prof.secondsPerEval[c]);
+        json.end_object();
+    }
+    json.end_array();
+}
+
+// <output>.profile.json of one request
+void write_profile(const FitServer& s, const std::string& id, const std::string& outputFile, const profiling::PhaseTimer& timer,
+                   int status, double nllVal, bool cached, bool warm, int migradCalls, int hesseCalls) {
+    std::ostringstream out;
+    profiling::JsonWriter json(out);
+    json.begin_object();
+    json.value("tool", "fitServer");
+    json.value("id", id);
+    json.value("output", outputFile);
+    json.value("backend", s.opt.evalBackend.Data());
+    json.value("numCPU", s.opt.numCPU);
+    json.value("status", status);
+    json.value("nll", nllVal);
+    json.value("cached", cached);
+    json.value("warm", warm);
+    json.phases("phases", timer);
+    json.begin_object("minimizer");
+    json.value("migradCalls", migradCalls);
+    json.value("hesseCalls", hesseCalls);
+    json.end_object();
+    json.phases("session", s.sessionTimer);
+    if (s.categories)
+        write_categories(s, json, s.categories->evals);
+    json.end_object();
+    if (!profiling::write_report(profiling::report_path(outputFile), out.str()))
+        std::cerr << "WARNING: Cannot write the profile of " << outputFile << std::endl;
+}
+
+// Sums over the session, next to the store file
+void write_session_profile(const FitServer& s, const TString& storeFile) {
+    std::ostringstream out;
+    profiling::JsonWriter json(out);
+    json.begin_object();
+    json.value("tool", "fitServer");
+    json.value("store", storeFile.Data());
+    json.value("backend", s.opt.evalBackend.Data());
+    json.value("numCPU", s.opt.numCPU);
+    json.value("fits", s.sessionFits);
+    json.value("cached", s.sessionCached);
+    json.phases("phases", s.sessionTimer);
+    json.begin_object("minimizer");
+    json.value("migradCalls", s.migradCalls);
+    json.value("hesseCalls", s.hesseCalls);
+    json.end_object();
+    if (s.categories)
+        write_categories(s, json, s.categories->sessionEvals);
+    json.end_object();
+    if (!profiling::write_report(profiling::report_path(storeFile.Data()), out.str()))
+        std::cerr << "WARNING: Cannot write the session profile of " << storeFile << std::endl;
+}
+
+#endif
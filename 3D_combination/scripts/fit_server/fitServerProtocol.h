@@ -0,0 +1,282 @@
+// Requests of a fitServer.C session (the protocol at the top of fitServer.C): the POI and
+// seed strings, one FIT or WARM request from the POIs to the FITSERVER_RESULT line, VALUES,
+// and the loop reading the requests.
+#ifndef FIT_SERVER_PROTOCOL_HEADER
+#define FIT_SERVER_PROTOCOL_HEADER
+
+#include "fitServerState.h"
+#include "fitServerNLL.h"
+#include "fitServerProfile.h"
+#include "fitServerStore.h"
+#include "fitServerErrors.h"
+
+#include <TSystem.h>
+#include <RooFitResult.h>
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+// Apply a quickFit -p string: name=val, name=val_min_max or name. With keepFloating the
+// floating parameters keep their current value (moved into the new range if needed)
+bool apply_pois(FitServer& s, const TString& pois, std::string& error, bool keepFloating = false) {
+    for (auto& item : split_list(pois)) {
+        Ssiz_t eq = item.Index("=");
+        TString name = eq == kNPOS ? item : TString(item(0, eq));
+        RooRealVar* var = s.ws->var(name);
+        if (!var) {
+            error = "unknown parameter " + std::string(name.Data());
+            return false;
+        }
+        if (eq == kNPOS) {
+            var->setConstant(false);
+            continue;
+        }
+        std::vector<TString> fields = split_list(item(eq + 1, item.Length()), "_");
+        std::vector<double> numbers(fields.size());
+        for (size_t i = 0; i < fields.size(); i++) {
+            if (!to_double(fields[i], numbers[i])) {
+                error = "cannot parse " + std::string(item.Data());
+                return false;
+            }
+        }
+        if (numbers.size() == 1) {
+            if (numbers[0] < var->getMin())
+                var->setMin(numbers[0]);
+            if (numbers[0] > var->getMax())
+                var->setMax(numbers[0]);
+            var->setVal(numbers[0]);
+            var->setConstant(true);
+        } else if (numbers.size() == 3) {
+            double current = var->getVal();
+            var->setRange(numbers[1], numbers[2]);
+            var->setVal(keepFloating && !var->isConstant() ? current : numbers[0]);
+            var->setConstant(false);
+        } else {
+            error = "cannot parse " + std::string(item.Data());
+            return false;
+        }
+    }
+    return true;
+}
+
+// Starting values from the final parameters of a saved fit, e.g. a neighbouring scan point
+void apply_seed_file(FitServer& s, const TString& fileName) {
+    std::unique_ptr<TFile> f(TFile::Open(fileName));
+    auto result = f && !f->IsZombie() ? dynamic_cast<RooFitResult*>(f->Get("fitResult")) : nullptr;
+    if (!result) {
+        std::cerr << "WARNING: No fitResult in " << fileName << ", seeds ignored" << std::endl;
+        return;
+    }
+    for (auto arg : result->floatParsFinal()) {
+        RooRealVar* var = s.ws->var(arg->GetName());
+        if (var && !var->isConstant())
+            var->setVal(static_cast<RooRealVar*>(arg)->getVal());
+    }
+    delete result;
+}
+
+// Starting values only, the constness set by apply_pois is kept
+void apply_seeds(FitServer& s, const TString& seeds) {
+    if (seeds.BeginsWith("@")) {
+        apply_seed_file(s, seeds(1, seeds.Length()));
+        return;
+    }
+    if (seeds.BeginsWith("#")) {
+        auto found = s.finals.find(std::string(seeds(1, seeds.Length()).Data()));
+        if (found == s.finals.end()) {
+            std::cerr << "WARNING: No result " << seeds << " in this session, seeds ignored" << std::endl;
+            return;
+        }
+        for (size_t i = 0; i < s.initial.size(); i++) {
+            if (!s.initial[i].var->isConstant())
+                s.initial[i].var->setVal(found->second[i]);
+        }
+        return;
+    }
+    for (auto& item : split_list(seeds)) {
+        Ssiz_t eq = item.Index("=");
+        double value;
+        RooRealVar* var = eq == kNPOS ? nullptr : s.ws->var(TString(item(0, eq)));
+        if (var && !var->isConstant() && to_double(item(eq + 1, item.Length()), value))
+            var->setVal(value);
+    }
+}
+
+void handle_fit(FitServer& s, const std::string& id, const std::string& outputFile, const std::string& pois, const std::string& seeds,
+                bool warm, const std::string& cacheKey = "") {
+    auto start = std::chrono::steady_clock::now();
+    profiling::PhaseTimer timer;
+    if (s.categories)
+        std::fill(s.categories->evals.begin(), s.categories->evals.end(), 0);
+    TString poiString = pois == "-" ? "" : pois.c_str();
+    // warm: the fitted values, and with them the errors MIGRAD takes as step sizes, stay;
+    // the covariance of the previous fit is not passed on, MIGRAD starts a new estimate
+    if (!warm)
+        restore_initial(s);
+    std::string error;
+    if (!apply_pois(s, poiString, error, warm)) {
+        std::cout << "FITSERVER_ERROR " << id << " " << error << std::endl;
+        return;
+    }
+    timer.add("pois", profiling::seconds_since(start));
+
+    std::unique_ptr<RooFitResult> result;
+    double nllVal = 0;
+    int status = -1, calls = 0, migradCalls = 0;
+    bool useCache = s.opt.cacheDir != "" && !cacheKey.empty();
+    bool cached = false;
+    {
+        profiling::PhaseTimer::Scope phase(timer, "cache");
+        cached = useCache && !gSystem->AccessPathName(cache_path(s, cacheKey)) &&
+                 load_cached(s, cache_path(s, cacheKey), result, nllVal, status);
+    }
+    if (!cached) {
+        {
+            profiling::PhaseTimer::Scope phase(timer, "migrad");
+            apply_seeds(s, seeds.c_str());
+            if (s.profiledNLL)
+                s.profiledNLL->setValueDirty();
+            s.minim->zeroEvalCount();
+            status = minimize(s);
+            if (status != 0 && warm) {
+                std::cout << "Warm-started fit " << id << " failed (status " << status
+                     << "), refitting from the loaded state" << std::endl;
+                restore_initial(s);
+                if (!apply_pois(s, poiString, error)) {
+                    std::cout << "FITSERVER_ERROR " << id << " " << error << std::endl;
+                    return;
+                }
+                apply_seeds(s, seeds.c_str());
+                status = minimize(s);
+            }
+            migradCalls = s.minim->evalCounter();
+        }
+        bool forked = s.opt.errorWorkers > 1 && s.opt.numCPU == 1;
+        std::vector<RooRealVar*> minosPOIs;
+        RooArgSet minosSet;
+        for (auto poi : s.minosPOIs) {
+            if (!poi->isConstant()) {
+                minosPOIs.push_back(poi);
+                minosSet.add(*poi);
+            }
+        }
+        if (s.opt.hesse && !forked) {
+            profiling::PhaseTimer::Scope phase(timer, "hesse");
+            s.minim->hesse();
+        }
+        if (!minosPOIs.empty() && !forked) {
+            profiling::PhaseTimer::Scope phase(timer, "minos");
+            s.minim->minos(minosSet);
+        }
+        calls = s.minim->evalCounter();
+        {
+            profiling::PhaseTimer::Scope phase(timer, "result");
+            result.reset(s.minim->save("fitResult", "fitResult"));
+        }
+        if (s.opt.hesse && forked) {
+            profiling::PhaseTimer::Scope phase(timer, "hesse");
+            if (!parallel_hesse(s, *result, calls)) {
+                std::cout << "Parallel HESSE failed for fit " << id << ", running it serially" << std::endl;
+                s.minim->hesse();
+                calls = s.minim->evalCounter();
+                result.reset(s.minim->save("fitResult", "fitResult"));
+            }
+        }
+        if (!minosPOIs.empty() && forked) {
+            profiling::PhaseTimer::Scope phase(timer, "minos");
+            parallel_minos(s, *result, minosPOIs, calls);
+        }
+        profiling::PhaseTimer::Scope phase(timer, "result");
+
+        // absolute NLL, so that values from different servers can be compared
+        s.nll->enableOffsetting(false);
+        nllVal = s.nll->getVal();
+        s.nll->enableOffsetting(true);
+        if (useCache && status == 0)
+            write_cache(s, cacheKey, result.get(), nllVal, status);
+    }
+
+    if (outputFile != "-") {
+        profiling::PhaseTimer::Scope phase(timer, "output");
+        write_output(s, outputFile.c_str(), result.get(), nllVal, status);
+    }
+    std::vector<double>& final = s.finals[id];
+    final.resize(s.initial.size());
+    for (size_t i = 0; i < s.initial.size(); i++)
+        final[i] = s.initial[i].var->getVal();
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (s.store) {
+        profiling::PhaseTimer::Scope phase(timer, "store");
+        fill_store(s, result.get(), nllVal, status, seconds, calls);
+    }
+    std::cout << std::setprecision(12) << "FITSERVER_RESULT " << id << " status=" << status << " nll=" << nllVal
+         << " time=" << seconds << " calls=" << calls << (cached ? " cached=1" : "");
+    for (auto poi : s.pois)
+        std::cout << " " << poi->GetName() << "=" << poi->getVal();
+    std::cout << std::endl;
+
+    s.sessionFits++;
+    s.sessionCached += cached ? 1 : 0;
+    s.migradCalls += migradCalls;
+    s.hesseCalls += calls - migradCalls;
+    for (auto& p : timer.phases())
+        s.sessionTimer.add(p.first, p.second);
+    if (s.opt.profile) {
+        if (s.categories && !cached && !s.categories->names.empty() && std::isnan(s.categories->secondsPerEval.front())) {
+            auto probeStart = profiling::Clock::now();
+            time_categories(s);
+            s.sessionTimer.add("categoryTiming", profiling::seconds_since(probeStart));
+        }
+        if (outputFile != "-")
+            write_profile(s, id, outputFile, timer, status, nllVal, cached, warm, migradCalls, calls - migradCalls);
+    }
+}
+
+void print_values(const FitServer& s, const std::string& id) {
+    auto found = s.finals.find(id);
+    if (found == s.finals.end()) {
+        std::cout << "FITSERVER_ERROR " << id << " no result " << id << " in this session" << std::endl;
+        return;
+    }
+    std::cout << std::setprecision(12) << "FITSERVER_VALUES " << id;
+    for (size_t i = 0; i < s.initial.size(); i++) {
+        if (!s.initial[i].constant)
+            std::cout << " " << s.initial[i].var->GetName() << "=" << found->second[i];
+    }
+    std::cout << std::endl;
+}
+
+// Answers the requests on stdin until QUIT or the end of the input
+void serve(FitServer& s) {
+    std::string line, cacheKey;
+    while (std::getline(std::cin, line)) {
+        std::istringstream tokens(line);
+        std::string command, id, outputFile, pois, seeds;
+        if (!(tokens >> command))
+            continue;
+        if (command == "QUIT")
+            break;
+        if (command == "CACHE") {
+            tokens >> cacheKey;
+            continue;
+        }
+        if (command == "VALUES") {
+            tokens >> id;
+            print_values(s, id);
+            continue;
+        }
+        if ((command != "FIT" && command != "WARM") || !(tokens >> id >> outputFile >> pois)) {
+            std::cout << "FITSERVER_ERROR " << (id.empty() ? "-" : id) << " bad request: " << line << std::endl;
+            cacheKey.clear();
+            continue;
+        }
+        tokens >> seeds;
+        handle_fit(s, id, outputFile, pois, seeds, command == "WARM", cacheKey);
+        cacheKey.clear();
+    }
+}
+
+#endif
@@ -0,0 +1,273 @@
+// State of a fitServer.C session: the options, the loaded model, the minimizer kept between
+// requests, the store row and the profiling counters, and the list helpers the other parts
+// share (comma separated lists, numbers, quickFit-style wildcards).
+#ifndef FIT_SERVER_STATE_HEADER
+#define FIT_SERVER_STATE_HEADER
+
+#include <TFile.h>
+#include <TTree.h>
+#include <TList.h>
+#include <TRegexp.h>
+#include <TString.h>
+#include <TObjArray.h>
+#include <TObjString.h>
+#include <RooWorkspace.h>
+#include <RooRealVar.h>
+#include <RooAbsData.h>
+#include <RooAbsReal.h>
+#include <RooMinimizer.h>
+#include <RooRealProxy.h>
+#include <RooCmdArg.h>
+#include <RooGlobalFunc.h>
+#include <RooStats/ModelConfig.h>
+#include <RVersion.h>
+
+#include "../../run_combination/1_ws_editing/profileReport.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Value, error, range and constness of a parameter right after loading
+struct ParameterState {
+    RooRealVar* var;
+    double value, error, min, max;
+    bool constant;
+};
+
+// Per category of the RooSimultaneous: the NLL calls in which one of its parameters moved,
+// which is when RooFit re-evaluates its term (it caches the value of each category term)
+struct CategoryProfile {
+    std::vector<std::string> names;
+    std::vector<size_t> nParameters;
+    std::vector<std::vector<size_t>> ofParameter;  // categories of each parameter (index into initial)
+    std::vector<double> last;                      // parameter values at the previous NLL call
+    std::vector<char> touched;
+    std::vector<long> evals, sessionEvals;
+    long calls = 0;
+    bool counting = false;  // false if the NLL is not wrapped (codegen)
+    // one NLL per category on its own data, only for timing
+    std::unique_ptr<TList> data;
+    std::vector<std::unique_ptr<RooAbsReal>> probes;
+    std::vector<double> secondsPerEval;
+
+    void record(const std::vector<ParameterState>& params) {
+        calls++;
+        for (size_t i = 0; i < params.size(); i++) {
+            double value = params[i].var->getVal();
+            if (value == last[i])
+                continue;
+            last[i] = value;
+            for (size_t c : ofParameter[i])
+                touched[c] = 1;
+        }
+        for (size_t c = 0; c < touched.size(); c++) {
+            if (touched[c]) {
+                evals[c]++;
+                sessionEvals[c]++;
+                touched[c] = 0;
+            }
+        }
+    }
+};
+
+// The NLL as seen by the minimizer when profiling: forwards the value and counts the
+// category evaluations of every call
+class ProfiledNLL : public RooAbsReal {
+public:
+    ProfiledNLL() = default;
+    ProfiledNLL(RooAbsReal& nll, CategoryProfile* profile, const std::vector<ParameterState>* params)
+        : RooAbsReal("profiledNLL", "profiledNLL"), _nll("nll", "nll", this, nll), _profile(profile), _params(params) {}
+    ProfiledNLL(const ProfiledNLL& other, const char* name = nullptr)
+        : RooAbsReal(other, name), _nll("nll", this, other._nll), _profile(other._profile), _params(other._params) {}
+    TObject* clone(const char* newname) const override { return new ProfiledNLL(*this, newname); }
+    void enableOffsetting(bool flag) override { const_cast<RooAbsReal&>(_nll.arg()).enableOffsetting(flag); }
+    bool isOffsetting() const override { return _nll.arg().isOffsetting(); }
+    // 0.5 of the NLL, not the 1 of a generic RooAbsReal, for the MINUIT errors
+    double defaultErrorLevel() const override { return _nll.arg().defaultErrorLevel(); }
+
+protected:
+    double evaluate() const override {
+        _profile->record(*_params);
+        return _nll;
+    }
+
+private:
+    RooRealProxy _nll;
+    CategoryProfile* _profile = nullptr;                   //!
+    const std::vector<ParameterState>* _params = nullptr;  //!
+
+    ClassDefOverride(ProfiledNLL, 0)
+};
+
+#ifdef __ROOTCLING__
+#pragma link C++ class ProfiledNLL+;
+#endif
+
+// Settings of a server session, read from the options file of fitServer(): one key=value
+// per line with the keys below, # starts a comment; keys that are not given keep these
+// defaults
+struct FitServerOptions {
+    TString wsName = "combWS";
+    TString mcName = "ModelConfig";
+    TString dataName = "combData";
+    TString fixNPs;            // NPs fixed for the session, quickFit -n syntax
+    double minTolerance = 1e-4;
+    int strategy = 1;
+    bool hesse = false;
+    TString evalBackend = "legacy";
+    int numCPU = 1;
+    TString storeFile;
+    TString storeNPs;          // NPs kept in the store, wildcards
+    TString channels;          // split input: parameters the requests float or move
+    TString cacheDir;
+    bool profile = false;
+    int errorWorkers = 1;      // HESSE and MINOS over forked workers if > 1
+    TString minosPOIs;         // POIs with MINOS errors, wildcards
+    bool polyFormulas = false;
+};
+
+struct FitServer {
+    std::unique_ptr<TFile> file;
+    RooWorkspace* ws = nullptr;
+    std::unique_ptr<RooWorkspace> splitWs;  // owns ws for a split input
+    RooStats::ModelConfig* mc = nullptr;
+    RooAbsData* data = nullptr;
+    std::unique_ptr<RooAbsReal> nll;
+    // kept between requests, so that WARM fits continue where the last one stopped
+    std::unique_ptr<RooMinimizer> minim;
+    std::vector<ParameterState> initial;
+    std::vector<RooRealVar*> pois;
+    FitServerOptions opt;
+    // POIs with MINOS errors
+    std::vector<RooRealVar*> minosPOIs;
+    // final values of all parameters (in the order of initial) per request id, for #<id> seeds
+    std::map<std::string, std::vector<double>> finals;
+    // scan store: one row per answer, the branches point into row
+    std::unique_ptr<TFile> storeFile;
+    TTree* store = nullptr;
+    std::vector<RooRealVar*> storeNPs;
+    struct {
+        double nll = 0, time = 0;
+        int status = -1, calls = 0;
+        std::vector<double> values;
+        std::vector<double> corr;  // POI pairs, with hesse
+    } row;
+    // profiling: the minimizer runs on profiledNLL if it is set
+    std::unique_ptr<CategoryProfile> categories;
+    std::unique_ptr<ProfiledNLL> profiledNLL;
+    profiling::PhaseTimer sessionTimer;  // load, NLL build, and the sums of the request phases
+    long sessionFits = 0, sessionCached = 0, migradCalls = 0, hesseCalls = 0;
+};
+
+std::vector<TString> split_list(const TString& list, const char* sep = ",") {
+    std::vector<TString> items;
+    std::unique_ptr<TObjArray> tokens(list.Tokenize(sep));
+    for (int i = 0; i < tokens->GetEntries(); i++) {
+        TString item = static_cast<TObjString*>(tokens->At(i))->GetString().Strip(TString::kBoth);
+        if (item != "")
+            items.push_back(item);
+    }
+    return items;
+}
+
+bool to_double(const TString& text, double& value) {
+    char* end = nullptr;
+    value = strtod(text.Data(), &end);
+    return end != text.Data() && *end == '\0';
+}
+
+// quickFit -n semantics: comma separated list of names with * wildcards
+bool matches_any(const TString& name, const std::vector<TString>& patterns) {
+    for (auto& pattern : patterns) {
+        TRegexp re(pattern, kTRUE);
+        Ssiz_t len = 0;
+        if (re.Index(name, &len) == 0 && len == name.Length())
+            return true;
+    }
+    return false;
+}
+
+// RooFit option selecting the evaluation backend: EvalBackend from ROOT 6.30; before that
+// cpu is BatchMode and legacy the scalar path, and there is no codegen (read_options
+// refuses it)
+RooCmdArg eval_backend(const TString& name) {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 30, 0)
+    return RooFit::EvalBackend(name.Data());
+#else
+    return RooFit::BatchMode(name == "cpu");
+#endif
+}
+
+// Fills opt from the options file; false with error set for an unreadable file, an unknown
+// key or a value that does not parse
+bool read_options(const TString& fileName, FitServerOptions& opt, std::string& error) {
+    auto text = [](TString& field) {
+        return [&field](const TString& value) { field = value; return true; };
+    };
+    auto integer = [](int& field) {
+        return [&field](const TString& value) { field = value.Atoi(); return value.IsDigit(); };
+    };
+    auto number = [](double& field) {
+        return [&field](const TString& value) { return to_double(value, field); };
+    };
+    auto flag = [](bool& field) {
+        return [&field](const TString& value) {
+            field = value == "1" || value == "true";
+            return field || value == "0" || value == "false";
+        };
+    };
+    std::map<std::string, std::function<bool(const TString&)>> setters = {
+        {"wsName", text(opt.wsName)},           {"mcName", text(opt.mcName)},
+        {"dataName", text(opt.dataName)},       {"fixNPs", text(opt.fixNPs)},
+        {"minTolerance", number(opt.minTolerance)}, {"strategy", integer(opt.strategy)},
+        {"hesse", flag(opt.hesse)},             {"evalBackend", text(opt.evalBackend)},
+        {"numCPU", integer(opt.numCPU)},        {"storeFile", text(opt.storeFile)},
+        {"storeNPs", text(opt.storeNPs)},       {"channels", text(opt.channels)},
+        {"cacheDir", text(opt.cacheDir)},       {"profile", flag(opt.profile)},
+        {"errorWorkers", integer(opt.errorWorkers)}, {"minosPOIs", text(opt.minosPOIs)},
+        {"polyFormulas", flag(opt.polyFormulas)},
+    };
+    std::ifstream in(fileName.Data());
+    if (!in) {
+        error = "cannot read " + std::string(fileName.Data());
+        return false;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        TString item = TString(line.substr(0, line.find('#'))).Strip(TString::kBoth);
+        if (item == "")
+            continue;
+        Ssiz_t eq = item.Index("=");
+        TString key = eq == kNPOS ? item : TString(item(0, eq));
+        TString value = eq == kNPOS ? TString() : TString(item(eq + 1, item.Length()));
+        key = key.Strip(TString::kBoth);
+        value = value.Strip(TString::kBoth);
+        auto found = setters.find(key.Data());
+        if (found == setters.end()) {
+            error = "unknown option " + std::string(key.Data());
+            return false;
+        }
+        if (eq == kNPOS || !found->second(value)) {
+            error = "cannot parse " + std::string(item.Data());
+            return false;
+        }
+    }
+    if (opt.evalBackend != "legacy" && opt.evalBackend != "cpu" && opt.evalBackend != "codegen") {
+        error = "unknown evalBackend " + std::string(opt.evalBackend.Data());
+        return false;
+    }
+#if ROOT_VERSION_CODE < ROOT_VERSION(6, 30, 0)
+    if (opt.evalBackend == "codegen") {
+        error = "evalBackend=codegen needs ROOT 6.30 or later, this is " + std::string(ROOT_RELEASE);
+        return false;
+    }
+#endif
+    return true;
+}
+
+#endif
@@ -0,0 +1,164 @@
+// Results of a fitServer.C session on disk: the scan store (one nllscan row per answer),
+// the per-request output files and the fit cache entries.
+#ifndef FIT_SERVER_STORE_HEADER
+#define FIT_SERVER_STORE_HEADER
+
+#include "fitServerState.h"
+
+#include <TSystem.h>
+#include <RooFitResult.h>
+
+#include <iostream>
+#include <limits>
+
+// Scan store with a fixed schema: the POIs and the NPs matching npPatterns are known
+// after loading, so every row has the same columns
+bool open_store(FitServer& s, const TString& storeFile, const TString& npPatterns) {
+    s.storeFile.reset(TFile::Open(storeFile, "RECREATE"));
+    if (!s.storeFile || s.storeFile->IsZombie()) {
+        std::cerr << "ERROR: Cannot write " << storeFile << std::endl;
+        return false;
+    }
+    std::vector<TString> patterns = split_list(npPatterns);
+    if (!patterns.empty() && s.mc->GetNuisanceParameters()) {
+        for (auto arg : *s.mc->GetNuisanceParameters()) {
+            auto np = dynamic_cast<RooRealVar*>(arg);
+            if (np && matches_any(np->GetName(), patterns))
+                s.storeNPs.push_back(np);
+        }
+    }
+    s.store = new TTree("nllscan", "nllscan");
+    s.store->SetDirectory(s.storeFile.get());
+    s.store->Branch("nll", &s.row.nll);
+    s.store->Branch("status", &s.row.status);
+    s.store->Branch("time", &s.row.time);
+    s.store->Branch("calls", &s.row.calls);
+    // per POI the value and the quickFit-style <poi>__up/__down errors, then the NPs
+    s.row.values.resize(3 * s.pois.size() + s.storeNPs.size());
+    for (size_t i = 0; i < s.pois.size(); i++) {
+        TString name = s.pois[i]->GetName();
+        s.store->Branch(name, &s.row.values[3 * i]);
+        s.store->Branch(name + "__up", &s.row.values[3 * i + 1]);
+        s.store->Branch(name + "__down", &s.row.values[3 * i + 2]);
+    }
+    for (size_t i = 0; i < s.storeNPs.size(); i++)
+        s.store->Branch(s.storeNPs[i]->GetName(), &s.row.values[3 * s.pois.size() + i]);
+    if (s.opt.hesse) {
+        s.row.corr.resize(s.pois.size() * (s.pois.size() - 1) / 2);
+        size_t k = 0;
+        for (size_t i = 0; i < s.pois.size(); i++) {
+            for (size_t j = i + 1; j < s.pois.size(); j++)
+                s.store->Branch(Form("corr__%s__%s", s.pois[i]->GetName(), s.pois[j]->GetName()), &s.row.corr[k++]);
+        }
+    }
+    std::cout << "Storing the results in " << storeFile << " (" << s.pois.size() << " POIs, " << s.storeNPs.size()
+         << " NPs)" << std::endl;
+    return true;
+}
+
+void fill_store(FitServer& s, const RooFitResult* result, double nllVal, int status, double seconds, int calls) {
+    s.row.nll = nllVal;
+    s.row.status = status;
+    s.row.time = seconds;
+    s.row.calls = calls;
+    for (size_t i = 0; i < s.pois.size(); i++) {
+        RooRealVar* poi = s.pois[i];
+        s.row.values[3 * i] = poi->getVal();
+        s.row.values[3 * i + 1] = poi->getErrorHi() != 0 ? poi->getErrorHi() : poi->getError();
+        s.row.values[3 * i + 2] = poi->getErrorLo() != 0 ? poi->getErrorLo() : -poi->getError();
+    }
+    for (size_t i = 0; i < s.storeNPs.size(); i++)
+        s.row.values[3 * s.pois.size() + i] = s.storeNPs[i]->getVal();
+    // NaN for a POI that was fixed in this fit
+    size_t k = 0;
+    for (size_t i = 0; i < s.pois.size() && !s.row.corr.empty(); i++) {
+        for (size_t j = i + 1; j < s.pois.size(); j++) {
+            const char *a = s.pois[i]->GetName(), *b = s.pois[j]->GetName();
+            bool floating = result && result->floatParsFinal().find(a) && result->floatParsFinal().find(b);
+            s.row.corr[k++] = floating ? result->correlation(a, b) : std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+    s.store->Fill();
+    // readable up to the last fit if the job is killed
+    s.store->AutoSave("SaveSelf");
+}
+
+void close_store(FitServer& s) {
+    if (!s.storeFile)
+        return;
+    s.storeFile->cd();
+    s.store->Write("", TObject::kOverwrite);
+    s.storeFile->Close();
+    s.storeFile.reset();
+    s.store = nullptr;
+}
+
+void write_output(const FitServer& s, const TString& outputFile, RooFitResult* result, double nllVal, int status) {
+    TFile out(outputFile, "RECREATE");
+    if (out.IsZombie()) {
+        std::cerr << "ERROR: Cannot write " << outputFile << std::endl;
+        return;
+    }
+    result->Write("fitResult");
+    TTree tree("nllscan", "nllscan");
+    tree.Branch("nll", &nllVal);
+    tree.Branch("status", &status);
+    std::vector<double> values(s.pois.size());
+    for (size_t i = 0; i < s.pois.size(); i++) {
+        values[i] = s.pois[i]->getVal();
+        tree.Branch(s.pois[i]->GetName(), &values[i]);
+    }
+    tree.Fill();
+    tree.Write();
+    out.Close();
+}
+
+TString cache_path(const FitServer& s, const std::string& key) {
+    return Form("%s/%s/%s.root", s.opt.cacheDir.Data(), key.substr(0, 2).c_str(), key.c_str());
+}
+
+// Parameters from a cached fit: final values and errors of the floating ones, the values
+// of the constant ones (the POI string of the request already set constness and ranges)
+bool load_cached(FitServer& s, const TString& fileName, std::unique_ptr<RooFitResult>& result, double& nllVal,
+                 int& status) {
+    std::unique_ptr<TFile> f(TFile::Open(fileName));
+    result.reset(f && !f->IsZombie() ? f->Get<RooFitResult>("fitResult") : nullptr);
+    TTree* tree = result ? f->Get<TTree>("nllscan") : nullptr;
+    if (!tree || tree->GetEntries() < 1) {
+        std::cerr << "WARNING: Unreadable cache entry " << fileName << ", fitting" << std::endl;
+        return false;
+    }
+    tree->SetBranchAddress("nll", &nllVal);
+    tree->SetBranchAddress("status", &status);
+    tree->GetEntry(0);
+    for (auto arg : result->constPars()) {
+        RooRealVar* var = s.ws->var(arg->GetName());
+        if (var)
+            var->setVal(static_cast<RooRealVar*>(arg)->getVal());
+    }
+    for (auto arg : result->floatParsFinal()) {
+        auto cached = static_cast<RooRealVar*>(arg);
+        RooRealVar* var = s.ws->var(arg->GetName());
+        if (!var)
+            continue;
+        var->setVal(cached->getVal());
+        var->setError(cached->getError());
+        if (cached->hasAsymError())
+            var->setAsymError(cached->getAsymErrorLo(), cached->getAsymErrorHi());
+        else
+            var->removeAsymError();
+    }
+    return true;
+}
+
+// written aside and renamed, so that concurrent servers never read a partial entry
+void write_cache(const FitServer& s, const std::string& key, RooFitResult* result, double nllVal, int status) {
+    TString path = cache_path(s, key);
+    gSystem->mkdir(gSystem->GetDirName(path), true);
+    TString tmp = path + Form(".%d.tmp", gSystem->GetPid());
+    write_output(s, tmp, result, nllVal, status);
+    if (gSystem->Rename(tmp, path) != 0)
+        gSystem->Unlink(tmp);
+}
+
+#endif
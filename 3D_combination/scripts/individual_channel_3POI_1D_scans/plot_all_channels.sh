@@ -123,60 +123,11 @@ convert_root_to_txt() {
     local poi=$2
     local output_txt=$3
     
-    python3 << PYTHON
-import ROOT
-import glob
-import os
-
-ROOT.gROOT.SetBatch(True)
-
-input_dirs = "${input_dirs}".split()
-poi = "${poi}"
-output_txt = "${output_txt}"
-
-# Collect files from all input directories
-files = []
-for input_dir in input_dirs:
-    pattern = os.path.join(input_dir, f'fit_{poi}_*.root')
-    files.extend(sorted(glob.glob(pattern)))
-
-if not files:
-    print(f"WARNING: No ROOT files found in: {input_dirs}")
-    exit(0)
-
-data_points = []
-for fpath in files:
-    f = ROOT.TFile.Open(fpath)
-    if not f or f.IsZombie():
-        continue
-    tree = f.Get('nllscan')
-    if not tree:
-        f.Close()
-        continue
-    tree.GetEntry(0)
-    try:
-        poi_val = getattr(tree, poi)
-        nll = tree.nll
-        status = getattr(tree, 'status', 0)
-        data_points.append((poi_val, nll, int(status)))
-    except:
-        pass
-    f.Close()
-
-if not data_points:
-    print(f"WARNING: No valid data points extracted")
-    exit(0)
-
-data_points.sort(key=lambda x: x[0])
-
-os.makedirs(os.path.dirname(output_txt) or '.', exist_ok=True)
-with open(output_txt, 'w') as f:
-    f.write(f"{poi}   nll   status\\n")
-    for poi_val, nll, status in data_points:
-        f.write(f"{poi_val:.6f}  {nll:.6f}  {status}\\n")
-
-print(f"Created: {output_txt} ({len(data_points)} points)")
-PYTHON
+    # Reads the result store of each scan, or its fit_<poi>_*.root files
+    python3 "${SCRIPT_DIR}/../utils/converters.py" \
+        --indir ${input_dirs} --out "${output_txt}" --poi "${poi}" \
+        --pattern "fit_${poi}_*.root" \
+        || echo "WARNING: No valid data points extracted from: ${input_dirs}"
 }
 
 echo "=============================================="
@@ -2,8 +2,9 @@
 # =============================================================================
 # convert_scans.sh - Convert ROOT scan results to text format
 # =============================================================================
-# Converts quickFit scan output ROOT files to text format for plotting
-# with RooFitUtils plotscan.py.
+# Converts scan results to text format for plotting with RooFitUtils
+# plotscan.py: the result store of the scan (scan.root, see
+# utils/scan_store.py) or its per-point quickFit output ROOT files.
 #
 # Usage:
 #   ./convert_scans.sh --type 1d --tag linear_obs_cHWtil_combine_parallel
@@ -37,12 +38,12 @@ Optional:
   --output <file>       Output text file (default: derived from tag)
   --poi <name>          POI name (default: derived from tag)
   --poi2 <name>         Second POI name (for 2D, default: derived from tag)
-  --pattern <glob>      File pattern (default: fit_*.root)
+  --pattern <glob>      Per-point file pattern if the scan has no result store (default: fit_*.root)
   -h, --help            Show this help message
 
 The output format is compatible with RooFitUtils plotscan.py:
-  1D: poi deltaNLL
-  2D: poi1 poi2 deltaNLL
+  1D: poi nll status
+  2D: poi1 poi2 nll status
 
 Examples:
   # Convert 1D scan
@@ -45,50 +45,10 @@ convert_root_to_txt() {
     local poi2="$3"
     local output_txt="$4"
     
-    python3 << EOF
-import ROOT
-import glob
-import os
-ROOT.gROOT.SetBatch(True)
-
-root_dir = "${root_dir}"
-poi1 = "${poi1}"
-poi2 = "${poi2}"
-output = "${output_txt}"
-
-files = sorted(glob.glob(os.path.join(root_dir, 'fit_*.root')))
-print(f'  Reading {len(files)} ROOT files...')
-
-data = []
-for fpath in files:
-    f = ROOT.TFile.Open(fpath)
-    if not f or f.IsZombie():
-        continue
-    tree = f.Get('nllscan')
-    if not tree:
-        f.Close()
-        continue
-    tree.GetEntry(0)
-    try:
-        v1 = getattr(tree, poi1)
-        v2 = getattr(tree, poi2)
-        nll = tree.nll
-        status = 0  # assume converged
-        data.append((v1, v2, nll, status))
-    except:
-        pass
-    f.Close()
-
-# Sort by poi1, then poi2
-data.sort(key=lambda x: (x[0], x[1]))
-
-# Write txt file in plotscan format
-with open(output, 'w') as out:
-    out.write(f'{poi1}   {poi2}   nll   status\n')
-    for v1, v2, nll, status in data:
-        out.write(f'{v1:f}  {v2:f}  {nll:.6f}  {status}\n')
-print(f'  Wrote {len(data)} points to {output}')
-EOF
+    # reads the result store of the scan, or its fit_*.root files
+    python3 "${SCRIPT_DIR}/../utils/converters.py" \
+        --indir "${root_dir}" --out "${output_txt}" --poi "${poi1}" --poi2 "${poi2}" \
+        || echo "Warning: no scan points converted from ${root_dir}"
 }
 
 # Track total plots
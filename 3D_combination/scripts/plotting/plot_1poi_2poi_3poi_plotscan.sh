@@ -37,51 +37,10 @@ convert_root_to_txt() {
     local scanned_poi=$2
     local output_txt=$3
     
-    # Use Python to convert ROOT to txt
-    python3 << PYTHON
-import ROOT
-import glob
-import os
-
-ROOT.gROOT.SetBatch(True)
-
-input_dir = "${input_dir}"
-scanned_poi = "${scanned_poi}"
-output_txt = "${output_txt}"
-
-pattern = os.path.join(input_dir, f'fit_{scanned_poi}_*.root')
-files = sorted(glob.glob(pattern))
-
-if not files:
-    print(f"No ROOT files found: {pattern}")
-    exit(1)
-
-data_points = []
-for fpath in files:
-    f = ROOT.TFile.Open(fpath)
-    if not f or f.IsZombie():
-        continue
-    tree = f.Get('nllscan')
-    if not tree:
-        f.Close()
-        continue
-    tree.GetEntry(0)
-    poi_val = getattr(tree, scanned_poi)
-    nll = tree.nll
-    status = getattr(tree, 'status', 0)
-    data_points.append((poi_val, nll, int(status)))
-    f.Close()
-
-data_points.sort(key=lambda x: x[0])
-
-os.makedirs(os.path.dirname(output_txt) or '.', exist_ok=True)
-with open(output_txt, 'w') as f:
-    f.write(f"{scanned_poi}   nll   status\n")
-    for poi_val, nll, status in data_points:
-        f.write(f"{poi_val:.6f}  {nll:.6f}  {status}\n")
-
-print(f"Created: {output_txt} ({len(data_points)} points)")
-PYTHON
+    # Reads the result store of the scan, or its fit_<poi>_*.root files
+    python3 "$(dirname "${BASH_SOURCE[0]}")/../utils/converters.py" \
+        --indir "${input_dir}" --out "${output_txt}" --poi "${scanned_poi}" \
+        --pattern "fit_${scanned_poi}_*.root"
 }
 
 # Function to generate plots for a given model
@@ -25,6 +25,11 @@ import matplotlib.pyplot as plt
 from matplotlib import colors
 from scipy.interpolate import griddata
 
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from utils import scan_store
+
 def extract_poi_values_from_filename(filename, poi1_name, poi2_name):
     """Extract POI values from filename like fit_cHWtil_combine_-0.0345__cHBtil_combine_-0.0517.root"""
     basename = os.path.basename(filename)
@@ -49,6 +54,17 @@ def read_2d_scan_data(input_dir, poi1, poi2, floating_poi):
         print("Error: ROOT is not available. Please set up the ATLAS environment.")
         sys.exit(1)
     
+    # A scan with the result store has all points in one file
+    if scan_store.store_files(input_dir):
+        up, down = f'{floating_poi}__up', f'{floating_poi}__down'
+        scan = scan_store.read_scan(input_dir, [poi1, poi2, 'nll', 'status', floating_poi, up, down],
+                                    keys=[poi1, poi2])
+        print(f"Found {len(scan.get('nll', []))} 2D scan points in the result store")
+        data = {'poi1': scan[poi1], 'poi2': scan[poi2], 'nll': scan['nll'],
+                'floating_poi': scan[floating_poi], 'floating_poi_up': scan[up], 'floating_poi_down': scan[down]}
+        data['deltaNLL'] = 2 * (data['nll'] - np.min(data['nll']))
+        return data
+    
     # Find all ROOT files
     pattern = os.path.join(input_dir, f'fit_{poi1}_*__{poi2}_*.root')
     files = sorted(glob.glob(pattern))
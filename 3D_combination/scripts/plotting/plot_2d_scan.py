@@ -15,6 +15,7 @@ Usage:
     python plot_2d_scan.py --input scan_obs.txt --poi1 cHWtil_combine --poi2 cHBtil_combine
     python plot_2d_scan.py --input scan_obs.txt --input scan_exp.txt --labels Obs Exp
     python plot_2d_scan.py --root-file scan.root --poi1 cHWtil --poi2 cHBtil
+    python plot_2d_scan.py --root-file root_<tag>/scan.root --poi1 cHWtil_combine --poi2 cHBtil_combine
 
 Author: HVV CP Combination Analysis
 """
@@ -25,6 +26,11 @@ import sys
 import numpy as np
 from typing import Dict, List, Optional, Tuple
 
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from utils import scan_store
+
 # Check for ROOT
 try:
     import ROOT
@@ -101,6 +107,13 @@ def read_root_file(filepath: str, poi1: str, poi2: str,
     if not HAS_ROOT:
         raise ImportError("ROOT not available")
     
+    if tree_name == scan_store.TREE_NAME:
+        # also a result store, where a retried point has more than one row
+        data = scan_store.read_scan(filepath, [poi1, poi2, 'nll', 'status'], keys=[poi1, poi2])
+        if not data:
+            raise IOError(f"No scan points in {filepath}")
+        return data[poi1], data[poi2], data['nll']
+    
     tfile = ROOT.TFile.Open(filepath)
     if not tfile or tfile.IsZombie():
         raise IOError(f"Cannot open {filepath}")
@@ -109,16 +122,9 @@ def read_root_file(filepath: str, poi1: str, poi2: str,
     if not tree:
         raise ValueError(f"Tree '{tree_name}' not found in {filepath}")
     
-    poi1_vals, poi2_vals, nll_vals = [], [], []
-    
-    for i in range(tree.GetEntries()):
-        tree.GetEntry(i)
-        poi1_vals.append(getattr(tree, poi1))
-        poi2_vals.append(getattr(tree, poi2))
-        nll_vals.append(tree.nll)
-    
+    columns = ROOT.RDataFrame(tree).AsNumpy([poi1, poi2, 'nll'])
     tfile.Close()
-    return np.array(poi1_vals), np.array(poi2_vals), np.array(nll_vals)
+    return np.asarray(columns[poi1]), np.asarray(columns[poi2]), np.asarray(columns['nll'])
 
 
 def compute_delta_nll(nll_vals: np.ndarray) -> np.ndarray:
@@ -23,6 +23,11 @@ matplotlib.use('Agg')
 import matplotlib.pyplot as plt
 from matplotlib.gridspec import GridSpec
 
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from utils import scan_store
+
 def extract_poi_from_filename(filename, poi_name):
     """Extract POI value from filename like fit_cHWtil_combine_-0.4000.root"""
     import re
@@ -49,6 +54,21 @@ def read_scan_data(input_dir, scanned_poi, floating_pois):
         print("Error: ROOT is not available. Please set up the ATLAS environment.")
         sys.exit(1)
     
+    # A scan with the result store has all points in one file
+    if scan_store.store_files(input_dir):
+        columns = [scanned_poi, 'nll', 'status'] + [fp + sfx for fp in floating_pois for sfx in ('', '__up', '__down')]
+        scan = scan_store.read_scan(input_dir, columns, keys=[scanned_poi])
+        print(f"Found {len(scan.get('nll', []))} scan points in the result store")
+        data = {'scanned_poi': scan[scanned_poi], 'nll': scan['nll']}
+        for fp in floating_pois:
+            data[fp] = scan[fp]
+            data[f'{fp}_up'] = scan[f'{fp}__up']
+            data[f'{fp}_down'] = scan[f'{fp}__down']
+        sort_idx = np.argsort(data['scanned_poi'])
+        data = {key: val[sort_idx] for key, val in data.items()}
+        data['deltaNLL'] = 2 * (data['nll'] - np.min(data['nll']))
+        return data
+    
     # Find all ROOT files
     pattern = os.path.join(input_dir, f'fit_{scanned_poi}_*.root')
     files = sorted(glob.glob(pattern))
@@ -3,16 +3,21 @@
 Plot correlation matrices from quickFit results.
 
 This script extracts correlation matrices from fit results and creates
-publication-quality plots.
+publication-quality plots. The input can also be a result store of the fit
+server (runner --scan-type fit --backend server writes <tag>_store.root),
+whose rows carry the POI correlations; --row selects the fit.
 
 Usage:
     python plot_correlation_matrix.py --input fit_result.root --pois cHWtil,cHBtil,cHWBtil
+    python plot_correlation_matrix.py --input linear_obs_fit_store.root --pois cHWtil,cHBtil,cHWBtil
 """
 
 import argparse
 import os
 import sys
 
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
 # Check for ROOT
 try:
     import ROOT
@@ -79,8 +84,8 @@ def resolve_pois(fit_result, requested_pois):
     return resolved
 
 
-def build_correlation_histogram(fit_result, pois, as_percent=False):
-    """Build TH2D correlation matrix histogram."""
+def build_correlation_histogram(correlation, pois, as_percent=False):
+    """Build TH2D correlation matrix histogram from correlation(poi_i, poi_j)."""
     n = len(pois)
     h = ROOT.TH2D("h_cor", "", n, 0, n, n, 0, n)
     
@@ -93,7 +98,7 @@ def build_correlation_histogram(fit_result, pois, as_percent=False):
     # Fill correlation values
     for i, pi in enumerate(pois):
         for j, pj in enumerate(pois):
-            corr = fit_result.correlation(pi, pj)
+            corr = correlation(pi, pj)
             if as_percent:
                 corr *= 100
             # Note: y-axis is reversed in histogram
@@ -110,7 +115,8 @@ def plot_correlation_matrix(
     as_percent: bool = False,
     internal: bool = True,
     margin: float = 0.2,
-    decimal_places: int = 2
+    decimal_places: int = 2,
+    row: int = -1
 ):
     """Create correlation matrix plot."""
     
@@ -121,13 +127,22 @@ def plot_correlation_matrix(
         return False
     
     fit_result = find_fit_result(tfile)
-    if not fit_result:
-        print(f"Error: No RooFitResult found in {input_file}")
-        tfile.Close()
-        return False
-    
-    # Resolve POI names
-    resolved_pois = resolve_pois(fit_result, pois)
+    if fit_result:
+        # Resolve POI names
+        resolved_pois = resolve_pois(fit_result, pois)
+        correlation = fit_result.correlation
+    else:
+        # result store: correlations of one row
+        from utils.scan_store import CORR_PREFIX, correlation as store_correlation, read_scan
+        data = read_scan(input_file)
+        names = {k for k in data if not k.startswith(CORR_PREFIX)}
+        resolved_pois = [p if p in names else p + '_combine' for p in pois if p in names or p + '_combine' in names]
+        matrix = store_correlation(data, resolved_pois, row) if data else None
+        if matrix is None:
+            print(f"Error: No RooFitResult or stored correlations found in {input_file}")
+            tfile.Close()
+            return False
+        correlation = lambda a, b: matrix[resolved_pois.index(a)][resolved_pois.index(b)]
     if not resolved_pois:
         print("Error: No matching POIs found")
         tfile.Close()
@@ -136,7 +151,7 @@ def plot_correlation_matrix(
     print(f"Using POIs: {resolved_pois}")
     
     # Build histogram
-    h_cor = build_correlation_histogram(fit_result, resolved_pois, as_percent)
+    h_cor = build_correlation_histogram(correlation, resolved_pois, as_percent)
     
     # Setup canvas and style
     ROOT.gStyle.SetOptStat(0)
@@ -203,6 +218,8 @@ def main():
                        help='Canvas margin')
     parser.add_argument('--dp', type=int, default=2,
                        help='Decimal places for text')
+    parser.add_argument('--row', type=int, default=-1,
+                       help='Row of a result store input (default: the last fit)')
     
     args = parser.parse_args()
     
@@ -221,7 +238,8 @@ def main():
         as_percent=args.percent,
         internal=args.internal,
         margin=args.margin,
-        decimal_places=args.dp
+        decimal_places=args.dp,
+        row=args.row
     )
 
 
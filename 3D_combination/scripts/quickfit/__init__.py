@@ -5,6 +5,7 @@ This module provides:
 - QuickFitRunner: Main runner class for scans and fits
 - Command building and execution (local and HTCondor)
 - Support for parallel and sequential execution modes
+- FitServerClient: client for the resident fit server
 
 Example:
     from quickfit import QuickFitRunner
@@ -25,5 +26,6 @@ Example:
 """
 
 from .runner import QuickFitRunner, QuickFitCommand
+from .fit_server import FitServerClient, FitServerResult
 
-__all__ = ['QuickFitRunner', 'QuickFitCommand']
+__all__ = ['QuickFitRunner', 'QuickFitCommand', 'FitServerClient', 'FitServerResult']
@@ -0,0 +1,412 @@
+#!/usr/bin/env python3
+"""
+Client for the resident fit server (fit_server/fitServer.C).
+
+The server is one ROOT process that reads the workspace and builds the NLL
+once, then answers fit requests on stdin/stdout. A scan driven through it
+pays the workspace load once instead of once per point. Warm requests start
+from the previous best fit in the same minimizer (see Fit Server Protocol in
+scripts/README.md). With a store file the server appends every result to one
+columnar file (utils/scan_store.py), and a per-point fit file is only written
+when an output file is given. If the workspace has a split file, the server reads
+that instead, and only the categories connected to the parameters listed in
+channels (see run_combination/3_ws_combine/splitWorkspace.h). With a fit
+cache (utils/fit_cache.py) every request carries the key of its inputs; the
+server answers requests found in the cache without fitting, and caches the
+converged fits it runs. values() returns all fitted parameters of a request,
+e.g. for the starting values of later points (utils/seed_model.py). With
+profile the server writes a timing report next to every output file and the
+store (<output>.profile.json, summed by utils/profile_report.py). With hesse
+and error_workers > 1, HESSE and the MINOS errors of minos_pois run in forked
+workers on copies of the fitted NLL, and the store gets the POI correlations.
+With poly_formulas the polynomial yield formulas of the model are evaluated
+by compiled EFTPolynomial nodes (run_combination/1_ws_editing/eftPolynomial.h).
+
+Example usage:
+    from quickfit.fit_server import FitServerClient
+    from utils.config import AnalysisConfig
+
+    config = AnalysisConfig.from_yaml('configs/hvv_cp_combination.yaml')
+    ws = config.workspaces['linear_obs']
+
+    with FitServerClient(ws, exclude_nps=config.get_exclude_nps_pattern()) as server:
+        result = server.fit("cHWtil_combine=0.5,cHBtil_combine=0_-3_3", "fit.root")
+        print(result.status, result.nll, result.pois)
+"""
+
+import os
+import subprocess
+import sys
+import tempfile
+import threading
+from dataclasses import dataclass, field
+from typing import Dict, List, Optional, Tuple, TextIO, Union
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from utils.config import WorkspaceConfig
+from utils.fit_cache import FitCache
+
+
+FIT_SERVER_MACRO = os.path.join(
+    os.path.dirname(os.path.dirname(os.path.abspath(__file__))),
+    'fit_server', 'fitServer.C'
+)
+
+PREFIX = 'FITSERVER_'
+
+
+class FitServerError(RuntimeError):
+    """Raised when the fit server cannot be started or dies."""
+
+
+@dataclass
+class FitServerResult:
+    """Answer of the fit server to one request."""
+    request_id: str
+    status: int = -1
+    nll: Optional[float] = None
+    time: float = 0.0
+    calls: int = 0
+    pois: Dict[str, float] = field(default_factory=dict)
+    error: str = ""
+    cached: bool = False
+
+    @property
+    def success(self) -> bool:
+        """True if the fit ran and MIGRAD converged."""
+        return not self.error and self.status == 0
+
+
+class FitServerClient:
+    """
+    Thin client driving one fitServer.C process.
+
+    Attributes:
+        ws: Workspace served by this process.
+        exclude_nps: quickFit -n pattern of NPs fixed for the whole session.
+        log_file: File collecting the ROOT/Minuit printout (optional).
+    """
+
+    def __init__(
+        self,
+        ws: WorkspaceConfig,
+        exclude_nps: str = "",
+        min_tolerance: float = 0.0001,
+        strategy: int = 1,
+        hesse: bool = False,
+        log_file: Optional[str] = None,
+        eval_backend: str = "legacy",
+        num_cpu: int = 1,
+        store_file: Optional[str] = None,
+        store_nps: str = "",
+        channels: str = "",
+        cache: Optional[FitCache] = None,
+        profile: bool = False,
+        error_workers: int = 1,
+        minos_pois: str = "",
+        poly_formulas: bool = False,
+        root_cmd: str = "root",
+        macro: str = FIT_SERVER_MACRO
+    ):
+        """Initialize client; the server is started by start() or `with`.
+
+        Args:
+            ws: Workspace configuration.
+            exclude_nps: Comma-separated NP patterns to fix (quickFit -n).
+            min_tolerance: Minimizer tolerance (quickFit --minTolerance).
+            strategy: Initial Minuit strategy.
+            hesse: Run HESSE after each fit.
+            log_file: Where to write the server printout.
+            eval_backend: RooFit NLL evaluation backend ("legacy", "cpu" or "codegen").
+            num_cpu: Processes the NLL categories are split over (> 1 needs
+                     eval_backend "legacy").
+            store_file: Scan store the server appends every result to (optional).
+            store_nps: Comma-separated patterns of the NPs kept in the store.
+            channels: Comma-separated parameters the fits float or move; with a
+                      split file only the categories they need are loaded
+                      (empty: all).
+            cache: Fit cache the server reads and fills (optional).
+            profile: Write phase timers and per-category NLL evaluation counts
+                     and times next to each output file.
+            error_workers: Worker processes HESSE and MINOS are spread over
+                           (> 1 needs num_cpu = 1).
+            minos_pois: Comma-separated POI patterns with MINOS errors.
+            poly_formulas: Replace the linear and quadratic RooFormulaVars of
+                           the loaded model by EFTPolynomial nodes.
+            root_cmd: ROOT executable.
+            macro: Path to fitServer.C.
+        """
+        if num_cpu > 1 and eval_backend != "legacy":
+            raise ValueError(f"num_cpu={num_cpu} needs eval_backend 'legacy', not {eval_backend!r}")
+        self.ws = ws
+        self.exclude_nps = exclude_nps
+        self.min_tolerance = min_tolerance
+        self.strategy = strategy
+        self.hesse = hesse
+        self.log_file = log_file
+        self.eval_backend = eval_backend
+        self.num_cpu = num_cpu
+        self.store_file = store_file
+        self.store_nps = store_nps
+        self.channels = channels
+        self.cache = cache
+        self.profile = profile
+        self.error_workers = error_workers
+        self.minos_pois = minos_pois
+        self.poly_formulas = poly_formulas
+        self.root_cmd = root_cmd
+        self.macro = macro
+        self._proc: Optional[subprocess.Popen] = None
+        self._options_file: Optional[str] = None
+        self._log: Optional[TextIO] = None
+        self._next_id = 0
+        self.n_floating = 0
+
+    def __enter__(self) -> 'FitServerClient':
+        self.start()
+        return self
+
+    def __exit__(self, *exc) -> None:
+        self.close()
+
+    def server_options(self) -> Dict[str, Union[str, int, float]]:
+        """Settings of the server, the keys of FitServerOptions in fitServerState.h."""
+        return {
+            'wsName': self.ws.workspace_name,
+            'mcName': self.ws.model_config,
+            'dataName': self.ws.data_name,
+            'fixNPs': self.exclude_nps,
+            'minTolerance': self.min_tolerance,
+            'strategy': self.strategy,
+            'hesse': int(self.hesse),
+            'evalBackend': self.eval_backend,
+            'numCPU': self.num_cpu,
+            'storeFile': self.store_file or '',
+            'storeNPs': self.store_nps,
+            'channels': self.channels,
+            'cacheDir': self.cache.cache_dir if self.cache else '',
+            'profile': int(self.profile),
+            'errorWorkers': self.error_workers,
+            'minosPOIs': self.minos_pois,
+            'polyFormulas': int(self.poly_formulas),
+        }
+
+    def _write_options(self) -> str:
+        """Write the key=value options file of the server and return its path."""
+        fd, path = tempfile.mkstemp(prefix='fitServer_', suffix='.opts')
+        with os.fdopen(fd, 'w') as f:
+            for key, value in self.server_options().items():
+                f.write(f"{key}={value}\n")
+        return path
+
+    def _macro_call(self) -> str:
+        """Build the ACLiC call of the server macro."""
+        return f'{self.macro}+("{self.ws.input_file()}","{self._options_file}")'
+
+    def _read_line(self) -> str:
+        """Read the next FITSERVER_ line, logging everything else."""
+        while True:
+            line = self._proc.stdout.readline()
+            if not line:
+                raise FitServerError(
+                    f"fit server exited (code {self._proc.poll()}), see {self.log_file or 'stdout'}"
+                )
+            if line.startswith(PREFIX):
+                return line.rstrip('\n')
+            if self._log:
+                self._log.write(line)
+
+    def start(self) -> None:
+        """Start the server and wait until the workspace is loaded."""
+        if self._proc is not None:
+            return
+        if self.log_file:
+            self._log = open(self.log_file, 'w')
+        self._options_file = self._write_options()
+        self._proc = subprocess.Popen(
+            [self.root_cmd, '-l', '-b', '-q', self._macro_call()],
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.STDOUT,
+            text=True,
+            bufsize=1
+        )
+        if self.cache:
+            # hashed while the server loads the workspace
+            self.cache.workspace_hash(self.ws.input_file())
+        line = self._read_line()
+        if not line.startswith(PREFIX + 'READY'):
+            self.close()
+            raise FitServerError(f"fit server failed to start: {line}")
+        fields = line.split()
+        self.n_floating = int(fields[1])
+        # the backend the NLL was built with: codegen falls back to cpu if the model
+        # cannot be compiled, and the cache keys must name the one actually used
+        for item in fields[2:]:
+            if item.startswith('backend=') and item[len('backend='):] != self.eval_backend:
+                print(f"Warning: fit server uses eval_backend {item[len('backend='):]!r} "
+                      f"instead of {self.eval_backend!r}")
+                self.eval_backend = item[len('backend='):]
+
+    def close(self) -> None:
+        """Stop the server."""
+        if self._proc is not None:
+            try:
+                if self._proc.poll() is None:
+                    self._proc.stdin.write("QUIT\n")
+                    self._proc.stdin.flush()
+                # drain the remaining printout into the log
+                for line in self._proc.stdout:
+                    if self._log:
+                        self._log.write(line)
+                self._proc.wait()
+            except (BrokenPipeError, OSError):
+                self._proc.kill()
+            self._proc = None
+        if self._options_file:
+            os.unlink(self._options_file)
+            self._options_file = None
+        if self._log:
+            self._log.close()
+            self._log = None
+
+    def _send(
+        self,
+        poi_string: str,
+        output_file: Optional[str],
+        seeds: Optional[Union[Dict[str, float], str]],
+        warm: bool = False
+    ) -> str:
+        """Write one FIT (or WARM) request and return its id."""
+        request_id = str(self._next_id)
+        self._next_id += 1
+        if isinstance(seeds, str):
+            seed_str = seeds
+        else:
+            seed_str = ",".join(f"{k}={v:.8g}" for k, v in (seeds or {}).items())
+        command = "WARM" if warm else "FIT"
+        if self.cache:
+            self._proc.stdin.write(f"CACHE {self.cache_key(poi_string)}\n")
+        self._proc.stdin.write(f"{command} {request_id} {output_file or '-'} {poi_string or '-'} {seed_str}\n")
+        self._proc.stdin.flush()
+        return request_id
+
+    def cache_key(self, poi_string: str) -> str:
+        """Fit cache key of a request of this server."""
+        options = {
+            'engine': 'fitServer',
+            'eval_backend': self.eval_backend,
+            'min_tolerance': self.min_tolerance,
+            'strategy': self.strategy,
+            'hesse': self.hesse,
+            'channels': self.channels
+        }
+        if self.minos_pois:
+            options['minos_pois'] = self.minos_pois
+        if self.poly_formulas:
+            options['poly_formulas'] = True
+        if self.error_workers > 1 and (self.hesse or self.minos_pois):
+            # finite-difference HESSE, not MnHesse
+            options['parallel_errors'] = True
+        return self.cache.key(self.ws, poi_string, self.exclude_nps, options, self.ws.input_file())
+
+    @staticmethod
+    def _parse(line: str) -> FitServerResult:
+        """Parse a FITSERVER_RESULT or FITSERVER_ERROR line."""
+        fields = line.split()
+        if fields[0] == PREFIX + 'ERROR':
+            return FitServerResult(request_id=fields[1], error=" ".join(fields[2:]))
+        result = FitServerResult(request_id=fields[1])
+        for kv in fields[2:]:
+            key, val = kv.split('=', 1)
+            if key == 'status':
+                result.status = int(val)
+            elif key == 'nll':
+                result.nll = float(val)
+            elif key == 'time':
+                result.time = float(val)
+            elif key == 'calls':
+                result.calls = int(val)
+            elif key == 'cached':
+                result.cached = val == '1'
+            else:
+                result.pois[key] = float(val)
+        return result
+
+    def fit(
+        self,
+        poi_string: str,
+        output_file: Optional[str] = None,
+        seeds: Optional[Union[Dict[str, float], str]] = None,
+        warm: bool = False
+    ) -> FitServerResult:
+        """Run one fit.
+
+        Args:
+            poi_string: quickFit -p style POI string.
+            output_file: ROOT file for the fit result (optional).
+            seeds: Starting values of floating parameters, "@file.root" to
+                   take all of them from the fitResult of an earlier fit, or
+                   "#<request_id>" from an earlier result of this server.
+            warm: Start from the previous best fit instead of the loaded state.
+
+        Returns:
+            FitServerResult with status, NLL and POI values.
+        """
+        return self.fit_batch([(poi_string, output_file, seeds)], warm=warm)[0]
+
+    def fit_batch(
+        self,
+        requests: List[Tuple[str, Optional[str], Optional[Dict[str, float]]]],
+        warm: bool = False
+    ) -> List[FitServerResult]:
+        """Send all requests at once and collect the answers in order.
+
+        With warm=True the requests form a warm-started sequential scan: each
+        fit starts from the best fit of the one before it.
+
+        Args:
+            requests: List of (poi_string, output_file, seeds) tuples.
+            warm: Send WARM instead of FIT requests.
+
+        Returns:
+            One FitServerResult per request.
+        """
+        if self._proc is None:
+            self.start()
+        for poi_string, _, _ in requests:
+            if any(c.isspace() for c in poi_string):
+                raise ValueError(f"POI string must not contain whitespace: {poi_string!r}")
+        ids = [str(self._next_id + i) for i in range(len(requests))]
+        # write from a separate thread: the server answers while we are still sending,
+        # and neither side may block on a full pipe
+        writer = threading.Thread(target=lambda: [self._send(*req, warm=warm) for req in requests])
+        writer.start()
+        results = {}
+        try:
+            while len(results) < len(ids):
+                res = self._parse(self._read_line())
+                if res.request_id not in ids:
+                    raise FitServerError(f"unexpected answer: {res.error or res.request_id}")
+                results[res.request_id] = res
+        finally:
+            writer.join()
+        return [results[i] for i in ids]
+
+    def values(self, request_id: str) -> Dict[str, float]:
+        """Final values of all floating parameters, NPs included, of an earlier request.
+
+        Args:
+            request_id: FitServerResult.request_id of a request of this server.
+
+        Returns:
+            Dict of parameter names to fitted values.
+        """
+        self._proc.stdin.write(f"VALUES {request_id}\n")
+        self._proc.stdin.flush()
+        fields = self._read_line().split()
+        if fields[0] != PREFIX + 'VALUES' or fields[1] != request_id:
+            raise FitServerError(f"no values for request {request_id}: {' '.join(fields[2:])}")
+        return {k: float(v) for k, v in (kv.split('=', 1) for kv in fields[2:])}
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""
+Packed Condor scan jobs: several scan points per job on one fit server.
+
+A parallel Condor scan normally runs one quickFit job, and so one workspace
+load, per grid point. With points-per-job packing the runner writes the
+points of each job to a batch file, and the job fits them as independent
+(cold) fits on one fit server, so the workspace is loaded once per job. The
+outputs are the usual fit_*.root files, or with the result store one store
+part per job in the scan directory (see utils/scan_store.py).
+
+Every job also writes the measured time of each fit next to its batch file.
+The runner uses these measurements, from earlier scans of the same
+workspace in the same output directory, to size the jobs of the next scan.
+
+    <logs>/batches/batch_<k>.json          points of job k (written by the runner)
+    <logs>/batches/batch_<k>.result.json   status and fit time per point (by the job)
+
+Example usage:
+    python3 quickfit/point_batch.py --batch logs_<tag>/batches/batch_0.json
+"""
+
+import argparse
+import glob
+import json
+import math
+import os
+import sys
+import time
+from typing import Dict, List, Optional, Tuple
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from utils.config import AnalysisConfig
+from utils import scan_store
+from utils.fit_cache import FitCache
+from quickfit.fit_server import FitServerClient
+
+# Per-point fit time and workspace load time assumed when nothing has been measured yet
+DEFAULT_POINT_SECONDS = 300.0
+DEFAULT_LOAD_SECONDS = 300.0
+
+# Quantile of the measured fit times used for sizing (slow points fill a job)
+SIZING_QUANTILE = 0.9
+
+
+def write_batches(
+    batch_dir: str,
+    job: Dict,
+    points: List[Tuple[str, str]],
+    points_per_job: int
+) -> List[str]:
+    """Split scan points into batch files.
+
+    Args:
+        batch_dir: Directory for the batch files.
+        job: Common fields (config, workspace, systematics, logs_dir, store_dir, store_nps).
+        points: List of (poi_string, output_file), output_file None with the store.
+        points_per_job: Number of points per batch.
+
+    Returns:
+        Paths of the batch files, in job order.
+    """
+    os.makedirs(batch_dir, exist_ok=True)
+    paths = []
+    for k, start in enumerate(range(0, len(points), points_per_job)):
+        path = os.path.join(batch_dir, f"batch_{k}.json")
+        chunk = points[start:start + points_per_job]
+        with open(path, 'w') as f:
+            json.dump(dict(job, points=[{'pois': p, 'output': o} for p, o in chunk]), f, indent=1)
+        paths.append(path)
+    return paths
+
+
+def measured_point_time(search_dir: str, workspace: str, systematics: str) -> Optional[Tuple[float, float, int]]:
+    """Fit time per point measured by earlier packed jobs.
+
+    Args:
+        search_dir: Output directory holding the logs_<tag> directories.
+        workspace: Workspace label.
+        systematics: Systematics mode.
+
+    Returns:
+        (SIZING_QUANTILE quantile of the fit times in s, largest workspace load
+        time in s, number of fits), or None if no job of this workspace has
+        finished yet.
+    """
+    times, loads = [], []
+    for path in glob.glob(os.path.join(search_dir, 'logs_*', 'batches', 'batch_*.result.json')):
+        try:
+            with open(path) as f:
+                res = json.load(f)
+        except (OSError, ValueError):
+            continue
+        if res.get('workspace') != workspace or res.get('systematics') != systematics:
+            continue
+        loads.append(res.get('load_time', 0.0))
+        times += [p['time'] for p in res.get('points', []) if p.get('status') == 0]
+    if not times:
+        return None
+    times.sort()
+    return times[min(len(times) - 1, int(SIZING_QUANTILE * len(times)))], max(loads), len(times)
+
+
+def points_per_job_for(point_seconds: float, load_seconds: float, job_minutes: float) -> int:
+    """Number of points that fit into a job of job_minutes after the workspace load."""
+    budget = job_minutes * 60.0 - load_seconds
+    return max(1, int(math.floor(budget / max(point_seconds, 1e-3))))
+
+
+def run_batch(batch_path: str) -> bool:
+    """Fit the points of one batch file on a fit server.
+
+    Returns:
+        True if all points converged.
+    """
+    with open(batch_path) as f:
+        batch = json.load(f)
+    config = AnalysisConfig.from_yaml(batch['config'])
+    ws = config.workspaces[batch['workspace']].for_systematics(batch['systematics'])
+    name = os.path.splitext(os.path.basename(batch_path))[0]
+    store_dir = batch.get('store_dir')
+    server = FitServerClient(
+        ws,
+        exclude_nps=config.get_exclude_nps_pattern(systematics=batch['systematics']),
+        min_tolerance=config.quickfit_defaults.get('min_tolerance', 0.0001),
+        eval_backend=config.quickfit_defaults.get('eval_backend', 'legacy'),
+        num_cpu=config.quickfit_defaults.get('num_cpu', 1),
+        store_file=scan_store.new_part(store_dir, name) if store_dir else None,
+        store_nps=batch.get('store_nps', ''),
+        channels=batch.get('channels', ''),
+        cache=FitCache.from_config(config),
+        profile=bool(config.quickfit_defaults.get('profile', 0)),
+        poly_formulas=bool(config.quickfit_defaults.get('poly_formulas', 0)),
+        log_file=os.path.join(batch['logs_dir'], f"{name}_fit_server.log")
+    )
+
+    start = time.time()
+    with server:
+        load_time = time.time() - start
+        print(f"Workspace loaded in {load_time:.1f} s, fitting {len(batch['points'])} points", flush=True)
+        results = server.fit_batch([(p['pois'], p['output'], None) for p in batch['points']])
+
+    record = {
+        'workspace': batch['workspace'],
+        'systematics': batch['systematics'],
+        'load_time': load_time,
+        'points': [
+            {'output': p['output'], 'status': res.status if not res.error else -1,
+             'time': res.time, 'calls': res.calls}
+            for p, res in zip(batch['points'], results)
+        ]
+    }
+    result_path = os.path.splitext(batch_path)[0] + '.result.json'
+    with open(result_path + '.tmp', 'w') as f:
+        json.dump(record, f, indent=1)
+    os.replace(result_path + '.tmp', result_path)
+
+    failed = [p['output'] or p['pois'] for p, res in zip(batch['points'], results) if not res.success]
+    print(f"{len(results) - len(failed)}/{len(results)} points converged, "
+          f"{sum(res.time for res in results):.1f} s fitting", flush=True)
+    for output in failed:
+        print(f"  Failed: {output}", file=sys.stderr)
+    return not failed
+
+
+def main():
+    """CLI interface for packed scan jobs."""
+    parser = argparse.ArgumentParser(description="Fit the scan points of one batch file.")
+    parser.add_argument('--batch', required=True, help='Batch file written by the runner')
+    args = parser.parse_args()
+    sys.exit(0 if run_batch(args.batch) else 1)
+
+
+if __name__ == '__main__':
+    main()
@@ -6,8 +6,18 @@ This module provides a unified interface for running quickFit commands
 for various scan types (1D, 2D) and fits. It handles:
 - Command building with proper POI strings
 - Local execution
-- HTCondor job submission (parallel and sequential)
-- Result extraction for sequential seeding
+- Local scans through the resident fit server (workspace loaded once)
+- Warm-started sequential scans in one minimizer ("warm" mode)
+- Adaptive grids refined around the minimum and the contours ("adaptive" mode)
+- Tiled 2D scans on N work-stealing workers ("tiles" mode)
+- HTCondor job submission (parallel and sequential), optionally packing
+  several points into each job on one fit server
+- Sequential seeding: each point starts from the values predicted by a
+  local quadratic model of the points fitted before (utils/seed_model.py)
+- A columnar result store per scan for the fit-server modes (one scan.root
+  instead of a fit_*.root file per point, see utils/scan_store.py)
+- A content-addressed fit cache: fits with identical inputs are not rerun
+  (utils/fit_cache.py)
 
 Example usage:
     from quickfit.runner import QuickFitRunner
@@ -46,6 +56,13 @@ sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
 from utils.config import AnalysisConfig, WorkspaceConfig, ScanConfig
 from utils.poi_builder import POIBuilder
 from utils.fit_result_parser import FitResultParser
+from utils.adaptive_scan import AdaptiveScan1D, AdaptiveScan2D
+from quickfit.fit_server import FitServerClient
+from quickfit.tile_scheduler import TileIndex, make_tiles
+from quickfit import point_batch
+from utils import scan_store
+from utils.fit_cache import FitCache
+from utils.seed_model import SeedModel
 
 
 @dataclass
@@ -123,6 +140,7 @@ class QuickFitRunner:
         self.verbose = verbose
         self.poi_builder = POIBuilder(config)
         self._result_parser = None  # Lazy initialization - only created when needed
+        self.fit_cache = FitCache.from_config(config)
     
     @property
     def result_parser(self):
@@ -136,11 +154,11 @@ class QuickFitRunner:
         if self.verbose:
             print(msg)
     
-    def _get_workspace(self, label: str) -> WorkspaceConfig:
-        """Get workspace configuration by label."""
+    def _get_workspace(self, label: str, systematics: str = "full_syst") -> WorkspaceConfig:
+        """Get workspace configuration by label (its reduced file for systematics, if any)."""
         if label not in self.config.workspaces:
             raise ValueError(f"Unknown workspace: {label}. Available: {list(self.config.workspaces.keys())}")
-        return self.config.workspaces[label]
+        return self.config.workspaces[label].for_systematics(systematics)
     
     def _linspace(self, n: int, min_val: float, max_val: float) -> List[float]:
         """Generate linearly spaced values."""
@@ -207,6 +225,52 @@ class QuickFitRunner:
             self._log(f"Error running quickFit: {e}")
             return False
     
+    def _quickfit_key(self, cmd: QuickFitCommand) -> Optional[str]:
+        """Fit cache key of a quickFit command, None without a cache."""
+        if self.fit_cache is None:
+            return None
+        ws = WorkspaceConfig(path=cmd.input_file, workspace_name=cmd.workspace, data_name=cmd.data)
+        options = {
+            'engine': 'quickFit',
+            'min_tolerance': cmd.min_tolerance,
+            'minos': cmd.minos,
+            'hesse': cmd.hesse,
+            'extra_args': cmd.extra_args or []
+        }
+        return self.fit_cache.key(ws, cmd.poi_string, cmd.exclude_nps, options)
+    
+    def _run_cached(self, cmd: QuickFitCommand, log_file: Optional[str] = None) -> bool:
+        """Run a quickFit command locally unless the fit cache has its result.
+        
+        Returns:
+            True if the output file was produced.
+        """
+        key = self._quickfit_key(cmd)
+        if key and self.fit_cache.fetch(key, cmd.output_file):
+            self._log(f"    Cached: {os.path.basename(cmd.output_file)}")
+            return True
+        success = self._run_local(cmd, log_file)
+        if key and success:
+            try:
+                self.fit_cache.put(key, cmd.output_file)
+            except Exception as e:
+                self._log(f"    Warning: Could not cache {cmd.output_file}: {e}")
+        return success
+    
+    def _cached_command(self, cmd: QuickFitCommand) -> Optional[str]:
+        """Condor job line of a quickFit command that fills the fit cache.
+        
+        Returns:
+            The command line, or None if the result was taken from the cache.
+        """
+        key = self._quickfit_key(cmd)
+        if key is None:
+            return cmd.to_string()
+        if self.fit_cache.fetch(key, cmd.output_file):
+            return None
+        script = os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), 'utils', 'fit_cache.py')
+        return f"{cmd.to_string()} && python3 {script} --dir {self.fit_cache.cache_dir} --put {key} {cmd.output_file}"
+    
     def _write_condor_wrapper(
         self,
         wrapper_path: str,
@@ -254,7 +318,8 @@ class QuickFitRunner:
         log_dir: str,
         job_name: str,
         queue: str = "medium",
-        memory: int = 64000
+        memory: int = 64000,
+        cpus: int = 1
     ):
         """Write a Condor submit file."""
         with open(submit_path, 'w') as f:
@@ -262,7 +327,7 @@ class QuickFitRunner:
             f.write("getenv = True\n")
             f.write(f'+UseOS = "el9"\n')
             f.write(f'+JobCategory = "{queue}"\n')
-            f.write("request_cpus = 1\n")
+            f.write(f"request_cpus = {cpus}\n")
             f.write(f"request_memory = {memory}\n\n")
             f.write(f"executable = {wrapper_path}\n")
             f.write(f"JobBatchName = {job_name}\n")
@@ -271,6 +336,226 @@ class QuickFitRunner:
             f.write(f"error = {log_dir}/{job_name}.err\n")
             f.write("queue\n")
     
+    def _store_part(self, root_dir: str, label: str) -> Optional[str]:
+        """New scan-store part for one fit server in root_dir, None if the store is off."""
+        if not self.config.quickfit_defaults.get('result_store', 0):
+            return None
+        return scan_store.new_part(os.path.abspath(root_dir), label)
+    
+    def _fit_output(self, path: str) -> Optional[str]:
+        """Per-point fit file of a fit-server scan, None when the store replaces it."""
+        defaults = self.config.quickfit_defaults
+        if defaults.get('result_store', 0) and not defaults.get('keep_fit_results', 1):
+            return None
+        return path
+    
+    def _merge_store(self, root_dir: str):
+        """Merge the store parts of a finished fit-server scan into scan.root."""
+        if self.config.quickfit_defaults.get('result_store', 0):
+            self._log(f"  Results stored in {scan_store.merge(root_dir)}")
+    
+    def _fit_channels(self, ws: WorkspaceConfig, poi_strings: List[str]) -> str:
+        """Parameters the fits of a scan float or move, for a split workspace.
+        
+        These are the POIs floated in any of the quickFit -p strings and those
+        fixed to different values in them; the fit server then only loads the
+        categories connected to them (run_combination/3_ws_combine/splitWorkspace.h).
+        
+        Args:
+            ws: Workspace configuration.
+            poi_strings: POI strings of the scan (the first and last point suffice).
+        
+        Returns:
+            Comma-separated names, empty (all categories) without a split file.
+        """
+        if ws.input_file() == ws.path:
+            return ""
+        floating, values = [], {}
+        for poi_string in poi_strings:
+            for item in poi_string.split(','):
+                name, _, value = item.strip().partition('=')
+                if not name:
+                    continue
+                if not value or len(value.split('_')) == 3:
+                    floating.append(name)
+                else:
+                    values.setdefault(name, set()).add(value)
+        moved = [name for name, vals in values.items() if len(vals) > 1]
+        return ','.join(dict.fromkeys(floating + moved))
+    
+    def _start_fit_server(
+        self,
+        ws: WorkspaceConfig,
+        logs_dir: str,
+        extra_args: Optional[List[str]],
+        systematics: str = "full_syst",
+        store_file: Optional[str] = None,
+        channels: str = "",
+        hesse: bool = False,
+        minos_pois: str = ""
+    ) -> FitServerClient:
+        """Start a resident fit server for one workspace.
+        
+        Args:
+            ws: Workspace configuration.
+            logs_dir: Directory for the server log.
+            extra_args: quickFit extra arguments (not supported by the server).
+            systematics: Systematics mode ("full_syst" or "stat_only").
+            store_file: Scan store the server appends its results to (optional).
+            channels: Parameters the fits float or move (see _fit_channels).
+            hesse: Run HESSE after each fit.
+            minos_pois: Comma-separated POIs with MINOS errors.
+        
+        Returns:
+            Started FitServerClient.
+        """
+        if extra_args:
+            self._log(f"  Warning: extra quickFit arguments are ignored by the fit server: {extra_args}")
+        server = FitServerClient(
+            ws,
+            exclude_nps=self.config.get_exclude_nps_pattern(systematics=systematics),
+            min_tolerance=self.config.quickfit_defaults.get('min_tolerance', 0.0001),
+            eval_backend=self.config.quickfit_defaults.get('eval_backend', 'legacy'),
+            num_cpu=self.config.quickfit_defaults.get('num_cpu', 1),
+            store_file=store_file,
+            store_nps=self.config.quickfit_defaults.get('store_nps', ''),
+            channels=channels,
+            cache=self.fit_cache,
+            profile=bool(self.config.quickfit_defaults.get('profile', 0)),
+            poly_formulas=bool(self.config.quickfit_defaults.get('poly_formulas', 0)),
+            hesse=hesse,
+            error_workers=int(self.config.quickfit_defaults.get('error_workers', 1)),
+            minos_pois=minos_pois,
+            log_file=os.path.join(logs_dir, "fit_server.log")
+        )
+        self._log(f"Starting fit server on {ws.input_file()}")
+        start = time.time()
+        server.start()
+        self._log(f"  Workspace loaded in {time.time() - start:.1f} s ({server.n_floating} floating parameters)")
+        return server
+    
+    def _warm_scan_job_command(
+        self,
+        ws: WorkspaceConfig,
+        scan_args: List[str],
+        root_dir: str,
+        tag: str,
+        systematics: str
+    ) -> str:
+        """Command running a warm scan on the fit server inside a Condor job.
+        
+        The job calls this runner with backend "server", using the same tag and
+        output directory, so that it writes to root_dir.
+        """
+        if not self.config.config_path:
+            raise ValueError("warm Condor scans need a configuration loaded from YAML")
+        scripts_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        args = [
+            'python3', f'{scripts_dir}/quickfit/runner.py',
+            '--config', self.config.config_path,
+            '--workspace', ws.label,
+            '--mode', 'warm', '--backend', 'server',
+            '--output-dir', os.path.dirname(os.path.abspath(root_dir)),
+            '--tag', tag,
+            '--systematics', systematics
+        ] + scan_args
+        return ' '.join(args)
+    
+    def _submit_packed_condor(
+        self,
+        ws: WorkspaceConfig,
+        points: List[Tuple[str, str]],
+        root_dir: str,
+        logs_dir: str,
+        tag: str,
+        queue: str,
+        extra_args: Optional[List[str]],
+        systematics: str,
+        points_per_job: int,
+        job_minutes: float
+    ) -> int:
+        """Submit a parallel scan with several points per Condor job.
+        
+        Each job loads the workspace once on a fit server and fits its points
+        as independent fits (see quickfit/point_batch.py). With points_per_job
+        0 the jobs are sized to job_minutes from the fit times measured by
+        earlier packed jobs of this workspace in the same output directory.
+        
+        Args:
+            ws: Workspace configuration.
+            points: List of (poi_string, output_file).
+            root_dir: Scan directory (the store parts of the jobs go there).
+            logs_dir: Directory for batch files and Condor logs.
+            tag: Scan tag.
+            queue: Condor queue.
+            extra_args: quickFit extra arguments (not supported by the server).
+            systematics: Systematics mode ("full_syst" or "stat_only").
+            points_per_job: Points per job, 0 to size from measured fit times.
+            job_minutes: Target job wall time when sizing automatically.
+        
+        Returns:
+            Number of submitted jobs.
+        """
+        if not self.config.config_path:
+            raise ValueError("packed Condor scans need a configuration loaded from YAML")
+        if extra_args:
+            self._log(f"  Warning: extra quickFit arguments are ignored by the fit server: {extra_args}")
+        
+        if points_per_job <= 0:
+            measured = point_batch.measured_point_time(
+                os.path.dirname(os.path.abspath(logs_dir)), ws.label, systematics
+            )
+            if measured:
+                point_seconds, load_seconds, n_fits = measured
+                self._log(f"  Measured fit time: {point_seconds:.0f} s per point "
+                          f"({int(point_batch.SIZING_QUANTILE * 100)}% quantile of {n_fits} fits), "
+                          f"workspace load {load_seconds:.0f} s")
+            else:
+                point_seconds = point_batch.DEFAULT_POINT_SECONDS
+                load_seconds = point_batch.DEFAULT_LOAD_SECONDS
+                self._log(f"  No fit times measured yet for {ws.label}, assuming {point_seconds:.0f} s "
+                          f"per point and {load_seconds:.0f} s workspace load")
+            points_per_job = point_batch.points_per_job_for(point_seconds, load_seconds, job_minutes)
+        
+        batch_dir = os.path.abspath(os.path.join(logs_dir, "batches"))
+        batches = point_batch.write_batches(batch_dir, {
+            'config': self.config.config_path,
+            'workspace': ws.label,
+            'systematics': systematics,
+            'logs_dir': os.path.abspath(logs_dir),
+            'store_dir': os.path.abspath(root_dir) if self.config.quickfit_defaults.get('result_store', 0) else None,
+            'store_nps': self.config.quickfit_defaults.get('store_nps', ''),
+            'channels': self._fit_channels(ws, [p for p, _ in points])
+        }, [(p, self._fit_output(o)) for p, o in points], points_per_job)
+        self._log(f"  {len(points)} points in {len(batches)} jobs of up to {points_per_job} points")
+        
+        workdir = os.getcwd()
+        script = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'point_batch.py')
+        wrapper_path = os.path.join(logs_dir, f"{tag}_batch.sh")
+        submit_path = os.path.join(logs_dir, f"{tag}_batch.sub")
+        self._write_condor_wrapper(
+            wrapper_path, [f"python3 {script} --batch {batch_dir}/batch_$1.json"], workdir
+        )
+        with open(submit_path, 'w') as sf:
+            sf.write("universe = vanilla\n")
+            sf.write("getenv = True\n")
+            sf.write('+UseOS = "el9"\n')
+            sf.write(f'+JobCategory = "{queue}"\n')
+            sf.write(f"request_cpus = {self.config.quickfit_defaults.get('num_cpu', 1)}\n")
+            sf.write("request_memory = 64000\n\n")
+            sf.write(f"executable = {wrapper_path}\n")
+            sf.write("arguments = $(Process)\n")
+            sf.write(f"JobBatchName = {tag}_batch\n")
+            sf.write(f"log = {logs_dir}/{tag}_batch.log\n")
+            sf.write(f"output = {logs_dir}/{tag}_batch_$(Process).out\n")
+            sf.write(f"error = {logs_dir}/{tag}_batch_$(Process).err\n")
+            sf.write(f"queue {len(batches)}\n")
+        
+        subprocess.run(['condor_submit', submit_path], check=True)
+        if self.config.quickfit_defaults.get('result_store', 0):
+            self._log(f"  Merge the job stores when done: python3 -m utils.scan_store --merge {root_dir}")
+        return len(batches)
+    
     def run_1d_scan(
         self,
         workspace: str,
@@ -284,7 +569,10 @@ class QuickFitRunner:
         tag: Optional[str] = None,
         queue: str = "medium",
         extra_args: Optional[List[str]] = None,
-        systematics: str = "full_syst"
+        systematics: str = "full_syst",
+        adaptive_depth: int = 2,
+        points_per_job: int = 1,
+        job_minutes: float = 60.0
     ) -> str:
         """Run a 1D likelihood scan.
         
@@ -294,18 +582,28 @@ class QuickFitRunner:
             min_val: Minimum scan value.
             max_val: Maximum scan value.
             n_points: Number of scan points.
-            mode: "parallel" or "sequential".
-            backend: "local" or "condor".
+            mode: "parallel", "sequential", "warm" (sequential in one
+                  minimizer on the fit server, each point starting from the
+                  previous best fit) or "adaptive" (n_points is a coarse grid
+                  that is refined around the minimum and the contour levels,
+                  on the fit server).
+            backend: "local", "server" (local, one resident fit process) or "condor".
             output_dir: Base output directory.
             tag: Optional tag for output naming.
             queue: Condor queue (if backend=condor).
             extra_args: Extra quickFit arguments.
             systematics: Systematics mode ("full_syst" or "stat_only").
+            adaptive_depth: Number of times a coarse interval may be halved
+                            (adaptive mode).
+            points_per_job: Points per Condor job in parallel mode; more than 1
+                            fits them on one fit server per job, 0 sizes the
+                            jobs from measured fit times.
+            job_minutes: Target Condor job wall time for points_per_job=0.
         
         Returns:
             Path to output directory with ROOT files.
         """
-        ws = self._get_workspace(workspace)
+        ws = self._get_workspace(workspace, systematics)
         values = self._linspace(n_points, min_val, max_val)
         
         # Setup output directories
@@ -319,10 +617,20 @@ class QuickFitRunner:
         self._log(f"Starting {mode} 1D scan: {poi} [{min_val}, {max_val}] with {n_points} points")
         self._log(f"Output: {root_dir}")
         
-        if backend == "local":
+        if mode == "tiles":
+            raise ValueError("tiles mode is for 2D scans, use warm mode for 1D")
+        if mode == "adaptive":
+            if backend == "condor":
+                raise ValueError("adaptive scans run on the local fit server, use backend local or server")
+            self._run_1d_scan_adaptive(ws, poi, (min_val, max_val), n_points, root_dir, logs_dir,
+                                       extra_args, systematics, adaptive_depth)
+        elif backend == "server" or (backend == "local" and mode == "warm"):
+            self._run_1d_scan_server(ws, poi, values, root_dir, logs_dir, mode, extra_args, systematics)
+        elif backend == "local":
             self._run_1d_scan_local(ws, poi, values, root_dir, logs_dir, mode, extra_args, systematics)
         elif backend == "condor":
-            self._run_1d_scan_condor(ws, poi, values, root_dir, logs_dir, mode, tag, queue, extra_args, systematics)
+            self._run_1d_scan_condor(ws, poi, values, root_dir, logs_dir, mode, tag, queue, extra_args, systematics,
+                                     points_per_job, job_minutes)
         else:
             raise ValueError(f"Unknown backend: {backend}")
         
@@ -339,13 +647,18 @@ class QuickFitRunner:
         extra_args: Optional[List[str]],
         systematics: str = "full_syst"
     ):
-        """Run 1D scan locally."""
-        prev_results = {}
+        """Run 1D scan locally.
+
+        Sequential mode seeds the floating POIs of each point with their
+        values predicted from the points fitted before (utils/seed_model.py).
+        """
+        model = SeedModel()
         
         for i, val in enumerate(values):
             self._log(f"  Point {i+1}/{len(values)}: {poi}={val:.4f}")
             
             # Build POI string
+            prev_results = model.predict((val,))[0] if mode == "sequential" else {}
             poi_string = self.poi_builder.build_1d_scan(poi, val, prev_results)
             
             # Build command
@@ -354,18 +667,107 @@ class QuickFitRunner:
             log_file = os.path.join(logs_dir, f"fit_{poi}_{val:.4f}.log")
             
             # Run
-            success = self._run_local(cmd, log_file)
+            success = self._run_cached(cmd, log_file)
             
-            # Extract results for next iteration (sequential mode)
+            # Extract results for the next points (sequential mode)
             if mode == "sequential" and success and os.path.exists(output_file):
                 try:
-                    prev_results = self.result_parser.extract_pois(output_file)
-                    self._log(f"    Extracted {len(prev_results)} POI values for seeding")
+                    fitted = self.result_parser.extract_pois(output_file)
+                    model.add((val,), fitted)
+                    self._log(f"    Extracted {len(fitted)} POI values for seeding")
                 except Exception as e:
                     self._log(f"    Warning: Could not extract results: {e}")
-                    prev_results = {}
-            elif mode == "parallel":
-                prev_results = {}  # Don't seed in parallel mode
+    
+    def _run_1d_scan_server(
+        self,
+        ws: WorkspaceConfig,
+        poi: str,
+        values: List[float],
+        root_dir: str,
+        logs_dir: str,
+        mode: str,
+        extra_args: Optional[List[str]],
+        systematics: str = "full_syst"
+    ):
+        """Run 1D scan locally through one resident fit server.
+        
+        Parallel mode sends all points as one batch (each point starts from
+        the loaded workspace, as separate quickFit jobs would); sequential mode
+        seeds all floating parameters (NPs included) of each point with the
+        values a local quadratic model of the converged points predicts
+        (utils/seed_model.py); the POI strings stay unseeded, so that the fit
+        cache keys do not depend on the order of the fits; warm mode
+        sends one batch of warm requests, so every fit continues from the
+        previous best fit (NPs included) in the same minimizer.
+        """
+        store = self._store_part(root_dir, "server")
+        channels = self._fit_channels(ws, [self.poi_builder.build_1d_scan(poi, val) for val in (values[0], values[-1])])
+        with self._start_fit_server(ws, logs_dir, extra_args, systematics, store, channels) as server:
+            if mode in ("parallel", "warm"):
+                requests = [
+                    (self.poi_builder.build_1d_scan(poi, val),
+                     self._fit_output(os.path.join(root_dir, f"fit_{poi}_{val:.4f}.root")), None)
+                    for val in values
+                ]
+                results = server.fit_batch(requests, warm=(mode == "warm"))
+            else:
+                results = []
+                model = SeedModel()
+                for i, val in enumerate(values):
+                    self._log(f"  Point {i+1}/{len(values)}: {poi}={val:.4f}")
+                    poi_string = self.poi_builder.build_1d_scan(poi, val)
+                    output_file = self._fit_output(os.path.join(root_dir, f"fit_{poi}_{val:.4f}.root"))
+                    seeds, _ = model.predict((val,))
+                    result = server.fit(poi_string, output_file, seeds or None)
+                    results.append(result)
+                    if result.success:
+                        model.add((val,), {**result.pois, **server.values(result.request_id)})
+        self._merge_store(root_dir)
+        
+        failed = [val for val, res in zip(values, results) if not res.success]
+        self._log(f"  {len(values) - len(failed)}/{len(values)} points converged, "
+                  f"{sum(res.time for res in results):.1f} s fitting, "
+                  f"{sum(res.calls for res in results)} NLL calls")
+        if failed:
+            self._log(f"  Failed points: {', '.join(f'{v:.4f}' for v in failed)}")
+    
+    def _run_1d_scan_adaptive(
+        self,
+        ws: WorkspaceConfig,
+        poi: str,
+        scan_range: Tuple[float, float],
+        coarse_points: int,
+        root_dir: str,
+        logs_dir: str,
+        extra_args: Optional[List[str]],
+        systematics: str = "full_syst",
+        max_depth: int = 2
+    ):
+        """Run an adaptive 1D scan on the fit server.
+        
+        Each refinement pass is sent as one batch; the points are independent
+        fits, as in parallel mode.
+        """
+        scan = AdaptiveScan1D(scan_range, coarse_points, max_depth)
+        
+        store = self._store_part(root_dir, "adaptive")
+        channels = self._fit_channels(ws, [self.poi_builder.build_1d_scan(poi, val) for val in scan_range])
+        with self._start_fit_server(ws, logs_dir, extra_args, systematics, store, channels) as server:
+            def evaluate(points):
+                self._log(f"  Pass {scan.n_passes}: {len(points)} points")
+                requests = [
+                    (self.poi_builder.build_1d_scan(poi, val),
+                     self._fit_output(os.path.join(root_dir, f"fit_{poi}_{val:.4f}.root")), None)
+                    for val in points
+                ]
+                return [res.nll if res.success else None for res in server.fit_batch(requests)]
+            
+            results = scan.run(evaluate)
+        self._merge_store(root_dir)
+        
+        uniform = (coarse_points - 1) * 2 ** max_depth + 1
+        self._log(f"  {len(results)} points in {scan.n_passes} passes "
+                  f"(uniform grid at the same spacing: {uniform})")
     
     def _run_1d_scan_condor(
         self,
@@ -378,13 +780,28 @@ class QuickFitRunner:
         tag: str,
         queue: str,
         extra_args: Optional[List[str]],
-        systematics: str = "full_syst"
+        systematics: str = "full_syst",
+        points_per_job: int = 1,
+        job_minutes: float = 60.0
     ):
         """Submit 1D scan to Condor."""
         workdir = os.getcwd()
         scripts_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
         
-        if mode == "sequential":
+        if mode == "warm":
+            # Single job running the whole scan on the fit server
+            wrapper_path = os.path.join(logs_dir, f"{tag}_warm.sh")
+            submit_path = os.path.join(logs_dir, f"{tag}_warm.sub")
+            scan_args = ['--scan-type', '1d', '--poi', poi, '--min', str(values[0]),
+                         '--max', str(values[-1]), '--n-points', str(len(values))]
+            commands = [self._warm_scan_job_command(ws, scan_args, root_dir, tag, systematics)]
+            self._write_condor_wrapper(wrapper_path, commands, workdir)
+            self._write_condor_submit(submit_path, wrapper_path, logs_dir, f"{tag}_warm", queue,
+                                      cpus=self.config.quickfit_defaults.get('num_cpu', 1))
+            
+            subprocess.run(['condor_submit', submit_path], check=True)
+            self._log(f"Submitted warm 1D scan job: {tag}")
+        elif mode == "sequential":
             # Single job that runs all points sequentially
             wrapper_path = os.path.join(logs_dir, f"{tag}_sequential.sh")
             submit_path = os.path.join(logs_dir, f"{tag}_sequential.sub")
@@ -426,6 +843,16 @@ class QuickFitRunner:
             subprocess.run(['condor_submit', submit_path], check=True)
             self._log(f"Submitted sequential 1D scan job: {tag}")
             
+        elif points_per_job != 1:
+            # Several points per job, one workspace load each
+            points = [
+                (self.poi_builder.build_1d_scan(poi, val),
+                 os.path.abspath(os.path.join(root_dir, f"fit_{poi}_{val:.4f}.root")))
+                for val in values
+            ]
+            n_jobs = self._submit_packed_condor(ws, points, root_dir, logs_dir, tag, queue, extra_args, systematics,
+                                                points_per_job, job_minutes)
+            self._log(f"Submitted {n_jobs} packed 1D scan jobs: {tag}")
         else:  # parallel
             # One job per point
             submit_path = os.path.join(logs_dir, f"{tag}_parallel.sub")
@@ -438,6 +865,7 @@ class QuickFitRunner:
                 sf.write("request_cpus = 1\n")
                 sf.write("request_memory = 64000\n\n")
             
+            n_jobs = 0
             for val in values:
                 val_str = f"{val:.4f}"
                 job_tag = f"{tag}_{poi}_{val_str}"
@@ -446,8 +874,12 @@ class QuickFitRunner:
                 
                 poi_string = self.poi_builder.build_1d_scan(poi, val)
                 cmd = self._build_command(ws, poi_string, output_file, extra_args, systematics=systematics)
+                command = self._cached_command(cmd)
+                if command is None:
+                    continue
+                n_jobs += 1
                 
-                self._write_condor_wrapper(wrapper_path, [cmd.to_string()], workdir)
+                self._write_condor_wrapper(wrapper_path, [command], workdir)
                 
                 with open(submit_path, 'a') as sf:
                     sf.write(f"executable = {wrapper_path}\n")
@@ -457,8 +889,11 @@ class QuickFitRunner:
                     sf.write(f"error = {logs_dir}/{job_tag}.err\n")
                     sf.write("queue\n\n")
             
-            subprocess.run(['condor_submit', submit_path], check=True)
-            self._log(f"Submitted {len(values)} parallel 1D scan jobs: {tag}")
+            if len(values) > n_jobs:
+                self._log(f"  {len(values) - n_jobs} points taken from the fit cache")
+            if n_jobs:
+                subprocess.run(['condor_submit', submit_path], check=True)
+            self._log(f"Submitted {n_jobs} parallel 1D scan jobs: {tag}")
     
     def run_2d_scan(
         self,
@@ -478,7 +913,12 @@ class QuickFitRunner:
         queue: str = "medium",
         extra_args: Optional[List[str]] = None,
         systematics: str = "full_syst",
-        floating_poi_range: Optional[Tuple[float, float]] = None
+        floating_poi_range: Optional[Tuple[float, float]] = None,
+        adaptive_depth: int = 2,
+        n_workers: int = 10,
+        tile_size: int = 4,
+        points_per_job: int = 1,
+        job_minutes: float = 60.0
     ) -> str:
         """Run a 2D likelihood scan.
         
@@ -488,8 +928,13 @@ class QuickFitRunner:
             min1, max1, n1: Range and points for poi1.
             poi2: Second POI to scan.
             min2, max2, n2: Range and points for poi2.
-            mode: "parallel" or "sequential".
-            backend: "local" or "condor".
+            mode: "parallel", "sequential", "warm" (sequential in one
+                  minimizer on the fit server, each point starting from the
+                  previous best fit), "adaptive" (n_points is a coarse grid
+                  that is refined around the minimum and the contour levels,
+                  on the fit server) or "tiles" (grid cut into tiles fitted by
+                  n_workers work-stealing fit servers, see tile_scheduler.py).
+            backend: "local", "server" (local, one resident fit process) or "condor".
             output_dir: Base output directory.
             tag: Optional tag for output naming.
             queue: Condor queue.
@@ -497,11 +942,19 @@ class QuickFitRunner:
             systematics: Systematics mode ("full_syst" or "stat_only").
             floating_poi_range: Tuple (min, max) for the floating third POI.
                                If None, defaults to (-3, 3).
+            adaptive_depth: Number of times a coarse cell may be split
+                            (adaptive mode).
+            n_workers: Number of workers (tiles mode).
+            tile_size: Tile edge in points, 0 for whole rows (tiles mode).
+            points_per_job: Points per Condor job in parallel mode; more than 1
+                            fits them on one fit server per job, 0 sizes the
+                            jobs from measured fit times.
+            job_minutes: Target Condor job wall time for points_per_job=0.
         
         Returns:
             Path to output directory with ROOT files.
         """
-        ws = self._get_workspace(workspace)
+        ws = self._get_workspace(workspace, systematics)
         values1 = self._linspace(n1, min1, max1)
         values2 = self._linspace(n2, min2, max2)
         
@@ -517,10 +970,21 @@ class QuickFitRunner:
         self._log(f"Starting {mode} 2D scan: {poi1} x {poi2} ({total_points} points)")
         self._log(f"Output: {root_dir}")
         
-        if backend == "local":
+        if mode == "adaptive":
+            if backend == "condor":
+                raise ValueError("adaptive scans run on the local fit server, use backend local or server")
+            self._run_2d_scan_adaptive(ws, poi1, (min1, max1), n1, poi2, (min2, max2), n2, root_dir, logs_dir,
+                                       extra_args, systematics, floating_poi_range, adaptive_depth)
+        elif mode == "tiles":
+            self._run_2d_scan_tiles(ws, poi1, values1, poi2, values2, root_dir, logs_dir, backend, tag, queue,
+                                    systematics, floating_poi_range, n_workers, tile_size)
+        elif backend == "server" or (backend == "local" and mode == "warm"):
+            self._run_2d_scan_server(ws, poi1, values1, poi2, values2, root_dir, logs_dir, mode, extra_args, systematics, floating_poi_range)
+        elif backend == "local":
             self._run_2d_scan_local(ws, poi1, values1, poi2, values2, root_dir, logs_dir, mode, extra_args, systematics, floating_poi_range)
         elif backend == "condor":
-            self._run_2d_scan_condor(ws, poi1, values1, poi2, values2, root_dir, logs_dir, mode, tag, queue, extra_args, systematics, floating_poi_range)
+            self._run_2d_scan_condor(ws, poi1, values1, poi2, values2, root_dir, logs_dir, mode, tag, queue, extra_args, systematics, floating_poi_range,
+                                     points_per_job, job_minutes)
         else:
             raise ValueError(f"Unknown backend: {backend}")
         
@@ -540,17 +1004,18 @@ class QuickFitRunner:
         systematics: str = "full_syst",
         floating_poi_range: Optional[Tuple[float, float]] = None
     ):
-        """Run 2D scan locally."""
-        prev_results = {}
+        """Run 2D scan locally (sequential mode seeds as in 1D)."""
+        model = SeedModel()
         total = len(values1) * len(values2)
         count = 0
         
-        for v1 in values1:
-            for v2 in values2:
+        for i, v1 in enumerate(values1):
+            for j, v2 in enumerate(values2):
                 count += 1
                 self._log(f"  Point {count}/{total}: {poi1}={v1:.4f}, {poi2}={v2:.4f}")
                 
                 # Build POI string
+                prev_results = model.predict((i, j))[0] if mode == "sequential" else {}
                 poi_string = self.poi_builder.build_2d_scan(poi1, v1, poi2, v2, prev_results, floating_poi_range=floating_poi_range)
                 
                 # Build command
@@ -559,16 +1024,206 @@ class QuickFitRunner:
                 log_file = os.path.join(logs_dir, f"fit_{poi1}_{v1:.4f}__{poi2}_{v2:.4f}.log")
                 
                 # Run
-                success = self._run_local(cmd, log_file)
+                success = self._run_cached(cmd, log_file)
                 
                 # Extract results for sequential mode
                 if mode == "sequential" and success and os.path.exists(output_file):
                     try:
-                        prev_results = self.result_parser.extract_pois(output_file)
+                        model.add((i, j), self.result_parser.extract_pois(output_file))
                     except Exception:
-                        prev_results = {}
-                elif mode == "parallel":
-                    prev_results = {}
+                        pass
+    
+    def _run_2d_scan_server(
+        self,
+        ws: WorkspaceConfig,
+        poi1: str,
+        values1: List[float],
+        poi2: str,
+        values2: List[float],
+        root_dir: str,
+        logs_dir: str,
+        mode: str,
+        extra_args: Optional[List[str]],
+        systematics: str = "full_syst",
+        floating_poi_range: Optional[Tuple[float, float]] = None
+    ):
+        """Run 2D scan locally through one resident fit server.
+        
+        In warm mode the grid is walked row by row in alternating direction,
+        so that each point starts from the fit of its neighbour. Sequential
+        mode seeds each point from the model of the points before, as in 1D.
+        """
+        if mode == "warm":
+            points = [(v1, v2) for i, v1 in enumerate(values1)
+                      for v2 in (values2 if i % 2 == 0 else values2[::-1])]
+        else:
+            points = [(v1, v2) for v1 in values1 for v2 in values2]
+        
+        def output_file(v1, v2):
+            return self._fit_output(os.path.join(root_dir, f"fit_{poi1}_{v1:.4f}__{poi2}_{v2:.4f}.root"))
+        
+        store = self._store_part(root_dir, "server")
+        channels = self._fit_channels(ws, [
+            self.poi_builder.build_2d_scan(poi1, v1, poi2, v2, floating_poi_range=floating_poi_range)
+            for v1, v2 in (points[0], points[-1])
+        ])
+        with self._start_fit_server(ws, logs_dir, extra_args, systematics, store, channels) as server:
+            if mode in ("parallel", "warm"):
+                requests = [
+                    (self.poi_builder.build_2d_scan(poi1, v1, poi2, v2, floating_poi_range=floating_poi_range),
+                     output_file(v1, v2), None)
+                    for v1, v2 in points
+                ]
+                results = server.fit_batch(requests, warm=(mode == "warm"))
+            else:
+                results = []
+                model = SeedModel()
+                for count, (v1, v2) in enumerate(points, 1):
+                    self._log(f"  Point {count}/{len(points)}: {poi1}={v1:.4f}, {poi2}={v2:.4f}")
+                    poi_string = self.poi_builder.build_2d_scan(poi1, v1, poi2, v2, floating_poi_range=floating_poi_range)
+                    grid = (values1.index(v1), values2.index(v2))
+                    seeds, _ = model.predict(grid)
+                    result = server.fit(poi_string, output_file(v1, v2), seeds or None)
+                    results.append(result)
+                    if result.success:
+                        model.add(grid, {**result.pois, **server.values(result.request_id)})
+        self._merge_store(root_dir)
+        
+        n_failed = sum(1 for res in results if not res.success)
+        self._log(f"  {len(points) - n_failed}/{len(points)} points converged, "
+                  f"{sum(res.time for res in results):.1f} s fitting, "
+                  f"{sum(res.calls for res in results)} NLL calls")
+    
+    def _run_2d_scan_adaptive(
+        self,
+        ws: WorkspaceConfig,
+        poi1: str,
+        range1: Tuple[float, float],
+        coarse1: int,
+        poi2: str,
+        range2: Tuple[float, float],
+        coarse2: int,
+        root_dir: str,
+        logs_dir: str,
+        extra_args: Optional[List[str]],
+        systematics: str = "full_syst",
+        floating_poi_range: Optional[Tuple[float, float]] = None,
+        max_depth: int = 2
+    ):
+        """Run an adaptive 2D scan on the fit server, one batch per pass."""
+        scan = AdaptiveScan2D(range1, coarse1, range2, coarse2, max_depth)
+        
+        store = self._store_part(root_dir, "adaptive")
+        channels = self._fit_channels(ws, [
+            self.poi_builder.build_2d_scan(poi1, v1, poi2, v2, floating_poi_range=floating_poi_range)
+            for v1, v2 in zip(range1, range2)
+        ])
+        with self._start_fit_server(ws, logs_dir, extra_args, systematics, store, channels) as server:
+            def evaluate(points):
+                self._log(f"  Pass {scan.n_passes}: {len(points)} points")
+                requests = [
+                    (self.poi_builder.build_2d_scan(poi1, v1, poi2, v2, floating_poi_range=floating_poi_range),
+                     self._fit_output(os.path.join(root_dir, f"fit_{poi1}_{v1:.4f}__{poi2}_{v2:.4f}.root")), None)
+                    for v1, v2 in points
+                ]
+                return [res.nll if res.success else None for res in server.fit_batch(requests)]
+            
+            results = scan.run(evaluate)
+        self._merge_store(root_dir)
+        
+        uniform = ((coarse1 - 1) * 2 ** max_depth + 1) * ((coarse2 - 1) * 2 ** max_depth + 1)
+        self._log(f"  {len(results)} points in {scan.n_passes} passes "
+                  f"(uniform grid at the same spacing: {uniform})")
+    
+    def _run_2d_scan_tiles(
+        self,
+        ws: WorkspaceConfig,
+        poi1: str,
+        values1: List[float],
+        poi2: str,
+        values2: List[float],
+        root_dir: str,
+        logs_dir: str,
+        backend: str,
+        tag: str,
+        queue: str,
+        systematics: str = "full_syst",
+        floating_poi_range: Optional[Tuple[float, float]] = None,
+        n_workers: int = 10,
+        tile_size: int = 4
+    ):
+        """Run a 2D scan as tiles on work-stealing workers.
+        
+        The scan definition and the tiles are written to a shared index in
+        logs_dir; each worker (a Condor job, or a local process) runs one fit
+        server and claims tiles from it, see quickfit/tile_scheduler.py.
+        """
+        if not self.config.config_path:
+            raise ValueError("tiled scans need a configuration loaded from YAML")
+        index_dir = os.path.abspath(os.path.join(logs_dir, "tile_index"))
+        tiles = make_tiles(len(values1), len(values2), tile_size)
+        TileIndex.write_job(index_dir, {
+            'config': self.config.config_path,
+            'workspace': ws.label,
+            'systematics': systematics,
+            'poi1': poi1, 'poi2': poi2,
+            'values1': values1, 'values2': values2,
+            'floating_poi_range': list(floating_poi_range) if floating_poi_range else None,
+            'root_dir': os.path.abspath(root_dir),
+            'logs_dir': os.path.abspath(logs_dir),
+            'result_store': bool(self.config.quickfit_defaults.get('result_store', 0)),
+            'keep_fit_results': self._fit_output('') is not None,
+            'store_nps': self.config.quickfit_defaults.get('store_nps', ''),
+            'channels': self._fit_channels(ws, [
+                self.poi_builder.build_2d_scan(poi1, v1, poi2, v2, floating_poi_range=floating_poi_range)
+                for v1, v2 in ((values1[0], values2[0]), (values1[-1], values2[-1]))
+            ]),
+            'tiles': tiles
+        })
+        n_workers = max(1, min(n_workers, len(tiles)))
+        scheduler = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'tile_scheduler.py')
+        self._log(f"  {len(tiles)} tiles on {n_workers} workers, index: {index_dir}")
+        
+        if backend == "condor":
+            workdir = os.getcwd()
+            wrapper_path = os.path.join(logs_dir, f"{tag}_tile_worker.sh")
+            submit_path = os.path.join(logs_dir, f"{tag}_tiles.sub")
+            self._write_condor_wrapper(
+                wrapper_path, [f"python3 {scheduler} --index {index_dir} --worker $1"], workdir
+            )
+            with open(submit_path, 'w') as sf:
+                sf.write("universe = vanilla\n")
+                sf.write("getenv = True\n")
+                sf.write('+UseOS = "el9"\n')
+                sf.write(f'+JobCategory = "{queue}"\n')
+                sf.write(f"request_cpus = {self.config.quickfit_defaults.get('num_cpu', 1)}\n")
+                sf.write("request_memory = 64000\n\n")
+                sf.write(f"executable = {wrapper_path}\n")
+                sf.write("arguments = $(Process)\n")
+                sf.write(f"JobBatchName = {tag}_tiles\n")
+                sf.write(f"log = {logs_dir}/{tag}_tiles.log\n")
+                sf.write(f"output = {logs_dir}/{tag}_tile_worker_$(Process).out\n")
+                sf.write(f"error = {logs_dir}/{tag}_tile_worker_$(Process).err\n")
+                sf.write(f"queue {n_workers}\n")
+            
+            subprocess.run(['condor_submit', submit_path], check=True)
+            self._log(f"Submitted {n_workers} tile workers: {tag}")
+            self._log(f"  Progress: python3 {scheduler} --index {index_dir} --status")
+            if self.config.quickfit_defaults.get('result_store', 0):
+                self._log(f"  Merge the worker stores when done: python3 -m utils.scan_store --merge {root_dir}")
+        else:
+            workers = []
+            for k in range(n_workers):
+                with open(os.path.join(logs_dir, f"tile_worker_{k}.log"), 'w') as log:
+                    workers.append(subprocess.Popen(
+                        [sys.executable, scheduler, '--index', index_dir, '--worker', str(k)],
+                        stdout=log, stderr=subprocess.STDOUT
+                    ))
+            for w in workers:
+                w.wait()
+            converged, failed, missing = TileIndex(index_dir).status()
+            self._log(f"  {converged} converged, {failed} failed, {missing} not fitted")
+            self._merge_store(root_dir)
     
     def _run_2d_scan_condor(
         self,
@@ -584,12 +1239,34 @@ class QuickFitRunner:
         queue: str,
         extra_args: Optional[List[str]],
         systematics: str = "full_syst",
-        floating_poi_range: Optional[Tuple[float, float]] = None
+        floating_poi_range: Optional[Tuple[float, float]] = None,
+        points_per_job: int = 1,
+        job_minutes: float = 60.0
     ):
         """Submit 2D scan to Condor."""
         workdir = os.getcwd()
         scripts_dir = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
         
+        if mode == "warm":
+            # Single job running the whole scan on the fit server
+            wrapper_path = os.path.join(logs_dir, f"{tag}_warm.sh")
+            submit_path = os.path.join(logs_dir, f"{tag}_warm.sub")
+            scan_args = ['--scan-type', '2d',
+                         '--poi', poi1, '--min', str(values1[0]), '--max', str(values1[-1]),
+                         '--n-points', str(len(values1)),
+                         '--poi2', poi2, '--min2', str(values2[0]), '--max2', str(values2[-1]),
+                         '--n-points2', str(len(values2))]
+            if floating_poi_range:
+                scan_args += ['--floating-poi-range', str(floating_poi_range[0]), str(floating_poi_range[1])]
+            commands = [self._warm_scan_job_command(ws, scan_args, root_dir, tag, systematics)]
+            self._write_condor_wrapper(wrapper_path, commands, workdir)
+            self._write_condor_submit(submit_path, wrapper_path, logs_dir, f"{tag}_warm", queue,
+                                      cpus=self.config.quickfit_defaults.get('num_cpu', 1))
+            
+            subprocess.run(['condor_submit', submit_path], check=True)
+            self._log(f"Submitted warm 2D scan job: {tag}")
+            return
+        
         if mode == "sequential":
             # Single job that runs all points sequentially
             wrapper_path = os.path.join(logs_dir, f"{tag}_sequential.sh")
@@ -636,6 +1313,18 @@ class QuickFitRunner:
             self._log(f"Submitted sequential 2D scan job: {tag}")
             return
         
+        if points_per_job != 1:
+            # Several points per job, one workspace load each
+            points = [
+                (self.poi_builder.build_2d_scan(poi1, v1, poi2, v2, floating_poi_range=floating_poi_range),
+                 os.path.abspath(os.path.join(root_dir, f"fit_{poi1}_{v1:.4f}__{poi2}_{v2:.4f}.root")))
+                for v1 in values1 for v2 in values2
+            ]
+            n_jobs = self._submit_packed_condor(ws, points, root_dir, logs_dir, tag, queue, extra_args, systematics,
+                                                points_per_job, job_minutes)
+            self._log(f"Submitted {n_jobs} packed 2D scan jobs: {tag}")
+            return
+        
         # Parallel: one job per point
         submit_path = os.path.join(logs_dir, f"{tag}_parallel.sub")
         
@@ -647,6 +1336,7 @@ class QuickFitRunner:
             sf.write("request_cpus = 1\n")
             sf.write("request_memory = 64000\n\n")
         
+        total_jobs = 0
         for v1 in values1:
             for v2 in values2:
                 v1_str = f"{v1:.4f}"
@@ -657,8 +1347,12 @@ class QuickFitRunner:
                 
                 poi_string = self.poi_builder.build_2d_scan(poi1, v1, poi2, v2, floating_poi_range=floating_poi_range)
                 cmd = self._build_command(ws, poi_string, output_file, extra_args, systematics=systematics)
+                command = self._cached_command(cmd)
+                if command is None:
+                    continue
+                total_jobs += 1
                 
-                self._write_condor_wrapper(wrapper_path, [cmd.to_string()], workdir)
+                self._write_condor_wrapper(wrapper_path, [command], workdir)
                 
                 with open(submit_path, 'a') as sf:
                     sf.write(f"executable = {wrapper_path}\n")
@@ -668,8 +1362,11 @@ class QuickFitRunner:
                     sf.write(f"error = {logs_dir}/{job_tag}.err\n")
                     sf.write("queue\n\n")
         
-        subprocess.run(['condor_submit', submit_path], check=True)
-        total_jobs = len(values1) * len(values2)
+        n_cached = len(values1) * len(values2) - total_jobs
+        if n_cached:
+            self._log(f"  {n_cached} points taken from the fit cache")
+        if total_jobs:
+            subprocess.run(['condor_submit', submit_path], check=True)
         self._log(f"Submitted {total_jobs} parallel 2D scan jobs: {tag}")
     
     def run_fit(
@@ -686,9 +1383,14 @@ class QuickFitRunner:
     ) -> str:
         """Run a fit.
         
+        With backend "server" the fit runs on the fit server: HESSE and the MINOS
+        errors of the scan POIs are spread over quickfit_defaults error_workers
+        forked processes, and the result is also appended to <tag>_store.root
+        with the POI correlations.
+        
         Args:
             workspace: Workspace label from config.
-            backend: "local" or "condor".
+            backend: "local", "server" or "condor".
             output_dir: Output directory.
             tag: Optional tag for output naming.
             queue: Condor queue.
@@ -700,7 +1402,7 @@ class QuickFitRunner:
         Returns:
             Path to output ROOT file.
         """
-        ws = self._get_workspace(workspace)
+        ws = self._get_workspace(workspace, systematics)
         
         # Setup output
         timestamp = time.strftime('%Y%m%d_%H%M%S')
@@ -718,17 +1420,31 @@ class QuickFitRunner:
         
         if backend == "local":
             log_file = os.path.join(logs_dir, "fit.log")
-            success = self._run_local(cmd, log_file)
+            success = self._run_cached(cmd, log_file)
             if success:
                 self._log("Fit completed successfully")
             else:
                 self._log("Fit failed - check logs")
+        elif backend == "server":
+            store = os.path.join(output_dir, f"{tag}_store.root")
+            minos_pois = ",".join(self.config.scan_pois) if minos else ""
+            with self._start_fit_server(ws, logs_dir, extra_args, systematics, store,
+                                        hesse=hesse, minos_pois=minos_pois) as server:
+                res = server.fit(poi_string, output_file)
+            if res.success:
+                self._log(f"Fit completed successfully in {res.time:.1f} s{' (cached)' if res.cached else ''}")
+            else:
+                self._log(f"Fit failed ({res.error or f'status {res.status}'}) - check logs")
         elif backend == "condor":
             workdir = os.getcwd()
             wrapper_path = os.path.join(logs_dir, f"{tag}.sh")
             submit_path = os.path.join(logs_dir, f"{tag}.sub")
             
-            self._write_condor_wrapper(wrapper_path, [cmd.to_string()], workdir)
+            command = self._cached_command(cmd)
+            if command is None:
+                self._log(f"Fit taken from the fit cache: {output_file}")
+                return output_file
+            self._write_condor_wrapper(wrapper_path, [command], workdir)
             self._write_condor_submit(submit_path, wrapper_path, logs_dir, tag, queue)
             
             subprocess.run(['condor_submit', submit_path], check=True)
@@ -750,13 +1466,27 @@ def main():
     parser.add_argument('--scan-type', choices=['1d', '2d', 'fit'],
                        required=True, help='Type of operation')
     parser.add_argument('--workspace', required=True, help='Workspace label')
-    parser.add_argument('--mode', choices=['parallel', 'sequential'],
-                       default='parallel', help='Execution mode for scans')
-    parser.add_argument('--backend', choices=['local', 'condor'],
-                       default='local', help='Execution backend')
+    parser.add_argument('--mode', choices=['parallel', 'sequential', 'warm', 'adaptive', 'tiles'],
+                       default='parallel',
+                       help='Execution mode for scans (warm: sequential in one minimizer on the fit server, '
+                            'adaptive: coarse grid refined around the minimum and contours, '
+                            'tiles: 2D grid on work-stealing fit server workers)')
+    parser.add_argument('--adaptive-depth', type=int, default=2,
+                       help='Adaptive mode: number of times a coarse interval/cell may be split')
+    parser.add_argument('--workers', type=int, default=10, help='Tiles mode: number of workers')
+    parser.add_argument('--tile-size', type=int, default=4,
+                       help='Tiles mode: tile edge in points (0 = whole rows)')
+    parser.add_argument('--backend', choices=['local', 'server', 'condor'],
+                       default='local',
+                       help='Execution backend (server: local scan through one resident fit process)')
     parser.add_argument('--output-dir', default='.', help='Output directory')
     parser.add_argument('--tag', help='Tag for output naming')
     parser.add_argument('--queue', default='medium', help='Condor queue')
+    parser.add_argument('--points-per-job', type=int, default=1,
+                       help='Parallel Condor scans: points per job on one fit server '
+                            '(0 = size from measured fit times)')
+    parser.add_argument('--job-minutes', type=float, default=60.0,
+                       help='Target job wall time for --points-per-job 0')
     
     # 1D scan options
     parser.add_argument('--poi', help='POI to scan (1D)')
@@ -777,13 +1507,16 @@ def main():
     parser.add_argument('--minos', type=int, default=0, help='Run MINOS (0 or 1, for fit)')
     
     # Systematics options
-    parser.add_argument('--systematics', choices=['full_syst', 'stat_only'],
-                       default='full_syst', help='Systematics mode')
+    parser.add_argument('--systematics', default='full_syst',
+                       help='Systematics mode: a systematics configuration of the config '
+                            '(full_syst, stat_only, pruned, ...)')
     
     args = parser.parse_args()
     
     # Load config and create runner
     config = AnalysisConfig.from_yaml(args.config)
+    if config.systematics and args.systematics not in config.systematics:
+        parser.error(f"Unknown systematics {args.systematics}. Available: {list(config.systematics.keys())}")
     runner = QuickFitRunner(config)
     
     if args.scan_type == '1d':
@@ -800,7 +1533,10 @@ def main():
             output_dir=args.output_dir,
             tag=args.tag,
             queue=args.queue,
-            systematics=args.systematics
+            systematics=args.systematics,
+            adaptive_depth=args.adaptive_depth,
+            points_per_job=args.points_per_job,
+            job_minutes=args.job_minutes
         )
     elif args.scan_type == '2d':
         if not all([args.poi, args.poi2, args.min is not None, args.max is not None,
@@ -823,7 +1559,12 @@ def main():
             tag=args.tag,
             queue=args.queue,
             systematics=args.systematics,
-            floating_poi_range=floating_range
+            floating_poi_range=floating_range,
+            adaptive_depth=args.adaptive_depth,
+            n_workers=args.workers,
+            tile_size=args.tile_size,
+            points_per_job=args.points_per_job,
+            job_minutes=args.job_minutes
         )
     elif args.scan_type == 'fit':
         runner.run_fit(
@@ -0,0 +1,373 @@
+#!/usr/bin/env python3
+"""
+Work-stealing tile scheduler for 2D scans.
+
+The scan grid is cut into tiles (square blocks or whole rows) and N workers,
+e.g. Condor jobs, each start one fit server and claim tiles until none is
+left. Inside a tile the points are fitted in snake order. Each point starts
+from the closest point that already converged, whichever worker fitted it:
+warm (same minimizer) if that is the point this worker fitted last, otherwise
+seeded with all parameters of the neighbour's fit: from the server's memory
+if this worker fitted it, else from its saved fitResult, or only from its
+POIs when the fit files are replaced by the result store (each worker then
+writes one store part to the scan directory, see utils/scan_store.py). Every
+converged point records all its fitted parameters, and once enough of them
+lie around a point, its starting values are instead predicted by a local
+linear or quadratic model of those points (utils/seed_model.py).
+
+All state lives in an index directory on the shared filesystem, so workers
+need no other communication and a scan can be inspected or resumed:
+    <index>/job.json              scan definition and tile list
+    <index>/claims/tile_<t>.<g>   claim of tile t (generation g); its mtime is
+                                  the heartbeat, a stale claim can be taken over
+    <index>/points/<i>_<j>.json   result of grid point (i, j)
+    <index>/retries/<i>_<j>.<n>   claim of retry n of a failed point
+When no tile is left, workers retry failed points (seeded from neighbours
+that converged in the meantime) instead of rerunning their whole tile.
+
+Example usage:
+    python3 quickfit/tile_scheduler.py --index logs_<tag>/tile_index --worker 0
+    python3 quickfit/tile_scheduler.py --index logs_<tag>/tile_index --status
+"""
+
+import argparse
+import json
+import math
+import os
+import sys
+import time
+from typing import Dict, List, Optional, Tuple
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from utils.config import AnalysisConfig
+from utils.poi_builder import POIBuilder
+from utils import scan_store
+from utils.fit_cache import FitCache
+from utils.seed_model import SeedModel
+from quickfit.fit_server import FitServerClient
+
+GridPoint = Tuple[int, int]
+
+
+def make_tiles(n1: int, n2: int, tile_size: int = 4) -> List[List[GridPoint]]:
+    """Cut an n1 x n2 grid into tiles.
+
+    Args:
+        n1: Points along the first POI.
+        n2: Points along the second POI.
+        tile_size: Tile edge in points; 0 gives one tile per row of the first POI.
+
+    Returns:
+        Tiles ordered from the grid centre outwards, each a list of (i, j)
+        in snake order.
+    """
+    s1 = tile_size if tile_size > 0 else 1
+    s2 = tile_size if tile_size > 0 else n2
+    tiles = []
+    for i0 in range(0, n1, s1):
+        for j0 in range(0, n2, s2):
+            points = []
+            for k, i in enumerate(range(i0, min(i0 + s1, n1))):
+                cols = list(range(j0, min(j0 + s2, n2)))
+                points += [(i, j) for j in (cols if k % 2 == 0 else cols[::-1])]
+            tiles.append(points)
+
+    c1, c2 = (n1 - 1) / 2, (n2 - 1) / 2
+
+    def distance(tile):
+        return min(math.hypot(i - c1, j - c2) for i, j in tile)
+
+    return sorted(tiles, key=distance)
+
+
+class TileIndex:
+    """
+    Shared-filesystem index of a tiled scan.
+
+    Claims are files created with O_EXCL, which is atomic on the shared
+    filesystem, and results are written to a temporary file and renamed.
+    """
+
+    def __init__(self, index_dir: str):
+        """Initialize index.
+
+        Args:
+            index_dir: Index directory (created by write_job).
+        """
+        self.index_dir = index_dir
+        self.claims_dir = os.path.join(index_dir, 'claims')
+        self.points_dir = os.path.join(index_dir, 'points')
+        self.retries_dir = os.path.join(index_dir, 'retries')
+        self._job = None
+
+    @classmethod
+    def write_job(cls, index_dir: str, job: Dict) -> 'TileIndex':
+        """Create the index directory and write the scan definition."""
+        index = cls(index_dir)
+        for d in (index.claims_dir, index.points_dir, index.retries_dir):
+            os.makedirs(d, exist_ok=True)
+        index._atomic_write(os.path.join(index_dir, 'job.json'), job)
+        return index
+
+    @property
+    def job(self) -> Dict:
+        """Scan definition."""
+        if self._job is None:
+            with open(os.path.join(self.index_dir, 'job.json')) as f:
+                self._job = json.load(f)
+        return self._job
+
+    @staticmethod
+    def _atomic_write(path: str, data: Dict) -> None:
+        tmp = f"{path}.tmp{os.getpid()}"
+        with open(tmp, 'w') as f:
+            json.dump(data, f)
+        os.replace(tmp, path)
+
+    @staticmethod
+    def _create_exclusive(path: str) -> bool:
+        """Create path if it does not exist yet; True if this call created it."""
+        try:
+            os.close(os.open(path, os.O_CREAT | os.O_EXCL | os.O_WRONLY))
+            return True
+        except FileExistsError:
+            return False
+
+    def load_results(self) -> Dict[GridPoint, Dict]:
+        """Read the results of all points fitted so far."""
+        results = {}
+        for name in os.listdir(self.points_dir):
+            if not name.endswith('.json'):
+                continue
+            try:
+                with open(os.path.join(self.points_dir, name)) as f:
+                    res = json.load(f)
+            except (OSError, ValueError):
+                continue
+            results[(res['i'], res['j'])] = res
+        return results
+
+    def record(self, result: Dict) -> None:
+        """Store the result of one point."""
+        self._atomic_write(os.path.join(self.points_dir, f"{result['i']}_{result['j']}.json"), result)
+
+    def _claims(self, tile: int) -> List[int]:
+        prefix = f"tile_{tile}."
+        return sorted(int(n[len(prefix):]) for n in os.listdir(self.claims_dir) if n.startswith(prefix))
+
+    def claim_tile(self, stale_after: float) -> Optional[Tuple[int, str]]:
+        """Claim the next unclaimed tile, or take over a stale one.
+
+        Args:
+            stale_after: Seconds without heartbeat after which a claim is stale.
+
+        Returns:
+            (tile index, claim file) or None if there is nothing left to do.
+        """
+        results = None
+        for tile, points in enumerate(self.job['tiles']):
+            gens = self._claims(tile)
+            if not gens:
+                path = os.path.join(self.claims_dir, f"tile_{tile}.0")
+                if self._create_exclusive(path):
+                    return tile, path
+                continue
+            path = os.path.join(self.claims_dir, f"tile_{tile}.{gens[-1]}")
+            try:
+                stale = time.time() - os.path.getmtime(path) > stale_after
+            except OSError:
+                continue
+            if not stale:
+                continue
+            if results is None:
+                results = self.load_results()
+            if all(tuple(p) in results for p in points):
+                continue
+            path = os.path.join(self.claims_dir, f"tile_{tile}.{gens[-1] + 1}")
+            if self._create_exclusive(path):
+                return tile, path
+        return None
+
+    def claim_retry(self, point: GridPoint, attempt: int) -> bool:
+        """Claim retry number attempt of a failed point."""
+        return self._create_exclusive(os.path.join(self.retries_dir, f"{point[0]}_{point[1]}.{attempt}"))
+
+    @staticmethod
+    def heartbeat(claim_path: str) -> None:
+        """Mark a claim as alive."""
+        try:
+            os.utime(claim_path)
+        except OSError:
+            pass
+
+    def status(self) -> Tuple[int, int, int]:
+        """Return (converged, failed, missing) point counts."""
+        results = self.load_results()
+        total = sum(len(t) for t in self.job['tiles'])
+        converged = sum(1 for r in results.values() if r['status'] == 0)
+        return converged, len(results) - converged, total - len(results)
+
+
+class TileWorker:
+    """One worker of a tiled scan: a fit server plus the claim loop."""
+
+    def __init__(
+        self,
+        index: TileIndex,
+        worker_id: int,
+        max_retries: int = 1,
+        stale_after: float = 3600.0,
+        seed_radius: float = 2.5
+    ):
+        """Initialize worker.
+
+        Args:
+            index: Shared index of the scan.
+            worker_id: Worker number (for logs).
+            max_retries: How often a failed point is retried.
+            stale_after: Seconds after which an unrefreshed tile claim is taken over.
+            seed_radius: Farthest neighbour (in grid steps) used as seed.
+        """
+        self.index = index
+        self.job = index.job
+        self.worker_id = worker_id
+        self.max_retries = max_retries
+        self.stale_after = stale_after
+        self.seed_radius = seed_radius
+        self.config = AnalysisConfig.from_yaml(self.job['config'])
+        self.poi_builder = POIBuilder(self.config)
+        self.results: Dict[GridPoint, Dict] = {}
+        self._last: Optional[GridPoint] = None  # point the server state belongs to
+        self._requests: Dict[GridPoint, str] = {}  # request ids of this worker's fits, for #id seeds
+
+    def _log(self, msg: str):
+        print(f"[worker {self.worker_id}] {msg}", flush=True)
+
+    def _neighbour(self, point: GridPoint) -> Optional[GridPoint]:
+        """Closest converged point, preferring the one the server holds."""
+        best, best_dist = None, self.seed_radius
+        for p, res in self.results.items():
+            if res['status'] != 0 or p == point:
+                continue
+            dist = math.hypot(p[0] - point[0], p[1] - point[1])
+            if dist < best_dist or (dist == best_dist and p == self._last):
+                best, best_dist = p, dist
+        return best
+
+    def _predict(self, point: GridPoint) -> Tuple[Dict[str, float], int]:
+        """Starting values from the model of the converged points within seed_radius."""
+        model = SeedModel()
+        for p, res in self.results.items():
+            if res['status'] == 0 and res.get('values'):
+                model.add(p, res['values'])
+        return model.predict(point, self.seed_radius)
+
+    def _fit_point(self, server: FitServerClient, point: GridPoint, attempt: int) -> None:
+        job = self.job
+        i, j = point
+        v1, v2 = job['values1'][i], job['values2'][j]
+        output_file = None
+        if job.get('keep_fit_results', True):
+            output_file = os.path.join(job['root_dir'], f"fit_{job['poi1']}_{v1:.4f}__{job['poi2']}_{v2:.4f}.root")
+        floating = tuple(job['floating_poi_range']) if job.get('floating_poi_range') else None
+        poi_string = self.poi_builder.build_2d_scan(job['poi1'], v1, job['poi2'], v2, floating_poi_range=floating)
+
+        neighbour = self._neighbour(point)
+        warm = neighbour is not None and neighbour == self._last
+        prediction, order = self._predict(point)
+        seeds = None
+        if order > 0:
+            # also when warm: the minimizer keeps its step sizes but starts at the prediction
+            seeds = prediction
+        elif neighbour is not None and not warm:
+            if neighbour in self._requests:
+                seeds = '#' + self._requests[neighbour]
+            elif self.results[neighbour].get('output'):
+                seeds = '@' + self.results[neighbour]['output']
+            else:
+                seeds = self.results[neighbour]['pois']
+        res = server.fit(poi_string, output_file, seeds, warm=warm)
+        self._requests[point] = res.request_id
+
+        result = {
+            'i': i, 'j': j, 'v1': v1, 'v2': v2,
+            'status': res.status if not res.error else -1,
+            'nll': res.nll, 'pois': res.pois, 'calls': res.calls, 'time': res.time,
+            'output': output_file, 'seed': list(neighbour) if neighbour else None,
+            'seed_order': order, 'warm': warm, 'worker': self.worker_id, 'attempt': attempt
+        }
+        if res.success:
+            result['values'] = {**res.pois, **server.values(res.request_id)}
+        self.index.record(result)
+        self.results[point] = result
+        self._last = point if res.success else None
+
+    def run(self) -> None:
+        """Fit tiles until none is left, then retry failed points."""
+        ws = self.config.workspaces[self.job['workspace']].for_systematics(self.job['systematics'])
+        server = FitServerClient(
+            ws,
+            exclude_nps=self.config.get_exclude_nps_pattern(systematics=self.job['systematics']),
+            min_tolerance=self.config.quickfit_defaults.get('min_tolerance', 0.0001),
+            eval_backend=self.config.quickfit_defaults.get('eval_backend', 'legacy'),
+            num_cpu=self.config.quickfit_defaults.get('num_cpu', 1),
+            store_file=(scan_store.new_part(self.job['root_dir'], f"w{self.worker_id}")
+                        if self.job.get('result_store') else None),
+            store_nps=self.job.get('store_nps', ''),
+            channels=self.job.get('channels', ''),
+            cache=FitCache.from_config(self.config),
+            profile=bool(self.config.quickfit_defaults.get('profile', 0)),
+            poly_formulas=bool(self.config.quickfit_defaults.get('poly_formulas', 0)),
+            log_file=os.path.join(self.job['logs_dir'], f"fit_server_worker{self.worker_id}.log")
+        )
+        with server:
+            while True:
+                claim = self.index.claim_tile(self.stale_after)
+                if claim is None:
+                    break
+                tile, claim_path = claim
+                self.results = self.index.load_results()
+                todo = [tuple(p) for p in self.job['tiles'][tile]]
+                self._log(f"tile {tile}: {len(todo)} points")
+                for point in todo:
+                    if point in self.results and self.results[point]['status'] == 0:
+                        continue
+                    self._fit_point(server, point, 0)
+                    self.index.heartbeat(claim_path)
+
+            self.results = self.index.load_results()
+            for point, res in sorted(self.results.items()):
+                attempt = res.get('attempt', 0) + 1
+                if res['status'] == 0 or attempt > self.max_retries:
+                    continue
+                if self.index.claim_retry(point, attempt):
+                    self._log(f"retry {attempt} of point {point}")
+                    self.results = self.index.load_results()
+                    self._fit_point(server, point, attempt)
+        converged, failed, missing = self.index.status()
+        self._log(f"done: {converged} converged, {failed} failed, {missing} not fitted yet")
+
+
+def main():
+    """CLI interface for tiled scan workers."""
+    parser = argparse.ArgumentParser(description="Worker of a tiled 2D scan.")
+    parser.add_argument('--index', required=True, help='Index directory of the scan')
+    parser.add_argument('--worker', type=int, default=0, help='Worker number')
+    parser.add_argument('--max-retries', type=int, default=1, help='Retries of a failed point')
+    parser.add_argument('--stale-after', type=float, default=3600.0,
+                       help='Seconds after which an inactive tile claim is taken over')
+    parser.add_argument('--status', action='store_true', help='Print scan progress and exit')
+    args = parser.parse_args()
+
+    index = TileIndex(args.index)
+    if args.status:
+        converged, failed, missing = index.status()
+        print(f"{converged} converged, {failed} failed, {missing} not fitted yet")
+        return
+    TileWorker(index, args.worker, args.max_retries, args.stale_after).run()
+
+
+if __name__ == '__main__':
+    main()
@@ -57,11 +57,11 @@ class VariablePOIScanRunner:
         if self.verbose:
             print(msg)
     
-    def _get_workspace(self, label: str) -> WorkspaceConfig:
-        """Get workspace configuration by label."""
+    def _get_workspace(self, label: str, systematics: str = "full_syst") -> WorkspaceConfig:
+        """Get workspace configuration by label (its reduced file for systematics, if any)."""
         if label not in self.config.workspaces:
             raise ValueError(f"Unknown workspace: {label}. Available: {list(self.config.workspaces.keys())}")
-        return self.config.workspaces[label]
+        return self.config.workspaces[label].for_systematics(systematics)
     
     def _linspace(self, n: int, min_val: float, max_val: float) -> List[float]:
         """Generate linearly spaced values."""
@@ -204,7 +204,7 @@ class VariablePOIScanRunner:
         Returns:
             Path to output directory with ROOT files.
         """
-        ws = self._get_workspace(workspace)
+        ws = self._get_workspace(workspace, systematics)
         values = self._linspace(n_points, min_val, max_val)
         
         # Determine scan type
@@ -556,7 +556,7 @@ class VariablePOIScanRunner:
         Returns:
             Path to output directory with ROOT files.
         """
-        ws = self._get_workspace(workspace)
+        ws = self._get_workspace(workspace, systematics)
         
         # Determine scan type
         n_float = len(float_pois)
@@ -0,0 +1,219 @@
+#!/usr/bin/env python3
+"""
+Adaptive grid refinement for 1D and 2D likelihood scans.
+
+A scan starts from a coarse uniform grid. Intervals (1D) or cells (2D) are
+then split in two (four) wherever the deltaNLL values at their corners
+straddle one of the contour levels, or where the cell touches the current
+minimum. Refinement stops after max_depth splits, so that the finest spacing
+is coarse_step / 2**max_depth. Most of the points of a uniform grid lie far
+outside the 2 sigma contour and are never fitted.
+
+The scheduler does not run fits itself: it calls an evaluate function with
+the list of new points of each pass, which can send them as one batch.
+
+Example usage:
+    from utils.adaptive_scan import AdaptiveScan2D
+
+    scan = AdaptiveScan2D((-1, 1), 9, (-1.5, 1.5), 9, max_depth=2)
+    results = scan.run(lambda points: [fit(p) for p in points])
+    # results: {(x, y): nll, ...}, failed points have nll None
+"""
+
+import math
+from typing import Callable, Dict, List, Optional, Sequence, Tuple
+
+# deltaNLL levels of the 68% and 95% CL contours, as in plotting/plot_2d_scan.py
+CONTOUR_LEVELS_1D = {'68': 0.5, '95': 2.0}
+CONTOUR_LEVELS_2D = {'68': 1.15, '95': 3.0}
+
+# Coordinates are rounded so that points created by neighbouring cells coincide
+PRECISION = 10
+
+Point1D = float
+Point2D = Tuple[float, float]
+
+
+def _linspace(n: int, lo: float, hi: float) -> List[float]:
+    """Generate linearly spaced values."""
+    if n <= 1:
+        return [lo]
+    step = (hi - lo) / (n - 1)
+    return [round(lo + i * step, PRECISION) for i in range(n)]
+
+
+def _straddles(values: Sequence[Optional[float]], levels: Sequence[float]) -> bool:
+    """True if the corner deltaNLL values lie on both sides of a level."""
+    known = [v for v in values if v is not None]
+    if len(known) < 2:
+        return False
+    lo, hi = min(known), max(known)
+    return any(lo <= level <= hi for level in levels)
+
+
+class AdaptiveScan1D:
+    """
+    Adaptive 1D scan scheduler.
+
+    Attributes:
+        results: Dict of scan value -> NLL (None for failed fits).
+        n_passes: Number of evaluation passes run so far.
+    """
+
+    def __init__(
+        self,
+        scan_range: Tuple[float, float],
+        coarse_points: int = 9,
+        max_depth: int = 2,
+        levels: Optional[Sequence[float]] = None
+    ):
+        """Initialize scheduler.
+
+        Args:
+            scan_range: (min, max) of the scan.
+            coarse_points: Number of points of the initial uniform grid.
+            max_depth: Maximum number of times an interval is halved.
+            levels: deltaNLL levels to resolve (default: 68% and 95% CL).
+        """
+        self.grid = _linspace(max(coarse_points, 2), *scan_range)
+        self.max_depth = max_depth
+        self.levels = list(levels) if levels is not None else list(CONTOUR_LEVELS_1D.values())
+        self.results: Dict[Point1D, Optional[float]] = {}
+        self.n_passes = 0
+        # leaf intervals (lo, hi, depth)
+        self._intervals = [(lo, hi, 0) for lo, hi in zip(self.grid[:-1], self.grid[1:])]
+
+    def _delta(self) -> Dict[Point1D, Optional[float]]:
+        """deltaNLL of every evaluated point w.r.t. the current minimum."""
+        known = [v for v in self.results.values() if v is not None]
+        nll_min = min(known) if known else 0.0
+        return {p: (v - nll_min if v is not None else None) for p, v in self.results.items()}
+
+    def _needs_refinement(self, lo: float, hi: float, delta: Dict[Point1D, Optional[float]], best: float) -> bool:
+        """Refine around the minimum and across the contour levels."""
+        if lo <= best <= hi:
+            return True
+        return _straddles([delta[lo], delta[hi]], self.levels)
+
+    def run(self, evaluate: Callable[[List[Point1D]], List[Optional[float]]]) -> Dict[Point1D, Optional[float]]:
+        """Run the scan.
+
+        Args:
+            evaluate: Function fitting a list of points and returning their NLL.
+
+        Returns:
+            Dict of scan value -> NLL for every point fitted.
+        """
+        pending = list(self.grid)
+        while pending:
+            self.n_passes += 1
+            for p, nll in zip(pending, evaluate(pending)):
+                self.results[p] = nll
+
+            delta = self._delta()
+            known = {p: v for p, v in delta.items() if v is not None}
+            best = min(known, key=known.get) if known else math.nan
+            intervals, pending = [], []
+            for lo, hi, depth in self._intervals:
+                if depth < self.max_depth and self._needs_refinement(lo, hi, delta, best):
+                    mid = round(0.5 * (lo + hi), PRECISION)
+                    intervals += [(lo, mid, depth + 1), (mid, hi, depth + 1)]
+                    if mid not in self.results:
+                        pending.append(mid)
+                else:
+                    intervals.append((lo, hi, depth))
+            self._intervals = intervals
+        return dict(sorted(self.results.items()))
+
+
+class AdaptiveScan2D:
+    """
+    Adaptive 2D scan scheduler (quadtree refinement of grid cells).
+
+    Attributes:
+        results: Dict of (x, y) -> NLL (None for failed fits).
+        n_passes: Number of evaluation passes run so far.
+    """
+
+    def __init__(
+        self,
+        range1: Tuple[float, float],
+        coarse1: int,
+        range2: Tuple[float, float],
+        coarse2: int,
+        max_depth: int = 2,
+        levels: Optional[Sequence[float]] = None
+    ):
+        """Initialize scheduler.
+
+        Args:
+            range1: (min, max) of the first POI.
+            coarse1: Points of the initial grid along the first POI.
+            range2: (min, max) of the second POI.
+            coarse2: Points of the initial grid along the second POI.
+            max_depth: Maximum number of times a cell is split.
+            levels: deltaNLL levels to resolve (default: 68% and 95% CL).
+        """
+        self.grid1 = _linspace(max(coarse1, 2), *range1)
+        self.grid2 = _linspace(max(coarse2, 2), *range2)
+        self.max_depth = max_depth
+        self.levels = list(levels) if levels is not None else list(CONTOUR_LEVELS_2D.values())
+        self.results: Dict[Point2D, Optional[float]] = {}
+        self.n_passes = 0
+        # leaf cells (x0, x1, y0, y1, depth)
+        self._cells = [
+            (x0, x1, y0, y1, 0)
+            for x0, x1 in zip(self.grid1[:-1], self.grid1[1:])
+            for y0, y1 in zip(self.grid2[:-1], self.grid2[1:])
+        ]
+
+    def _delta(self) -> Dict[Point2D, Optional[float]]:
+        """deltaNLL of every evaluated point w.r.t. the current minimum."""
+        known = [v for v in self.results.values() if v is not None]
+        nll_min = min(known) if known else 0.0
+        return {p: (v - nll_min if v is not None else None) for p, v in self.results.items()}
+
+    def _needs_refinement(self, cell, delta: Dict[Point2D, Optional[float]], best: Optional[Point2D]) -> bool:
+        """Refine around the minimum and across the contour levels."""
+        x0, x1, y0, y1, _ = cell
+        if best is not None and x0 <= best[0] <= x1 and y0 <= best[1] <= y1:
+            return True
+        corners = [delta.get((x, y)) for x in (x0, x1) for y in (y0, y1)]
+        return _straddles(corners, self.levels)
+
+    def run(self, evaluate: Callable[[List[Point2D]], List[Optional[float]]]) -> Dict[Point2D, Optional[float]]:
+        """Run the scan.
+
+        Args:
+            evaluate: Function fitting a list of (x, y) points and returning their NLL.
+
+        Returns:
+            Dict of (x, y) -> NLL for every point fitted.
+        """
+        pending = [(x, y) for x in self.grid1 for y in self.grid2]
+        while pending:
+            self.n_passes += 1
+            for p, nll in zip(pending, evaluate(pending)):
+                self.results[p] = nll
+
+            delta = self._delta()
+            known = {p: v for p, v in delta.items() if v is not None}
+            best = min(known, key=known.get) if known else None
+            cells, new = [], {}
+            for cell in self._cells:
+                x0, x1, y0, y1, depth = cell
+                if depth < self.max_depth and self._needs_refinement(cell, delta, best):
+                    xm = round(0.5 * (x0 + x1), PRECISION)
+                    ym = round(0.5 * (y0 + y1), PRECISION)
+                    cells += [
+                        (x0, xm, y0, ym, depth + 1), (xm, x1, y0, ym, depth + 1),
+                        (x0, xm, ym, y1, depth + 1), (xm, x1, ym, y1, depth + 1)
+                    ]
+                    for p in [(xm, y0), (xm, y1), (x0, ym), (x1, ym), (xm, ym)]:
+                        if p not in self.results:
+                            new[p] = True
+                else:
+                    cells.append(cell)
+            self._cells = cells
+            pending = list(new)
+        return dict(sorted(self.results.items()))
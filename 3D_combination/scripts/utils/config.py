@@ -22,7 +22,7 @@ Example usage:
 
 import os
 import yaml
-from dataclasses import dataclass, field
+from dataclasses import dataclass, field, replace
 from typing import Dict, List, Optional, Any
 
 
@@ -58,10 +58,34 @@ class WorkspaceConfig:
     data_name: str = "combData"
     model_config: str = "ModelConfig"
     label: str = ""
+    split_path: Optional[str] = None
+    reduced_paths: Dict[str, str] = field(default_factory=dict)
     
     def validate(self) -> bool:
         """Check if the workspace file exists."""
         return os.path.isfile(self.path)
+    
+    def input_file(self) -> str:
+        """File the fit server reads: the split file (splitCombined.C) if it exists."""
+        if self.split_path and os.path.isfile(self.split_path):
+            return self.split_path
+        return self.path
+    
+    def for_systematics(self, systematics: str) -> 'WorkspaceConfig':
+        """Workspace to fit for a systematics configuration.
+        
+        Args:
+            systematics: Systematics configuration (stat_only, full_syst, ...).
+        
+        Returns:
+            A copy pointing to reduced_paths[systematics] (reduceWorkspace.sh,
+            the fixed NPs taken out of the model) if that file exists,
+            otherwise this workspace.
+        """
+        reduced = self.reduced_paths.get(systematics)
+        if reduced and os.path.isfile(reduced):
+            return replace(self, path=reduced, split_path=None, reduced_paths={})
+        return self
 
 
 @dataclass
@@ -124,6 +148,15 @@ class AnalysisConfig:
             'hesse': 0,
             'save_fit_result': 1,
             'save_errors': 1,
+            'eval_backend': 'legacy',
+            'num_cpu': 1,
+            'result_store': 0,
+            'keep_fit_results': 1,
+            'store_nps': '',
+            'fit_cache': '',
+            'profile': 0,
+            'error_workers': 1,
+            'poly_formulas': 0,
         }
         for k, v in defaults.items():
             self.quickfit_defaults.setdefault(k, v)
@@ -167,7 +200,9 @@ class AnalysisConfig:
                     path=ws_data.get('path'),
                     workspace_name=ws_data.get('workspace_name', 'combWS'),
                     data_name=ws_data.get('data_name', 'combData'),
-                    label=label
+                    label=label,
+                    split_path=ws_data.get('split_path'),
+                    reduced_paths=ws_data.get('reduced_paths') or {}
                 )
         
         return cls(
@@ -209,7 +244,9 @@ class AnalysisConfig:
                 label: {
                     'path': ws.path,
                     'workspace_name': ws.workspace_name,
-                    'data_name': ws.data_name
+                    'data_name': ws.data_name,
+                    **({'split_path': ws.split_path} if ws.split_path else {}),
+                    **({'reduced_paths': ws.reduced_paths} if ws.reduced_paths else {})
                 }
                 for label, ws in self.workspaces.items()
             },
@@ -247,6 +284,9 @@ class AnalysisConfig:
             systematics: Which systematics configuration to use.
                 - "full_syst": Use full_syst.fix_nps from config (default)
                 - "stat_only": Use stat_only.fix_nps from config
+                - Any other configuration: its fix_nps, plus the NPs listed in
+                  its fix_nps_file if that file exists (e.g. "pruned", written
+                  by utils/np_pruning.py)
                 - Otherwise: Use self.exclude_nps
         
         Returns:
@@ -259,7 +299,26 @@ class AnalysisConfig:
         if hasattr(self, 'systematics') and self.systematics:
             if systematics in self.systematics and 'fix_nps' in self.systematics[systematics]:
                 patterns.extend(self.systematics[systematics]['fix_nps'])
+            if systematics in self.systematics and self.systematics[systematics].get('fix_nps_file'):
+                patterns.extend(self.read_fix_nps_file(self.systematics[systematics]['fix_nps_file']))
         
         if not patterns:
             return ""
         return ",".join(patterns)
+    
+    def read_fix_nps_file(self, path: str) -> List[str]:
+        """NP patterns of a fix_nps_file, one per line ('#' starts a comment).
+        
+        Args:
+            path: File path, relative to the config file unless absolute.
+        
+        Returns:
+            List of patterns, empty if the file does not exist.
+        """
+        if not os.path.isabs(path) and self.config_path:
+            path = os.path.join(os.path.dirname(self.config_path), path)
+        if not os.path.isfile(path):
+            return []
+        with open(path) as f:
+            lines = [line.split('#', 1)[0].strip() for line in f]
+        return [line for line in lines if line]
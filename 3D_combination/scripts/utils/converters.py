@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+"""
+Convert scan results to the text format of RooFitUtils plotscan.py.
+
+Reads the result store of a scan directory (utils/scan_store.py) or, for
+scans without one, its per-point fit_*.root files, and writes one line per
+point sorted by the POI values:
+    1D: <poi> nll status
+    2D: <poi> <poi2> nll status
+
+Example usage:
+    python3 -m utils.converters --indir root_<tag> --out txt_<tag>/<tag>_nllscan.txt --poi cHWtil_combine
+"""
+
+import argparse
+import os
+import sys
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from utils.scan_store import read_scan
+
+
+def convert(indirs, output, poi, poi2=None, pattern='fit_*.root') -> int:
+    """Write the points of one or more scan directories to a text file.
+
+    Args:
+        indirs: Scan directories (or store files), merged into one output.
+        output: Output text file.
+        poi: Scanned POI.
+        poi2: Second scanned POI for 2D scans.
+        pattern: Per-point file pattern for directories without a store.
+
+    Returns:
+        Number of points written.
+    """
+    pois = [poi] + ([poi2] if poi2 else [])
+    rows = []
+    for indir in indirs:
+        data = read_scan(indir, pois + ['nll', 'status'], pattern=pattern)
+        if not data or any(p not in data for p in pois + ['nll']):
+            print(f"Warning: no {', '.join(pois)} scan points in {indir}", file=sys.stderr)
+            continue
+        status = data.get('status')
+        for i in range(len(data['nll'])):
+            rows.append(tuple(float(data[p][i]) for p in pois)
+                        + (float(data['nll'][i]), int(status[i]) if status is not None else 0))
+
+    # a point fitted more than once (retries, overlapping inputs) keeps its best fit
+    best = {}
+    for row in rows:
+        key = tuple(round(v, 8) for v in row[:len(pois)])
+        if key not in best or (row[-1] != 0, row[-2]) < (best[key][-1] != 0, best[key][-2]):
+            best[key] = row
+
+    os.makedirs(os.path.dirname(output) or '.', exist_ok=True)
+    with open(output, 'w') as f:
+        f.write('   '.join(pois + ['nll', 'status']) + '\n')
+        for row in sorted(best.values()):
+            f.write('  '.join(f"{v:.6f}" for v in row[:-1]) + f"  {row[-1]}\n")
+    return len(best)
+
+
+def main():
+    """CLI interface for scan conversion."""
+    parser = argparse.ArgumentParser(description="Convert scan results to plotscan text format.")
+    parser.add_argument('--indir', required=True, nargs='+', help='Scan directories or store files')
+    parser.add_argument('--out', required=True, help='Output text file')
+    parser.add_argument('--poi', required=True, help='Scanned POI')
+    parser.add_argument('--poi2', help='Second scanned POI (2D scans)')
+    parser.add_argument('--pattern', default='fit_*.root',
+                       help='Per-point file pattern for directories without a store')
+    args = parser.parse_args()
+
+    n = convert(args.indir, args.out, args.poi, args.poi2, args.pattern)
+    if n == 0:
+        print("ERROR: no scan points found", file=sys.stderr)
+        sys.exit(1)
+    print(f"Created: {args.out} ({n} points)")
+
+
+if __name__ == '__main__':
+    main()
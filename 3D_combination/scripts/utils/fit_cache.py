@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""
+Content-addressed cache of fit results.
+
+A fit is identified by the content of its workspace file, the workspace,
+ModelConfig and dataset names, its POI string (items sorted by name), the
+-n NP pattern and the minimizer options of the engine that runs it. The
+cached value is the fit output file, in the quickFit/fit server format
+(fitResult and a one-entry nllscan tree):
+
+    <cache_dir>/<key[:2]>/<key>.root     one converged fit
+    <cache_dir>/workspaces.json          content hashes of the workspace files,
+                                         by path, size and modification time
+
+Only converged fits are cached, and the starting values of a fit (seeds,
+warm starts) are not part of the key: the cache assumes that the minimum
+does not depend on them. A refit of a point with identical inputs, e.g. a scan
+rerun after a plotting fix or a 1D point on a line of a 2D grid, takes the
+file from the cache instead. quickFit runs are looked up by the runner; the
+fit server looks up its own requests (CACHE lines, see fit_server/fitServer.C),
+so that cached points still reach the scan store.
+
+Example usage:
+    from utils.fit_cache import FitCache
+
+    cache = FitCache.from_config(config)
+    key = cache.key(ws, poi_string, exclude_nps, {'engine': 'quickFit', 'min_tolerance': 1e-4})
+    if not cache.fetch(key, output_file):
+        ...  # fit, then
+        cache.put(key, output_file)
+
+    python3 utils/fit_cache.py --dir <cache_dir> --put <key> fit.root
+"""
+
+import argparse
+import hashlib
+import json
+import os
+import shutil
+import sys
+from typing import Any, Dict, Optional
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from utils.config import AnalysisConfig, WorkspaceConfig
+
+HASH_BLOCK = 1 << 24
+
+
+def normalize_pois(poi_string: str) -> str:
+    """POI string with its items sorted by name, so that the order does not matter."""
+    items = [item.strip() for item in poi_string.split(',') if item.strip()]
+    return ','.join(sorted(items, key=lambda item: item.partition('=')[0]))
+
+
+class FitCache:
+    """
+    Fit results stored under the hash of their inputs.
+
+    Attributes:
+        cache_dir: Directory of the cache.
+    """
+
+    def __init__(self, cache_dir: str):
+        """Initialize a cache in cache_dir (created if needed)."""
+        self.cache_dir = os.path.abspath(cache_dir)
+        os.makedirs(self.cache_dir, exist_ok=True)
+        self._ws_hashes: Dict[str, str] = {}
+
+    @classmethod
+    def from_config(cls, config: AnalysisConfig) -> Optional['FitCache']:
+        """Cache configured by quickfit_defaults.fit_cache, None if disabled.
+
+        A relative directory is taken relative to the configuration file.
+        """
+        cache_dir = config.quickfit_defaults.get('fit_cache', '')
+        if not cache_dir:
+            return None
+        if not os.path.isabs(cache_dir) and config.config_path:
+            cache_dir = os.path.join(os.path.dirname(config.config_path), cache_dir)
+        return cls(cache_dir)
+
+    def path(self, key: str) -> str:
+        """Cache file of a key."""
+        return os.path.join(self.cache_dir, key[:2], f"{key}.root")
+
+    def workspace_hash(self, path: str) -> str:
+        """SHA-256 of a workspace file, computed once per file version."""
+        path = os.path.realpath(path)
+        stat = os.stat(path)
+        version = f"{path}:{stat.st_size}:{stat.st_mtime_ns}"
+        if version in self._ws_hashes:
+            return self._ws_hashes[version]
+        index_path = os.path.join(self.cache_dir, 'workspaces.json')
+        try:
+            with open(index_path) as f:
+                index = json.load(f)
+        except (OSError, ValueError):
+            index = {}
+        if version not in index:
+            digest = hashlib.sha256()
+            with open(path, 'rb') as f:
+                for block in iter(lambda: f.read(HASH_BLOCK), b''):
+                    digest.update(block)
+            index[version] = digest.hexdigest()
+            # written aside and renamed, concurrent jobs at worst hash the file again
+            tmp = f"{index_path}.{os.getpid()}.tmp"
+            with open(tmp, 'w') as f:
+                json.dump(index, f, indent=1, sort_keys=True)
+            os.replace(tmp, index_path)
+        self._ws_hashes[version] = index[version]
+        return index[version]
+
+    def key(
+        self,
+        ws: WorkspaceConfig,
+        poi_string: str,
+        exclude_nps: str,
+        options: Dict[str, Any],
+        input_file: Optional[str] = None
+    ) -> str:
+        """Key of one fit.
+
+        Args:
+            ws: Workspace configuration.
+            poi_string: quickFit -p style POI string.
+            exclude_nps: quickFit -n pattern.
+            options: Engine and minimizer options that change the result.
+            input_file: File the fit reads (default: ws.path).
+
+        Returns:
+            Hex digest identifying the fit.
+        """
+        inputs = {
+            'workspace': self.workspace_hash(input_file or ws.path),
+            'names': [ws.workspace_name, ws.model_config, ws.data_name],
+            'pois': normalize_pois(poi_string),
+            'exclude_nps': exclude_nps,
+            'options': options
+        }
+        return hashlib.sha256(json.dumps(inputs, sort_keys=True).encode()).hexdigest()
+
+    def fetch(self, key: str, output_file: str) -> bool:
+        """Copy the cached result of key to output_file.
+
+        Returns:
+            True on a cache hit.
+        """
+        cached = self.path(key)
+        if not os.path.isfile(cached) or os.path.getsize(cached) == 0:
+            return False
+        os.makedirs(os.path.dirname(os.path.abspath(output_file)), exist_ok=True)
+        shutil.copyfile(cached, output_file)
+        return True
+
+    def put(self, key: str, fit_file: str) -> bool:
+        """Store the output file of a fit if it converged.
+
+        Returns:
+            True if the result was stored.
+        """
+        if not os.path.isfile(fit_file) or fit_status(fit_file) != 0:
+            return False
+        cached = self.path(key)
+        os.makedirs(os.path.dirname(cached), exist_ok=True)
+        tmp = f"{cached}.{os.getpid()}.tmp"
+        shutil.copyfile(fit_file, tmp)
+        os.replace(tmp, cached)
+        return True
+
+
+def fit_status(fit_file: str) -> Optional[int]:
+    """Minimizer status of a fit output file, None if unreadable."""
+    try:
+        import ROOT
+        ROOT.PyConfig.IgnoreCommandLineOptions = True
+    except ImportError:
+        raise ImportError("ROOT module not found. Please source your analysis setup.")
+    f = ROOT.TFile.Open(fit_file)
+    if not f or f.IsZombie():
+        return None
+    try:
+        result = f.Get("fitResult")
+        if result:
+            return int(result.status())
+        tree = f.Get("nllscan")
+        if tree and tree.GetEntries() > 0 and tree.GetBranch("status"):
+            tree.GetEntry(0)
+            return int(tree.status)
+        return None
+    finally:
+        f.Close()
+
+
+def main():
+    """CLI interface, used by the Condor job wrappers."""
+    parser = argparse.ArgumentParser(description="Content-addressed fit result cache.")
+    parser.add_argument('--dir', required=True, help='Cache directory')
+    parser.add_argument('--put', nargs=2, metavar=('KEY', 'FILE'), help='Store a fit output file')
+    parser.add_argument('--fetch', nargs=2, metavar=('KEY', 'FILE'), help='Copy a cached result to FILE')
+    args = parser.parse_args()
+
+    cache = FitCache(args.dir)
+    if args.put:
+        stored = cache.put(*args.put)
+        print(f"{'Cached' if stored else 'Not cached (no converged fit)'}: {args.put[1]}")
+    elif args.fetch:
+        if not cache.fetch(*args.fetch):
+            print(f"No cached result for {args.fetch[0]}", file=sys.stderr)
+            sys.exit(1)
+    else:
+        parser.print_help()
+
+
+if __name__ == '__main__':
+    main()
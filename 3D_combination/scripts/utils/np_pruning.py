@@ -0,0 +1,332 @@
+#!/usr/bin/env python3
+"""
+Pruning of the nuisance parameters with a negligible impact on the POIs.
+
+The impact of an NP on a POI is approximated from the covariance matrix of a
+single unconditional fit with HESSE, instead of one pair of conditional fits
+per NP as in a full ranking: moving the NP by its post-fit error shifts the
+POI by cov(POI, NP) / sigma(NP), i.e. by the correlation times sigma(POI).
+
+NPs whose relative impact (the largest |correlation| with any POI) is below
+the threshold are candidates. Starting from the least important one, each is
+accepted if fixing all accepted NPs at the value the fit starts from keeps
+the predicted change of every POI within the limits: the linearized shift of
+the best fit, C_pS C_SS^-1 (theta_S - theta_S,init), in units of sigma(POI),
+and the relative reduction of sigma(POI) given by the conditional
+covariance C_pp - C_pS C_SS^-1 C_Sp. Many small NPs can together matter even
+if each is negligible; the limits bound that.
+
+rank writes
+    <output>.json            ranking, pruned NPs and the predicted POI changes
+    <output>_fix_nps.txt     pruned NPs, one per line
+The list is the fix_nps_file of the 'pruned' systematics configuration of
+the scan config, so every fit with --systematics pruned fixes them (quickFit
+-n, fit server), and reduceWorkspace.sh --systematics pruned writes the
+pruned workspace. validate compares a pruned fit with the full one.
+
+Example usage:
+    # full_syst fit with HESSE
+    python3 quickfit/runner.py --config configs/hvv_cp_combination.yaml --scan-type fit \\
+        --workspace linear_obs --hesse --output-dir output/np_pruning --tag linear_obs_full
+    python3 utils/np_pruning.py rank output/np_pruning/linear_obs_full.root --output output/np_pruning/linear_obs
+    # the same fit with the pruned NPs fixed
+    python3 quickfit/runner.py --config configs/hvv_cp_combination.yaml --scan-type fit \\
+        --workspace linear_obs --hesse --systematics pruned --output-dir output/np_pruning --tag linear_obs_pruned
+    python3 utils/np_pruning.py validate output/np_pruning/linear_obs_full.root \\
+        output/np_pruning/linear_obs_pruned.root --report output/np_pruning/linear_obs.json
+"""
+
+import argparse
+import json
+import math
+import os
+import sys
+from dataclasses import dataclass
+from typing import Dict, List, Optional
+
+# Add parent directory to path for imports
+sys.path.insert(0, os.path.dirname(os.path.dirname(os.path.abspath(__file__))))
+
+from utils.config import AnalysisConfig
+
+# Conditional variance (relative to the variance) below which an NP is
+# determined by the NPs already pruned
+DEGENERATE = 1e-10
+
+
+@dataclass
+class FitCovariance:
+    """Floating parameters of one fit with their covariance matrix."""
+    names: List[str]
+    values: List[float]
+    init: List[float]
+    cov: List[List[float]]
+
+    def index(self) -> Dict[str, int]:
+        """Parameter name to row of cov."""
+        return {name: i for i, name in enumerate(self.names)}
+
+    def error(self, i: int) -> float:
+        """Hesse error of parameter i."""
+        return math.sqrt(max(self.cov[i][i], 0.0))
+
+
+def read_fit(filepath: str) -> FitCovariance:
+    """Floating parameters and covariance of the RooFitResult of a fit output.
+
+    Args:
+        filepath: quickFit (or fit server) output with --savefitresult 1.
+
+    Returns:
+        FitCovariance in the order of floatParsFinal.
+    """
+    from utils.fit_result_parser import FitResultParser
+    import ROOT
+
+    tfile = ROOT.TFile.Open(filepath)
+    if not tfile or tfile.IsZombie():
+        raise OSError(f"Cannot open {filepath}")
+    result = FitResultParser()._find_fit_result(tfile)
+    if not result:
+        tfile.Close()
+        raise ValueError(f"No RooFitResult in {filepath}")
+    if result.covQual() < 3:
+        print(f"Warning: covariance quality {result.covQual()} in {filepath}", file=sys.stderr)
+    final, init = result.floatParsFinal(), result.floatParsInit()
+    n = final.getSize()
+    matrix = result.covarianceMatrix()
+    fit = FitCovariance(
+        names=[final.at(i).GetName() for i in range(n)],
+        values=[final.at(i).getVal() for i in range(n)],
+        init=[init.find(final.at(i).GetName()).getVal() for i in range(n)],
+        cov=[[matrix(i, j) for j in range(n)] for i in range(n)],
+    )
+    tfile.Close()
+    return fit
+
+
+def impacts(fit: FitCovariance, pois: List[str], nps: List[str]) -> Dict[str, Dict[str, float]]:
+    """Approximate impact of each NP on each POI.
+
+    Args:
+        fit: Full fit.
+        pois: POI names.
+        nps: NP names.
+
+    Returns:
+        Dict NP -> {POI: shift of the POI for a post-fit 1 sigma move of the NP}.
+    """
+    idx = fit.index()
+    result = {}
+    for np_name in nps:
+        j = idx[np_name]
+        err = fit.error(j)
+        result[np_name] = {poi: fit.cov[idx[poi]][j] / err if err > 0 else 0.0 for poi in pois}
+    return result
+
+
+def prune(fit: FitCovariance, pois: List[str], nps: List[str], threshold: float,
+          max_shift: float, max_error_change: float) -> Dict:
+    """Select the NPs to fix and predict the POI changes.
+
+    The conditional covariance is updated one accepted NP at a time from an
+    incremental Cholesky factor of C_SS, so the selection costs O(N^2) per
+    candidate.
+
+    Args:
+        fit: Full fit.
+        pois: POI names.
+        nps: Candidate NP names (floating parameters that are not POIs).
+        threshold: Relative impact (|impact| / sigma(POI)) below which an NP is a candidate.
+        max_shift: Largest predicted best-fit shift of a POI, in units of its error.
+        max_error_change: Largest predicted relative reduction of a POI error.
+
+    Returns:
+        Dict with 'nps' (ranking, most important first: name, value, init,
+        error, impact, relative, pruned, reason), 'pruned' (names) and
+        'pois' {POI: value, error, predicted_value, predicted_error,
+        shift_sigma, error_change}.
+    """
+    idx = fit.index()
+    p_idx = [idx[p] for p in pois]
+    sigma = [fit.error(i) for i in p_idx]
+    imp = impacts(fit, pois, nps)
+    relative = {n: max((abs(imp[n][p]) / s if s > 0 else 0.0) for p, s in zip(pois, sigma)) for n in nps}
+
+    rows_l: List[List[float]] = []   # Cholesky factor of C_SS, row r has r + 1 entries
+    rows_w: List[List[float]] = []   # L^-1 C_Sp
+    rows_d: List[float] = []         # L^-1 (theta_S - theta_S,init)
+    accepted: List[int] = []
+    var_drop = [0.0] * len(pois)
+    shift = [0.0] * len(pois)
+    reason = {}
+    for name in sorted(nps, key=lambda n: relative[n]):
+        if relative[name] >= threshold:
+            reason[name] = 'impact'
+            continue
+        j = idx[name]
+        l_row = []
+        for r, s in enumerate(accepted):
+            l_row.append((fit.cov[s][j] - sum(l_row[c] * rows_l[r][c] for c in range(r))) / rows_l[r][r])
+        diag = fit.cov[j][j] - sum(v * v for v in l_row)
+        if diag <= DEGENERATE * fit.cov[j][j]:
+            reason[name] = 'degenerate'
+            continue
+        l_jj = math.sqrt(diag)
+        w_row = [(fit.cov[j][p] - sum(l_row[r] * rows_w[r][k] for r in range(len(accepted)))) / l_jj
+                 for k, p in enumerate(p_idx)]
+        d_row = (fit.values[j] - fit.init[j] - sum(l_row[r] * rows_d[r] for r in range(len(accepted)))) / l_jj
+        new_drop = [var_drop[k] + w_row[k] ** 2 for k in range(len(pois))]
+        new_shift = [shift[k] - w_row[k] * d_row for k in range(len(pois))]
+        too_far = any(abs(new_shift[k]) > max_shift * sigma[k] for k in range(len(pois)))
+        too_tight = any(1.0 - math.sqrt(max(sigma[k] ** 2 - new_drop[k], 0.0)) / sigma[k] > max_error_change
+                        for k in range(len(pois)) if sigma[k] > 0)
+        if too_far or too_tight:
+            reason[name] = 'shift' if too_far else 'error'
+            continue
+        rows_l.append(l_row + [l_jj])
+        rows_w.append(w_row)
+        rows_d.append(d_row)
+        accepted.append(j)
+        var_drop, shift = new_drop, new_shift
+        reason[name] = None
+
+    pruned = [fit.names[j] for j in accepted]
+    ranking = []
+    for name in sorted(nps, key=lambda n: -relative[n]):
+        j = idx[name]
+        ranking.append({'name': name, 'value': fit.values[j], 'init': fit.init[j], 'error': fit.error(j),
+                        'impact': imp[name], 'relative': relative[name], 'pruned': reason[name] is None,
+                        'reason': reason[name]})
+    poi_info = {}
+    for k, poi in enumerate(pois):
+        error = math.sqrt(max(sigma[k] ** 2 - var_drop[k], 0.0))
+        poi_info[poi] = {'value': fit.values[p_idx[k]], 'error': sigma[k],
+                         'predicted_value': fit.values[p_idx[k]] + shift[k], 'predicted_error': error,
+                         'shift_sigma': shift[k] / sigma[k] if sigma[k] > 0 else 0.0,
+                         'error_change': error / sigma[k] - 1.0 if sigma[k] > 0 else 0.0}
+    return {'nps': ranking, 'pruned': sorted(pruned), 'pois': poi_info}
+
+
+def validate(full: FitCovariance, pruned: FitCovariance, pois: List[str]) -> Dict:
+    """Best-fit shifts and error changes of the POIs between two fits.
+
+    Args:
+        full: Fit with all NPs floating.
+        pruned: Fit with the pruned NPs fixed.
+        pois: POI names.
+
+    Returns:
+        Dict with 'floating' {full, pruned} and 'pois' {POI: value, error,
+        pruned_value, pruned_error, shift_sigma, error_change}.
+    """
+    f_idx, p_idx = full.index(), pruned.index()
+    result = {'floating': {'full': len(full.names), 'pruned': len(pruned.names)}, 'pois': {}}
+    for poi in pois:
+        i, j = f_idx[poi], p_idx[poi]
+        err, err_p = full.error(i), pruned.error(j)
+        result['pois'][poi] = {'value': full.values[i], 'error': err,
+                               'pruned_value': pruned.values[j], 'pruned_error': err_p,
+                               'shift_sigma': (pruned.values[j] - full.values[i]) / err if err > 0 else 0.0,
+                               'error_change': err_p / err - 1.0 if err > 0 else 0.0}
+    return result
+
+
+def _print_pois(pois: Dict, value_key: str, error_key: str) -> None:
+    """Print the POI table of a rank or validate result."""
+    print(f"  {'POI':<20s} {'value':>11s} {'error':>10s} {value_key:>11s} {error_key:>10s} {'shift':>8s} {'error':>8s}")
+    for poi, r in pois.items():
+        print(f"  {poi:<20s} {r['value']:11.5f} {r['error']:10.5f} {r[value_key]:11.5f} {r[error_key]:10.5f} "
+              f"{r['shift_sigma']:+7.3f}s {100.0 * r['error_change']:+7.2f}%")
+
+
+def main():
+    """CLI interface."""
+    parser = argparse.ArgumentParser(description="Hessian-based pruning of negligible nuisance parameters.")
+    parser.add_argument('--config', default=os.path.join(os.path.dirname(os.path.dirname(os.path.abspath(__file__))),
+                                                         'configs', 'hvv_cp_combination.yaml'),
+                        help='Scan config (POIs and floating POIs)')
+    parser.add_argument('--pois', help='Comma-separated POIs (default: scan_pois of the config)')
+    sub = parser.add_subparsers(dest='command', required=True)
+    rank = sub.add_parser('rank', help='Rank the NPs of a fit and write the pruned list')
+    rank.add_argument('fit', help='Fit output with HESSE and the fit result')
+    rank.add_argument('--output', required=True, help='Output prefix (<output>.json, <output>_fix_nps.txt)')
+    rank.add_argument('--threshold', type=float, default=0.01,
+                      help='Relative impact below which an NP is pruned (default: 0.01)')
+    rank.add_argument('--max-shift', type=float, default=0.05,
+                      help='Largest predicted POI shift in units of its error (default: 0.05)')
+    rank.add_argument('--max-error-change', type=float, default=0.01,
+                      help='Largest predicted relative reduction of a POI error (default: 0.01)')
+    rank.add_argument('--top', type=int, default=20, help='Number of NPs of the ranking printed')
+    check = sub.add_parser('validate', help='Compare a pruned fit with the full fit')
+    check.add_argument('full', help='Fit output with all NPs floating')
+    check.add_argument('pruned', help='Fit output with the pruned NPs fixed')
+    check.add_argument('--report', help='rank output (<output>.json) with the predicted changes')
+    check.add_argument('--max-shift', type=float, default=0.1,
+                       help='Exit with 1 above this POI shift in units of its error (default: 0.1)')
+    check.add_argument('--max-error-change', type=float, default=0.02,
+                       help='Exit with 1 above this relative change of a POI error (default: 0.02)')
+    check.add_argument('--json', help='Write the comparison to this file')
+    args = parser.parse_args()
+
+    config = AnalysisConfig.from_yaml(args.config)
+    pois = args.pois.split(',') if args.pois else list(config.scan_pois)
+
+    if args.command == 'rank':
+        fit = read_fit(args.fit)
+        missing = [p for p in pois if p not in fit.names]
+        if missing:
+            parser.error(f"POIs not floating in {args.fit}: {missing}")
+        other_pois = set(pois) | set(config.float_pois) | set(config.individual_wilson_coeffs)
+        nps = [n for n in fit.names if n not in other_pois]
+        result = prune(fit, pois, nps, args.threshold, args.max_shift, args.max_error_change)
+        result.update({'fit': os.path.abspath(args.fit), 'threshold': args.threshold,
+                       'max_shift': args.max_shift, 'max_error_change': args.max_error_change})
+        os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+        with open(args.output + '.json', 'w') as f:
+            json.dump(result, f, indent=1)
+        with open(args.output + '_fix_nps.txt', 'w') as f:
+            f.write(f"# {len(result['pruned'])} of {len(nps)} NPs pruned from {args.fit}\n")
+            f.write(f"# threshold {args.threshold}, max shift {args.max_shift}, "
+                    f"max error change {args.max_error_change} (utils/np_pruning.py)\n")
+            f.writelines(name + '\n' for name in result['pruned'])
+
+        print(f"{len(nps)} NPs, {len(result['pruned'])} pruned "
+              f"({sum(r['reason'] == 'impact' for r in result['nps'])} above the threshold, "
+              f"{sum(r['reason'] in ('shift', 'error') for r in result['nps'])} kept by the limits)")
+        print(f"  {'NP':<48s} " + " ".join(f"{p:>16s}" for p in pois) + f" {'relative':>9s}")
+        for r in result['nps'][:args.top]:
+            print(f"  {r['name']:<48s} " + " ".join(f"{r['impact'][p]:+16.5f}" for p in pois)
+                  + f" {r['relative']:9.4f}")
+        print("Predicted with the pruned NPs fixed:")
+        _print_pois(result['pois'], 'predicted_value', 'predicted_error')
+        print(f"Written {args.output}.json and {args.output}_fix_nps.txt")
+    else:
+        full, pruned = read_fit(args.full), read_fit(args.pruned)
+        result = validate(full, pruned, pois)
+        if args.report:
+            with open(args.report) as f:
+                report = json.load(f)
+            for poi, r in result['pois'].items():
+                if poi in report.get('pois', {}):
+                    r['predicted_shift_sigma'] = report['pois'][poi]['shift_sigma']
+                    r['predicted_error_change'] = report['pois'][poi]['error_change']
+        print(f"Floating parameters: {result['floating']['full']} full, {result['floating']['pruned']} pruned")
+        _print_pois(result['pois'], 'pruned_value', 'pruned_error')
+        if args.report:
+            for poi, r in result['pois'].items():
+                if 'predicted_shift_sigma' in r:
+                    print(f"  {poi:<20s} predicted {r['predicted_shift_sigma']:+7.3f}s "
+                          f"{100.0 * r['predicted_error_change']:+7.2f}%")
+        if args.json:
+            with open(args.json, 'w') as f:
+                json.dump(result, f, indent=1)
+        bad = [poi for poi, r in result['pois'].items()
+               if abs(r['shift_sigma']) > args.max_shift or abs(r['error_change']) > args.max_error_change]
+        if bad:
+            print(f"Pruned fit differs beyond the limits for {bad}", file=sys.stderr)
+            sys.exit(1)
+
+
+if __name__ == '__main__':
+    main()
@@ -22,7 +22,8 @@ Example usage:
     # For a 3POI fit
     poi_str = builder.build_fit()
     
-    # With previous results for sequential scanning
+    # With previous results for sequential scanning, e.g. the values predicted
+    # from the points fitted so far (utils/seed_model.py)
     poi_str = builder.build_1d_scan("cHWtil_combine", 0.5, previous_results=prev_dict)
 """
 
@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+Summary of the profiling reports of the splitter and the fit server.
+
+With profiling enabled (quickfit_defaults profile: 1 for the fit server, always
+for the splitter) every output file gets a JSON report next to it:
+
+    <output>.profile.json    fit_*.root of one fit server request, the scan
+                             store (sums over the server session), or the
+                             split workspace of the splitter
+
+A report holds the wall time per phase (load, nll, migrad, hesse, output,
+... for the fit server; load, split, fill, import, write for the splitter),
+the minimizer call counts, and per category the estimated NLL evaluations and
+time (fit server, est_evals and est_seconds: the calls in which a parameter of
+the category moved, times a separate timing of one evaluation, see
+categoriesMethod in the report) or the entries and the measured time spent on
+it (splitter). This
+script sums the reports found below a directory, so that the expensive
+phases and categories of a scan stand out before optimizing anything.
+
+Example usage:
+    python3 utils/profile_report.py output/root_linear_obs_2D
+    python3 utils/profile_report.py output/root_linear_obs_2D --top 10
+"""
+
+import argparse
+import glob
+import json
+import os
+import sys
+from typing import Dict, List, Optional
+
+SUFFIX = '.profile.json'
+
+
+def find_reports(paths: List[str]) -> List[str]:
+    """Report files given directly or found recursively below directories."""
+    found = []
+    for path in paths:
+        if os.path.isdir(path):
+            found += glob.glob(os.path.join(path, '**', '*' + SUFFIX), recursive=True)
+        elif path.endswith(SUFFIX):
+            found.append(path)
+    return sorted(set(found))
+
+
+def kind(report: Dict) -> str:
+    """'splitter', 'session' (fit server store) or 'fit' (one fit server request)."""
+    if report.get('tool') == 'splitter':
+        return 'splitter'
+    return 'session' if 'store' in report else 'fit'
+
+
+def summarize(reports: List[Dict]) -> Dict:
+    """Sum phases, minimizer calls and categories of reports of one kind.
+
+    Returns:
+        Dict with 'reports', 'phases' {name: s}, 'minimizer' {name: calls},
+        'fits', 'cached' and 'categories' {name: {seconds, ...}} (splitter) or
+        {name: {est_evals, est_seconds, ...}} (fit server); the estimates are
+        None if a report did not count them (codegen).
+    """
+    total = {'reports': len(reports), 'phases': {}, 'minimizer': {}, 'fits': 0, 'cached': 0, 'categories': {}}
+    for rep in reports:
+        for name, sec in rep.get('phases', {}).items():
+            total['phases'][name] = total['phases'].get(name, 0.0) + (sec or 0.0)
+        for name, calls in rep.get('minimizer', {}).items():
+            total['minimizer'][name] = total['minimizer'].get(name, 0) + (calls or 0)
+        if kind(rep) == 'fit':
+            total['fits'] += 1
+            total['cached'] += bool(rep.get('cached'))
+        else:
+            total['fits'] += rep.get('fits', 0)
+            total['cached'] += rep.get('cached', 0)
+        for cat in rep.get('categories', []):
+            entry = total['categories'].setdefault(cat['name'], {})
+            for key, val in cat.items():
+                if key in ('name', 'mode', 'parameters', 'secondsPerEval'):
+                    entry[key] = val
+                elif key == 'phases':
+                    entry['seconds'] = (entry.get('seconds') or 0.0) + sum(v or 0.0 for v in val.values())
+                elif isinstance(val, (int, float)) and not isinstance(val, bool):
+                    entry[key] = (entry.get(key) or 0) + val
+                else:
+                    entry.setdefault(key, None)
+    return total
+
+
+def _seconds(cat: Dict) -> Optional[float]:
+    """Measured (splitter) or estimated (fit server) time of a category."""
+    return cat['est_seconds'] if 'est_seconds' in cat else cat.get('seconds')
+
+
+def _print_summary(title: str, total: Dict, top: Optional[int]) -> None:
+    """Print one summary table."""
+    print(f"{title}: {total['reports']} reports")
+    if total['fits']:
+        print(f"  fits: {total['fits']} ({total['cached']} from the cache)")
+    wall = sum(total['phases'].values())
+    print("  phases:")
+    for name, sec in sorted(total['phases'].items(), key=lambda kv: -kv[1]):
+        print(f"    {name:<16s} {sec:12.2f} s  {100.0 * sec / wall if wall else 0.0:5.1f} %")
+    if total['minimizer']:
+        print("  minimizer: " + ", ".join(f"{name} {calls}" for name, calls in total['minimizer'].items()))
+    cats = sorted(total['categories'].items(), key=lambda kv: -(_seconds(kv[1]) or 0.0))
+    if not cats:
+        return
+    estimated = any('est_seconds' in cat for _, cat in cats)
+    print("  categories (estimated):" if estimated else "  categories:")
+    for name, cat in cats[:top]:
+        sec = _seconds(cat)
+        cols = [f"{'-' if sec is None else f'{sec:.2f}':>10s} s"]
+        if 'est_evals' in cat:
+            cols.append(f"{'-' if cat['est_evals'] is None else cat['est_evals']:>10} evals")
+        if cat.get('secondsPerEval') is not None:
+            cols.append(f"{1e3 * cat['secondsPerEval']:9.3f} ms/eval")
+        if cat.get('mode'):
+            cols.append(f"{cat['mode']:>9s} {cat.get('numEntries', 0):>10} entries")
+        print(f"    {name:<40s} " + "  ".join(cols))
+    if top is not None and len(cats) > top:
+        print(f"    ... {len(cats) - top} more")
+
+
+def main():
+    """CLI interface."""
+    parser = argparse.ArgumentParser(description="Sum the *.profile.json reports of a scan or workspace.")
+    parser.add_argument('paths', nargs='+', help='Report files or directories searched recursively')
+    parser.add_argument('--top', type=int, default=None, help='Number of categories shown')
+    parser.add_argument('--json', action='store_true', help='Print the sums as JSON')
+    args = parser.parse_args()
+
+    groups: Dict[str, List[Dict]] = {}
+    for path in find_reports(args.paths):
+        try:
+            with open(path) as f:
+                rep = json.load(f)
+        except (OSError, ValueError) as e:
+            print(f"Skipping {path}: {e}", file=sys.stderr)
+            continue
+        groups.setdefault(kind(rep), []).append(rep)
+    if not groups:
+        print("No profile reports found", file=sys.stderr)
+        sys.exit(1)
+
+    totals = {k: summarize(v) for k, v in groups.items()}
+    if args.json:
+        print(json.dumps(totals, indent=1))
+        return
+    titles = {'splitter': 'Splitter', 'session': 'Fit server sessions', 'fit': 'Fit server requests'}
+    for k in ('splitter', 'session', 'fit'):
+        if k in totals:
+            _print_summary(titles[k], totals[k], args.top)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""
+Columnar scan-result store.
+
+A scan run on the fit server writes one row per point to the "nllscan" tree
+of a single store file instead of one fit_*.root file per point (see
+fit_server/fitServer.C): nll, status, time, calls, every POI and the
+selected NPs. The full RooFitResult files are only written on request.
+
+    <root_dir>/scan.root                  store of a scan run by one server
+    <root_dir>/scan_part_<name>.root      store of one worker or Condor job,
+                                          until merged into scan.root
+
+The tree has the same name and POI/nll branches as the per-point quickFit
+outputs, so a store file opens wherever a single nllscan file did; this
+module reads the whole scan in one go with RDataFrame. Servers running HESSE
+also store the POI correlations of every row, corr__<poi1>__<poi2>
+(correlation() rebuilds the matrix).
+
+Example usage:
+    from utils.scan_store import read_scan
+
+    data = read_scan("root_linear_obs_cHWtil_combine_cHBtil_combine")
+    # Returns: {"cHWtil_combine": array([...]), "nll": array([...]), ...}
+
+    python3 -m utils.scan_store --merge root_<tag>
+"""
+
+import argparse
+import glob
+import os
+import socket
+import subprocess
+import sys
+import time
+from typing import Dict, List, Optional
+
+STORE_NAME = 'scan.root'
+PART_PATTERN = 'scan_part_*.root'
+TREE_NAME = 'nllscan'
+CORR_PREFIX = 'corr__'
+
+
+def part_path(root_dir: str, name: str) -> str:
+    """Store file of one worker or job of a scan."""
+    return os.path.join(root_dir, f"scan_part_{name}.root")
+
+
+def new_part(root_dir: str, label: str) -> str:
+    """Fresh part file for one fit server, unique across hosts and restarts."""
+    host = socket.gethostname().split('.')[0]
+    return part_path(root_dir, f"{label}_{host}_{os.getpid()}_{int(time.time())}")
+
+
+def store_files(root_dir: str) -> List[str]:
+    """Store files of a scan: scan.root and the parts not merged yet."""
+    files = glob.glob(os.path.join(root_dir, STORE_NAME)) + sorted(glob.glob(os.path.join(root_dir, PART_PATTERN)))
+    return [f for f in files if os.path.getsize(f) > 0]
+
+
+def read_scan(
+    path: str,
+    columns: Optional[List[str]] = None,
+    keys: Optional[List[str]] = None,
+    pattern: str = 'fit_*.root'
+) -> Dict[str, 'np.ndarray']:
+    """Read all points of a scan.
+
+    Args:
+        path: Store file, or scan directory. A directory without store files
+              is read from its per-point files (pattern) instead.
+        columns: Branches to read (default: all); missing ones are skipped.
+        keys: Branches identifying a point (e.g. the scanned POIs). If given,
+              a point fitted more than once (retries) is kept once: the
+              converged row with the lowest nll, else the lowest nll.
+        pattern: Per-point file pattern for directories without a store.
+
+    Returns:
+        Dict mapping branch names to arrays, one entry per point.
+    """
+    # imported here: the scan runners only write and merge stores
+    try:
+        import ROOT
+        ROOT.PyConfig.IgnoreCommandLineOptions = True
+    except ImportError:
+        raise ImportError("ROOT module not found. Please source your analysis setup.")
+    import numpy as np
+    if os.path.isdir(path):
+        files = store_files(path) or sorted(glob.glob(os.path.join(path, pattern)))
+    else:
+        files = [path]
+    if not files:
+        return {}
+
+    chain = ROOT.TChain(TREE_NAME)
+    for f in files:
+        chain.Add(f)
+    if chain.GetEntries() == 0:
+        return {}
+    rdf = ROOT.RDataFrame(chain)
+    if columns is not None:
+        available = set(str(c) for c in rdf.GetColumnNames())
+        columns = [c for c in columns if c in available]
+    data = {k: np.asarray(v) for k, v in rdf.AsNumpy(columns).items()}
+
+    if keys:
+        order = np.lexsort([data['nll'], data['status'] != 0] if 'status' in data else [data['nll']])
+        seen, keep = set(), []
+        for i in order:
+            key = tuple(round(float(data[k][i]), 8) for k in keys)
+            if key not in seen:
+                seen.add(key)
+                keep.append(i)
+        keep.sort()
+        data = {k: v[keep] for k, v in data.items()}
+    return data
+
+
+def correlation(data: Dict[str, 'np.ndarray'], pois: List[str], row: int = -1) -> Optional[List[List[float]]]:
+    """POI correlation matrix of one row of a store.
+
+    Args:
+        data: Output of read_scan.
+        pois: POI names, in the order of the matrix.
+        row: Row of the store (default: the last one).
+
+    Returns:
+        Matrix as a list of rows, None if a pair has no correlation column.
+    """
+    matrix = [[1.0 if i == j else 0.0 for j in range(len(pois))] for i in range(len(pois))]
+    for i, a in enumerate(pois):
+        for j, b in enumerate(pois[:i]):
+            column = data.get(f"{CORR_PREFIX}{a}__{b}", data.get(f"{CORR_PREFIX}{b}__{a}"))
+            if column is None:
+                return None
+            matrix[i][j] = matrix[j][i] = float(column[row])
+    return matrix
+
+
+def merge(root_dir: str, remove_parts: bool = True) -> Optional[str]:
+    """Merge the store parts of a scan directory into scan.root.
+
+    Args:
+        root_dir: Scan directory.
+        remove_parts: Delete the parts once merged.
+
+    Returns:
+        Path of scan.root, or None if there was nothing to merge.
+    """
+    files = store_files(root_dir)
+    parts = [f for f in files if os.path.basename(f) != STORE_NAME]
+    if not parts:
+        return files[0] if files else None
+    output = os.path.join(root_dir, STORE_NAME)
+    # write next to the output and rename, so that readers never see a partial file
+    tmp = output + '.tmp.root'
+    proc = subprocess.run(['hadd', '-f', tmp] + files, stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+    if proc.returncode != 0:
+        raise IOError(f"Cannot merge the store files of {root_dir}:\n{proc.stdout}")
+    os.replace(tmp, output)
+    if remove_parts:
+        for f in parts:
+            os.remove(f)
+    return output
+
+
+def main():
+    """CLI interface for scan stores."""
+    parser = argparse.ArgumentParser(description="Read or merge columnar scan-result stores.")
+    parser.add_argument('path', help='Store file or scan directory')
+    parser.add_argument('--merge', action='store_true', help='Merge the store parts into scan.root')
+    parser.add_argument('--columns', help='Comma-separated branches to print')
+    args = parser.parse_args()
+
+    if args.merge:
+        output = merge(args.path)
+        print(output or f"No store files in {args.path}")
+        return
+    columns = args.columns.split(',') if args.columns else None
+    data = read_scan(args.path, columns)
+    if not data:
+        print(f"No scan points in {args.path}", file=sys.stderr)
+        sys.exit(1)
+    names = list(data)
+    print(' '.join(names))
+    for row in zip(*(data[n] for n in names)):
+        print(' '.join(f"{v:.8g}" for v in row))
+
+
+if __name__ == '__main__':
+    main()
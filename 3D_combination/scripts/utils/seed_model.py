@@ -0,0 +1,164 @@
+#!/usr/bin/env python3
+"""
+Starting values of scan points predicted from the points already fitted.
+
+Along a scan the profiled NPs and floating POIs move smoothly with the
+scanned POIs. SeedModel keeps the converged points of a scan and fits, around
+each new point, a weighted local polynomial of every parameter in the scan
+coordinates: quadratic if enough neighbours are known, else linear, else the
+values of the nearest point. The prediction is the starting point of the
+fit, in any order the points are fitted (sequential, tiles, retries), so the
+minimizer starts close to the profiled minimum instead of at the previous
+point or the loaded state.
+
+The coordinates are those of the scan grid, e.g. the scanned POI value in
+1D or the grid indices (i, j) in 2D; all axes should have comparable steps.
+Along an axis the degree is limited by the number of distinct neighbour
+coordinates, so e.g. the first row of a 2D grid is predicted along the row.
+
+Example usage:
+    from utils.seed_model import SeedModel
+
+    model = SeedModel()
+    for val in values:
+        seeds, order = model.predict((val,))
+        result = server.fit(poi_string, output_file, seeds or None)
+        if result.success:
+            model.add((val,), {**result.pois, **server.values(result.request_id)})
+"""
+
+import math
+from typing import Dict, List, Optional, Sequence, Tuple
+
+Point = Tuple[float, ...]
+
+# Relative pivot below which the local system counts as singular
+SINGULAR = 1e-10
+
+
+def _exponents(n_axes: int, order: int) -> List[Tuple[int, ...]]:
+    """Monomial exponents up to total degree order, constant term first."""
+    terms = [()]
+    for _ in range(n_axes):
+        terms = [t + (e,) for t in terms for e in range(order + 1)]
+    return sorted((t for t in terms if sum(t) <= order), key=sum)
+
+
+def _solve(matrix: List[List[float]], rhs: List[float]) -> Optional[List[float]]:
+    """Solve a small linear system by Gaussian elimination, None if singular."""
+    n = len(rhs)
+    a = [row[:] + [rhs[i]] for i, row in enumerate(matrix)]
+    scale = max(abs(a[i][i]) for i in range(n)) or 1.0
+    for col in range(n):
+        pivot = max(range(col, n), key=lambda r: abs(a[r][col]))
+        if abs(a[pivot][col]) < SINGULAR * scale:
+            return None
+        a[col], a[pivot] = a[pivot], a[col]
+        for r in range(col + 1, n):
+            f = a[r][col] / a[col][col]
+            for c in range(col, n + 1):
+                a[r][c] -= f * a[col][c]
+    x = [0.0] * n
+    for r in range(n - 1, -1, -1):
+        x[r] = (a[r][n] - sum(a[r][c] * x[c] for c in range(r + 1, n))) / a[r][r]
+    return x
+
+
+class SeedModel:
+    """
+    Local polynomial model of the fitted parameters over the scan coordinates.
+
+    Attributes:
+        max_order: Highest polynomial degree (2: quadratic).
+        neighbours: Number of nearest converged points in a local fit.
+        points: Converged points and their parameter values.
+    """
+
+    def __init__(self, max_order: int = 2, neighbours: Optional[int] = None):
+        """Initialize an empty model.
+
+        Args:
+            max_order: Highest polynomial degree.
+            neighbours: Points per local fit (default: twice the quadratic terms).
+        """
+        self.max_order = max_order
+        self.neighbours = neighbours
+        self.points: Dict[Point, Dict[str, float]] = {}
+
+    def add(self, point: Sequence[float], values: Dict[str, float]) -> None:
+        """Record the fitted parameter values of a converged point."""
+        self.points[tuple(float(x) for x in point)] = dict(values)
+
+    def predict(self, point: Sequence[float], radius: float = math.inf) -> Tuple[Dict[str, float], int]:
+        """Predicted parameter values at point.
+
+        Args:
+            point: Scan coordinates.
+            radius: Farthest known point taken into account.
+
+        Returns:
+            (values, order): the prediction and the degree of the polynomial
+            it comes from, 0 for the values of the nearest point; ({}, -1) if
+            no point is known within radius.
+        """
+        x0 = tuple(float(x) for x in point)
+        if x0 in self.points:
+            return dict(self.points[x0]), 0
+        n_neighbours = self.neighbours or 2 * len(_exponents(len(x0), 2))
+        near = sorted((math.dist(p, x0), p) for p in self.points)
+        near = [(d, p) for d, p in near if d <= radius][:n_neighbours]
+        if not near:
+            return {}, -1
+
+        # parameters known at all neighbours; the others come from the nearest point
+        nearest = self.points[near[0][1]]
+        names = [n for n in nearest if all(n in self.points[p] for _, p in near)]
+        prediction = dict(nearest)
+
+        # an axis with m distinct coordinates among the neighbours carries degree m - 1 at most
+        distinct = {k: len({p[k] for _, p in near}) for k in range(len(x0))}
+        axes = [k for k in range(len(x0)) if distinct[k] > 1]
+        h = 1.5 * near[-1][0]
+        weights = [(1 - (d / h) ** 3) ** 3 for d, _ in near]
+        for order in range(self.max_order, 0, -1):
+            terms = [t for t in _exponents(len(axes), order)
+                     if all(e < distinct[k] for e, k in zip(t, axes))]
+            # at least one point more than terms for a quadratic, so that it is not pure interpolation
+            if not axes or len(near) < len(terms) + (order > 1):
+                continue
+            coeffs = self._coefficients(x0, near, weights, axes, terms)
+            if coeffs is None:
+                continue
+            for name in names:
+                ys = [self.points[p][name] for _, p in near]
+                value = sum(c * y for c, y in zip(coeffs, ys))
+                # no wild extrapolation at the edges of the scan
+                lo, hi = min(ys), max(ys)
+                prediction[name] = min(max(value, lo - (hi - lo)), hi + (hi - lo))
+            return prediction, order
+        return prediction, 0
+
+    @staticmethod
+    def _coefficients(
+        x0: Point,
+        near: List[Tuple[float, Point]],
+        weights: List[float],
+        axes: List[int],
+        terms: List[Tuple[int, ...]]
+    ) -> Optional[List[float]]:
+        """Weights c_i of the known points in the least-squares value at x0.
+
+        With the design matrix A (monomials in x - x0) and weights W, the
+        fitted constant term is e0 (A^T W A)^-1 A^T W y, i.e. sum_i c_i y_i,
+        the same for every parameter.
+        """
+        rows = []
+        for _, p in near:
+            dx = [p[k] - x0[k] for k in axes]
+            rows.append([math.prod(d ** e for d, e in zip(dx, t)) for t in terms])
+        n = len(terms)
+        normal = [[sum(w * r[a] * r[b] for w, r in zip(weights, rows)) for b in range(n)] for a in range(n)]
+        z = _solve(normal, [1.0] + [0.0] * (n - 1))
+        if z is None:
+            return None
+        return [w * sum(r[a] * z[a] for a in range(n)) for w, r in zip(weights, rows)]